@@ -1,9 +1,17 @@
 #include <exception>
+#include <iostream>
 #include <msync_exception.hpp>
 #include <print_logger.hpp>
 #include <string>
 #include <string_view>
 #include <algorithm>
+#include <atomic>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <map>
+#include <initializer_list>
 
 #include "version.hpp"
 #include "../lib/options/global_options.hpp"
@@ -13,8 +21,10 @@
 #include "../lib/queue/queues.hpp"
 #include "../lib/sync/send.hpp"
 #include "../lib/sync/recv.hpp"
+#include "../lib/sync/show.hpp"
 #include "../lib/net/net.hpp"
 #include "../lib/util/util.hpp"
+#include "../lib/trace/trace.hpp"
 #include "../lib/accountdirectory/account_directory.hpp"
 #include "new_account.hpp"
 #include "optionparsing/parse_options.hpp"
@@ -26,6 +36,8 @@ std::pair<const std::string, user_options>& assume_account(select_account_result
 std::string get_account_error(select_account_error err);
 
 void do_sync(const parse_result& parsed);
+void report_stats(const sync_stats& stats, const std::string& json_file) noexcept;
+unsigned long long byte_limit(const std::string* size, std::string_view where);
 
 void show_all_options(select_account_result user_result);
 
@@ -98,9 +110,19 @@ int main(int argc, const char* argv[])
 				clear(parsed.queue_opt.selected, assume_account(parsed.account).second.get_user_directory());
 				break;
 			case queue_action::print:
-				print_iterable(print(assume_account(parsed.account).second.get_user_directory()));
+			{
+				const auto user_dir = assume_account(parsed.account).second.get_user_directory();
+				print_iterable(print(user_dir));
+
+				const auto failed = print_failed(user_dir);
+				if (!failed.empty())
+				{
+					pl() << "\nThese failed in a way that trying again won't fix, so they won't be sent again:\n";
+					print_iterable(failed);
+				}
 				break;
 			}
+			}
 			break;
 		case mode::gen:
 		{ //notice the braces- this is a scope
@@ -113,6 +135,13 @@ int main(int argc, const char* argv[])
 			should_print_newline = false;
 			do_sync(parsed);
 			break;
+		case mode::show:
+			should_print_newline = false;
+			if (parsed.show_opt.all)
+				show_all_posts(assume_account(parsed.account).second, parsed.show_opt.timeline, std::cout);
+			else
+				show_posts(assume_account(parsed.account).second, parsed.show_opt.timeline, parsed.show_opt.count, std::cout);
+			break;
 		case mode::help:
 			should_print_newline = false;
 			break;
@@ -159,6 +188,28 @@ int main(int argc, const char* argv[])
 
 void do_sync(const parse_result& parsed)
 {
+	if (!parsed.sync_opts.trace_file.empty())
+		start_trace(fs::path{ parsed.sync_opts.trace_file });
+
+	// write the trace out however the sync ends, since the syncs that fail are the interesting ones
+	struct trace_writer
+	{
+		~trace_writer() { finish_trace(); }
+	} write_trace_at_end;
+
+	// print how much got sent and received however the sync ends, too
+	sync_stats stats;
+	struct stats_reporter
+	{
+		const sync_stats& stats;
+		const std::string& json_file;
+		~stats_reporter() { report_stats(stats, json_file); }
+	} report_stats_at_end{ stats, parsed.sync_opts.stats_file };
+
+	// let ctrl-C finish the page that's being written, so the next sync can pick up where this one stopped.
+	// returning normally from here is what saves everyone's last IDs.
+	catch_stop_signals();
+
 	user_ptr user = nullptr;
 	if (!parsed.account.empty())
 	{
@@ -181,40 +232,165 @@ void do_sync(const parse_result& parsed)
 	}
 
 
-	if (parsed.sync_opts.send)
+	send_posts send{ simple_post, simple_delete, new_status, upload_media, get_timeline_and_notifs };
+	send.retries = parsed.sync_opts.retries;
+	send.concurrency = parsed.sync_opts.concurrency;
+	send.literal_queue = parsed.sync_opts.literal_queue;
+	send.stats = &stats;
+
+	recv_posts recv{ get_timeline_and_notifs };
+	recv.max_requests = parsed.sync_opts.max_requests;
+	recv.per_call = parsed.sync_opts.per_call;
+	recv.retries = parsed.sync_opts.retries;
+	recv.concurrent_timelines = true;
+	recv.stats = &stats;
+
+	const auto send_account = [&parsed](auto& send, const auto& user) {
+		if (!parsed.sync_opts.send || stop_requested)
+			return;
+
+		pl() << "Processing queue for " << user.first << '\n';
+		trace_scope sending{ "send", "sync" };
+		sending.args.add("account", user.first);
+		send.send(user.second.get_user_directory(), user.second.get_option(user_option::instance_url), user.second.get_option(user_option::access_token));
+	};
+
+	const auto recv_account = [&parsed](auto& recv, auto& user, auto... timelines) {
+		if (!parsed.sync_opts.get || stop_requested)
+			return;
+
+		trace_scope receiving{ "receive", "sync" };
+		receiving.args.add("account", user.first);
+		recv.get(user.second, timelines...);
+	};
+
+	std::vector<user_ptr> accounts;
+	if (user != nullptr)
+		accounts.push_back(user);
+	else
+		options().foreach_account([&accounts](auto& user) { accounts.push_back(&user); });
+
+	// each account's limit is inside the whole sync's, so a request has to fit in both.
+	// check all of them before anything gets sent, so a typo doesn't stop a sync halfway through.
+	const unsigned long long sync_limit = byte_limit(parsed.sync_opts.max_bytes.empty() ? nullptr : &parsed.sync_opts.max_bytes, "--max-bytes");
+	byte_budget sync_budget{ sync_limit };
+	std::map<std::string_view, byte_budget> account_budgets;
+	bool any_limit = sync_limit != 0;
+	for (const auto account : accounts)
+	{
+		const auto limit = byte_limit(account->second.try_get_option(user_option::max_bytes), account->first + "'s max_bytes option");
+		account_budgets.try_emplace(account->first, limit, &sync_budget);
+		any_limit = any_limit || limit != 0;
+	}
+
+	if (any_limit)
 	{
-		send_posts send{ simple_post, simple_delete, new_status, upload_media, get_timeline_and_notifs };
-		send.retries = parsed.sync_opts.retries;
-		if (user == nullptr) 
+		// when there's not enough data to go around, the most important stuff goes first, for everyone:
+		// notifications, then queued calls, then home, then bookmarks.
+		// that means going one account at a time, so --jobs doesn't do anything here.
+		const auto foreach_budgeted = [&](auto step) {
+			for (const auto account : accounts)
+			{
+				byte_budget* budget = &account_budgets.at(account->first);
+				send.budget = budget;
+				recv.budget = budget;
+				step(*account);
+			}
+		};
+
+		foreach_budgeted([&](auto& account) { recv_account(recv, account, std::initializer_list<to_get>{ to_get::notifications }); });
+		foreach_budgeted([&](auto& account) { send_account(send, account); });
+		foreach_budgeted([&](auto& account) { recv_account(recv, account, std::initializer_list<to_get>{ to_get::home }); });
+		foreach_budgeted([&](auto& account) { recv_account(recv, account, std::initializer_list<to_get>{ to_get::bookmarks }); });
+
+		if (sync_limit != 0)
+			pl() << "Used " << format_bytes(sync_budget.spent()) << " of the " << format_bytes(sync_limit) << " limit.\n";
+		return;
+	}
+
+	if (user != nullptr)
+	{
+		send_account(send, *user);
+		recv_account(recv, *user);
+		return;
+	}
+
+	if (parsed.sync_opts.jobs <= 1)
+	{
+		options().foreach_account([&](const auto& user) { send_account(send, user); });
+		options().foreach_account([&](auto& user) { recv_account(recv, user); });
+		return;
+	}
+
+	// each account only touches its own folder and its own options file, so accounts can be synced independently.
+	// that means each account can send and then receive right away instead of waiting on everyone else's queues.
+	std::vector<std::string_view> instances;
+	for (const auto account : accounts)
+		instances.push_back(account->second.get_option(user_option::instance_url));
+
+	std::atomic<bool> any_failed = false;
+	parallel_for_limited(instances, parsed.sync_opts.jobs, parsed.sync_opts.per_instance, [&](size_t idx)
+	{
+		// everything this account logs comes out in one piece when it's done
+		log_group account_log;
+		try
 		{
-			options().foreach_account([&send](const auto& user) {
-				pl() << "Processing queue for " << user.first << '\n';
-				send.send(user.second.get_user_directory(), user.second.get_option(user_option::instance_url), user.second.get_option(user_option::access_token)); });
+			// send_posts and recv_posts are just settings and the functions they call, so each thread gets its own copy
+			auto thread_send = send;
+			auto thread_recv = recv;
+			send_account(thread_send, *accounts[idx]);
+			recv_account(thread_recv, *accounts[idx]);
 		}
-		else
+		catch (const std::exception& e)
 		{
-			pl() << "Processing queue for " << user->first << '\n';
-			send.send(user->second.get_user_directory(), user->second.get_option(user_option::instance_url), user->second.get_option(user_option::access_token));
+			// one account failing shouldn't stop everyone else from syncing
+			pl() << "An error occurred while syncing " << accounts[idx]->first << ": " << e.what() << '\n';
+			any_failed = true;
 		}
-	}
+	});
 
-	if (parsed.sync_opts.get)
-	{
-		recv_posts recv{ get_timeline_and_notifs };
-		recv.max_requests = parsed.sync_opts.max_requests;
-		recv.per_call = parsed.sync_opts.per_call;
-		recv.retries = parsed.sync_opts.retries;
+	if (any_failed)
+		throw msync_exception("At least one account didn't sync successfully. See above for details.");
+}
 
-		if (user == nullptr)
+void report_stats(const sync_stats& stats, const std::string& json_file) noexcept
+{
+	try
+	{
+		if (!stats.empty())
 		{
-			options().foreach_account([&recv](auto& user) {
-				recv.get(user.second); });
+			std::ostringstream summary;
+			stats.print(summary);
+			pl() << "\nTransferred:\n" << summary.str();
 		}
-		else
-			recv.get(user->second);
+
+		if (json_file.empty())
+			return;
+
+		// one line per sync, so a bunch of syncs can be charted together
+		std::ofstream out{ json_file, std::ios::app };
+		out << stats.to_json(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) << '\n';
+		if (!out)
+			pl() << "Couldn't write sync statistics to " << json_file << '\n';
+	}
+	catch (const std::exception& e)
+	{
+		pl() << "Couldn't report sync statistics: " << e.what() << '\n';
 	}
 }
 
+unsigned long long byte_limit(const std::string* size, std::string_view where)
+{
+	if (size == nullptr || size->empty())
+		return 0;
+
+	const auto parsed = parse_byte_size(*size);
+	if (!parsed.has_value())
+		throw msync_exception(std::string{ where } + " is set to " + *size + ", which isn't a size msync understands. Try something like 500K or 2M.");
+
+	return *parsed;
+}
+
 bool is_sensitive(user_option opt)
 {
 	for (const user_option sensitive : { user_option::access_token, user_option::auth_code, user_option::client_id, user_option::client_secret })
@@ -259,7 +435,7 @@ void show_all_options(select_account_result user_result)
 				pl() << '\n';
 			}
 		}
-		else if (opt >= first_boolean_option && opt <= user_option::exclude_polls)
+		else if (opt >= first_boolean_option && opt <= user_option::post_store)
 		{
 			pl() << option_name << ": " << (user.second.get_bool_option(opt) ? "true" : "false") << '\n';
 		}
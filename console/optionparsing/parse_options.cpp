@@ -35,7 +35,9 @@ clipp::group make_cli(parse_result& ret)
 				command("exclude_favs").set(ret.toset, user_option::exclude_favs).set(ret.selected, mode::showopt),
 				command("exclude_follows").set(ret.toset, user_option::exclude_follows).set(ret.selected, mode::showopt),
 				command("exclude_mentions").set(ret.toset, user_option::exclude_mentions).set(ret.selected, mode::showopt),
-				command("exclude_polls").set(ret.toset, user_option::exclude_polls).set(ret.selected, mode::showopt)));
+				command("exclude_polls").set(ret.toset, user_option::exclude_polls).set(ret.selected, mode::showopt),
+				command("post_store").set(ret.toset, user_option::post_store).set(ret.selected, mode::showopt),
+				command("max_bytes").set(ret.toset, user_option::max_bytes).set(ret.selected, mode::showopt)));
 
 	const auto newaccount = (command("new").set(ret.selected, mode::newuser)).doc("Register a new account with msync. Start here.");
 	const auto configMode = (command("config").set(ret.selected, mode::config).doc("Set and show account-specific options.") &
@@ -64,6 +66,13 @@ clipp::group make_cli(parse_result& ret)
 			(option("-r", "--retries") & value("retries", ret.sync_opts.retries)) % "Retry failed requests n times. (default: 3)",
 			(option("-p", "--posts") & value("count", ret.sync_opts.per_call)) % "When receiving, get this many posts or notifications per call. Decrease this if you have a flaky connection. (default: 40 for statuses, 30 for notifications)",
 			(option("-m", "--max-requests") & value("count", ret.sync_opts.max_requests)) % "When receiving, get at most this many pages of posts or notifications. (default: 5 on first run, unlimited afterwards)",
+			(option("-c", "--concurrency") & value("count", ret.sync_opts.concurrency)) % "When sending, make up to this many requests at the same time. Calls that depend on each other, like a boost and an unboost of the same post, or replies in a thread, still happen in order. (default: 1)",
+			(option("-j", "--jobs") & value("count", ret.sync_opts.jobs)) % "When syncing more than one account, sync up to this many accounts at the same time. (default: 1)",
+			(option("--per-instance") & value("count", ret.sync_opts.per_instance)) % "When syncing accounts at the same time with --jobs, sync at most this many accounts on the same instance at once. (default: 1)",
+			(option("--trace") & value("file", ret.sync_opts.trace_file)) % "Write a Chrome trace of the sync to this file, with how long each request spent connecting, waiting, and downloading, and how long parsing and writing posts took. Open it in chrome://tracing or ui.perfetto.dev.",
+			(option("--max-bytes") & value("size", ret.sync_opts.max_bytes)) % "Stop syncing before more than this much data is sent and received, like 500K or 2M. Notifications go first, then queued calls, then home, then bookmarks, and whatever doesn't fit is picked up next time. (default: no limit)",
+			option("--literal-queue").set(ret.sync_opts.literal_queue) % "Send every queued call just the way it was queued. Normally, calls that a later call in the queue undoes or repeats are skipped, so a boost, an unboost, and a boost of the same post only send the last boost. Use this if you want the post unboosted and boosted again.",
+			(option("--stats-json") & value("file", ret.sync_opts.stats_file)) % "Add a line of JSON to this file saying how many requests were made and how many bytes were sent and received, by account, timeline, and kind of queued call.",
 			one_of(
 				option("-s", "--send-only").set(ret.sync_opts.get, false).doc("Only send queued messages, don't download anything."),
 				option("-g", "--get-only", "--recv-only").set(ret.sync_opts.send, false).doc("Only download posts, don't send anything from queues.")
@@ -104,10 +113,19 @@ clipp::group make_cli(parse_result& ret)
 				command("print").set(ret.queue_opt.to_do, queue_action::print))
 			.doc("queue commands"));
 
+	const auto showMode = (command("show").set(ret.selected, mode::show).doc("Print the newest posts from a timeline. This only reads the end of the file, so it's quick even if the timeline is huge.") &
+			(
+			one_of(command("home").set(ret.show_opt.timeline, to_get::home),
+				command("notifications").set(ret.show_opt.timeline, to_get::notifications),
+				command("bookmarks").set(ret.show_opt.timeline, to_get::bookmarks)),
+			(option("-n", "--count") & value("count", ret.show_opt.count)) % "Print this many posts. (default: 10)",
+			option("--all").set(ret.show_opt.all) % "Print every post in the timeline, oldest first, the same as the .list file. This works with a post store, too."
+			) % "show options");
+
 	const auto universalOptions = ((option("-a", "--account") & value("account", ret.account)).doc("The account name to operate on."),
 			option("-v", "--verbose").set(verbose_logs).doc("Verbose mode. Program will be more chatty."));
 
-	return (newaccount | configMode | syncMode | genMode | queueMode | 
+	return (newaccount | configMode | syncMode | genMode | queueMode | showMode | 
 		command("yeehaw").set(ret.selected, mode::yeehaw) | 
 		command("location").set(ret.selected, mode::location).doc("Print the location where msync stores user data.") | 
 		command("version", "--version").set(ret.selected, mode::version).doc("Print version and compile flags.") |
@@ -12,6 +12,7 @@ enum class mode
 	configlist,
 	sync,
 	gen,
+	show,
 	queue,
 	help,
 	version,
@@ -30,6 +31,7 @@ struct parse_result
 	sync_options sync_opts;
 	queue_options queue_opt;
 	gen_options gen_opt;
+	show_options show_opt;
 	std::string optionval;
 	std::string account;
 };
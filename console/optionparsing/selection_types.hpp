@@ -1,14 +1,22 @@
 #include "../../lib/options/user_options.hpp"
 #include "../../lib/queue/queues.hpp"
 #include "../../lib/postfile/outgoing_post.hpp"
+#include "../../lib/sync/timelines.hpp"
 
 struct sync_options
 {
 	unsigned int retries = 3;
 	unsigned int max_requests = 0;
 	unsigned int per_call = 0;
+	unsigned int concurrency = 1;
+	unsigned int jobs = 1;
+	unsigned int per_instance = 1;
+	std::string trace_file;
+	std::string stats_file;
+	std::string max_bytes;
 	bool send = true;
 	bool get = true;
+	bool literal_queue = false;
 	sync_settings mode;
 };
 
@@ -27,6 +35,13 @@ struct queue_options
 	api_route selected;
 };
 
+struct show_options
+{
+	to_get timeline = to_get::home;
+	unsigned int count = 10;
+	bool all = false;
+};
+
 struct gen_options
 {
 	std::string filename = "new_post";
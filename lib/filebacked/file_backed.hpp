@@ -2,12 +2,26 @@
 #define FILE_BACKED_HPP
 
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
 
 #include <iterator>
 
 #include <filesystem.hpp>
 
-template <typename Container, bool(*Read)(Container&, std::string&&), void(*Write)(Container&&, std::ofstream&), bool skip_blank = true, bool skip_comment = true, bool read_only = false>
+// writes contents to a temporary file next to file, makes sure it's actually on the disk, and renames it over file.
+// that way, file is always either the old version or the new one, even if msync or the computer dies halfway through.
+// the old version is kept as file.bak. Returns false if the new version couldn't be written, in which case the old one is left alone.
+bool replace_file(const fs::path& file, std::string_view contents);
+
+// adds contents to the end of file, creating it if it isn't there, and makes sure it's on the disk. Returns false if it couldn't.
+bool append_to_file(const fs::path& file, std::string_view contents);
+
+// tells the user that changes to file couldn't be saved, for when there's no caller to hand the failure back to.
+void report_unsaved(const fs::path& file);
+
+template <typename Container, bool(*Read)(Container&, std::string&&), void(*Write)(Container&&, std::ostream&), bool skip_blank = true, bool skip_comment = true, bool read_only = false>
 class file_backed
 {
 public:
@@ -19,7 +33,18 @@ public:
 		// .c_str() is needed to make Boost happy
 		// the std::filesystem::path overload of this just calls .c_str() on it anyways
 		std::ifstream backingfile(backing.c_str());
-		for (std::string line; getline(backingfile, line);)
+
+		// hang on to exactly what was there, so the destructor can tell whether anything changed
+		if constexpr (!read_only)
+		{
+			original.assign(std::istreambuf_iterator<char>(backingfile), {});
+			backingfile.close();
+		}
+
+		std::istringstream fromoriginal{ original };
+		std::istream& lines = read_only ? static_cast<std::istream&>(backingfile) : fromoriginal;
+
+		for (std::string line; getline(lines, line);)
 		{
 			const auto first_non_whitespace = line.find_first_not_of(" \t\r\n");
 
@@ -35,7 +60,7 @@ public:
 			if (Read(parsed, std::move(line)))
 			{
 				// ...read to end of string https://stackoverflow.com/questions/3203452/how-to-read-entire-stream-into-a-stdstring
-				Read(parsed, std::string(std::istreambuf_iterator<char>(backingfile), {}));
+				Read(parsed, std::string(std::istreambuf_iterator<char>(lines), {}));
 			}
 		}
 	}
@@ -48,30 +73,28 @@ public:
 			// if they only wanted to look at the thing, don't save the changes
 		}
 
-		if (fs::exists(backing))
-		{
-			// either we got moved from, so the new version will save it, or just got told not to bother.
-			// however, we should always create a file if it doesn't exist.
-			if (!should_save_back)
-				return;
-
-			// gotta make a copy here
-			const fs::path backup = fs::path{ backing }.concat(".bak");
-#ifdef _WIN32
-			// sometimes, Windows doesn't do the rename correctly and throws an "access denied" error when
-			// renaming over an existing file.
-			fs::remove(backup);
-#endif
-			fs::rename(backing, backup);
-		}
+		// either we got moved from, so the new version will save it, or just got told not to bother.
+		// if the file doesn't exist yet, it still gets written, as long as there's something to put in it.
+		if (backing.empty() || (!should_save_back && fs::exists(backing)))
+			return;
 
-		std::ofstream of{ backing.c_str() };
-		Write(std::move(parsed), of);
+		std::ostringstream rendered;
+		Write(std::move(parsed), rendered);
+		const std::string contents = rendered.str();
+
+		// most of the time, nothing changed, and rewriting the file would just be a bunch of disk I/O for nothing.
+		// a file that doesn't exist counts as empty, so looking at an empty queue doesn't create a file for it.
+		if (contents == original)
+			return;
+
+		// there's no way to hand this back from a destructor, but the old version is still there, and whoever made the changes should know they're gone
+		if (!replace_file(backing, contents))
+			report_unsaved(backing);
 	}
 
 	// can be moved
 	file_backed(file_backed&& other) noexcept // move constructor
-		:  parsed(std::move(other.parsed)), backing(std::move(other.backing))
+		:  parsed(std::move(other.parsed)), backing(std::move(other.backing)), original(std::move(other.original))
 	{
 		other.should_save_back = false;
 	}
@@ -80,6 +103,7 @@ public:
 	{
 		std::swap(parsed, other.parsed);
 		std::swap(backing, other.backing);
+		std::swap(original, other.original);
 		other.should_save_back = false;
 		return *this;
 	}
@@ -90,6 +114,9 @@ public:
 
 private:
 	fs::path backing;
+
+	// what the file had in it when it was read, or nothing if it didn't exist.
+	std::string original;
 };
 
 #endif
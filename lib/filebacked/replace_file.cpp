@@ -0,0 +1,125 @@
+#include "file_backed.hpp"
+
+#include <print_logger.hpp>
+
+#include <cerrno>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// an ofstream can't be told to make sure everything's on the disk, so this goes straight to the OS.
+static bool write_to_disk(const fs::path& file, std::string_view contents, bool append)
+{
+#ifdef _WIN32
+	// text mode, so the files come out with the same line endings an ofstream would have given them
+	const int fd = _wopen(file.c_str(), _O_WRONLY | _O_CREAT | (append ? _O_APPEND : _O_TRUNC) | _O_TEXT, _S_IREAD | _S_IWRITE);
+#else
+	const int fd = open(file.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC) | O_CLOEXEC, 0666);
+#endif
+	if (fd < 0)
+		return false;
+
+	bool succeeded = true;
+	while (!contents.empty())
+	{
+#ifdef _WIN32
+		const auto written = _write(fd, contents.data(), static_cast<unsigned int>(contents.size()));
+#else
+		const auto written = write(fd, contents.data(), contents.size());
+#endif
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written <= 0)
+		{
+			succeeded = false;
+			break;
+		}
+
+		contents.remove_prefix(static_cast<size_t>(written));
+	}
+
+#ifdef _WIN32
+	succeeded = succeeded && _commit(fd) == 0;
+	succeeded = _close(fd) == 0 && succeeded;
+#else
+	succeeded = succeeded && fsync(fd) == 0;
+	succeeded = close(fd) == 0 && succeeded;
+#endif
+
+	return succeeded;
+}
+
+// on POSIX systems, the rename isn't guaranteed to survive a crash until the folder it happened in is synced too.
+static void sync_directory(const fs::path& directory)
+{
+#ifndef _WIN32
+	const int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+	fsync(fd);
+	close(fd);
+#else
+	(void)directory;
+#endif
+}
+
+bool replace_file(const fs::path& file, std::string_view contents)
+{
+	const fs::path temp = fs::path{ file }.concat(".tmp");
+	const fs::path backup = fs::path{ file }.concat(".bak");
+
+#if MSYNC_USE_BOOST
+	boost::system::error_code ec;
+#else
+	std::error_code ec;
+#endif
+	if (!write_to_disk(temp, contents, false))
+	{
+		fs::remove(temp, ec);
+		return false;
+	}
+
+	if (fs::exists(file, ec))
+	{
+		// a hard link keeps the old version around as the backup without copying it or moving it out of the way first
+		fs::remove(backup, ec);
+		fs::create_hard_link(file, backup, ec);
+
+		// some filesystems, like the FAT on most SD cards, don't do hard links.
+		// moving it out of the way means there's a moment where only the backup and the temporary file are there, but both of them are complete.
+		if (ec)
+			fs::rename(file, backup, ec);
+	}
+
+	fs::rename(temp, file, ec);
+	if (ec)
+	{
+		// sometimes, Windows doesn't do the rename correctly and gives an "access denied" error when
+		// renaming over an existing file.
+		fs::remove(file, ec);
+		fs::rename(temp, file, ec);
+		if (ec)
+			return false;
+	}
+
+	sync_directory(file.parent_path());
+	return true;
+}
+
+bool append_to_file(const fs::path& file, std::string_view contents)
+{
+	return write_to_disk(file, contents, true);
+}
+
+void report_unsaved(const fs::path& file)
+{
+	pl() << "Couldn't save changes to " << file << ". The last version that was saved is still there.\n";
+}
@@ -1,8 +1,14 @@
 #include "net.hpp"
+#include "session_pool.hpp"
+
+#include "../trace/trace.hpp"
 
 #include <cpr/cpr.h>
+#include <curl/curl.h>
 #include <string>
 #include <utility>
+#include <charconv>
+#include <chrono>
 
 #include <filesystem.hpp>
 
@@ -22,12 +28,121 @@ std::string make_bearer(const std::string_view access_token)
 	return std::string{ "Bearer " }.append(access_token);
 }
 
-net_response handle_response(cpr::Response&& response)
+std::string header_or_empty(const cpr::Header& headers, const char* name)
+{
+	const auto header = headers.find(name);
+	return header == headers.end() ? std::string{} : header->second;
+}
+
+int header_to_int(const cpr::Header& headers, const char* name)
+{
+	const auto header = headers.find(name);
+	if (header == headers.end())
+		return -1;
+
+	int value = -1;
+	std::from_chars(header->second.data(), header->second.data() + header->second.size(), value);
+	return value;
+}
+
+long long curl_info_or_negative(CURL* handle, CURLINFO info)
+{
+	curl_off_t value = -1;
+	if (curl_easy_getinfo(handle, info, &value) != CURLE_OK)
+		return -1;
+	return value;
+}
+
+transfer_timing get_timing(cpr::Session& session, const cpr::Response& response)
+{
+	transfer_timing timing;
+	timing.body_bytes = static_cast<long long>(response.text.size());
+
+	const auto holder = session.GetCurlHolder();
+	if (holder == nullptr || holder->handle == nullptr)
+		return timing;
+
+	CURL* const handle = holder->handle;
+
+	// curl's times all count from when the request started, so take the differences to see how long each step took.
+	const auto dns = curl_info_or_negative(handle, CURLINFO_NAMELOOKUP_TIME_T);
+	const auto connect = curl_info_or_negative(handle, CURLINFO_CONNECT_TIME_T);
+	const auto tls = curl_info_or_negative(handle, CURLINFO_APPCONNECT_TIME_T);
+	const auto pretransfer = curl_info_or_negative(handle, CURLINFO_PRETRANSFER_TIME_T);
+	const auto first_byte = curl_info_or_negative(handle, CURLINFO_STARTTRANSFER_TIME_T);
+	const auto total = curl_info_or_negative(handle, CURLINFO_TOTAL_TIME_T);
+
+	if (dns >= 0 && connect >= dns && pretransfer >= 0 && first_byte >= pretransfer && total >= first_byte)
+	{
+		timing.dns_us = dns;
+		timing.connect_us = connect - dns;
+		// the TLS handshake time is zero if there wasn't one, like for plain HTTP or a reused connection
+		timing.tls_us = tls > connect ? tls - connect : 0;
+		timing.first_byte_us = first_byte - pretransfer;
+		timing.transfer_us = total - first_byte;
+		timing.total_us = total;
+	}
+
+	timing.wire_bytes = curl_info_or_negative(handle, CURLINFO_SIZE_DOWNLOAD_T);
+	timing.sent_bytes = curl_info_or_negative(handle, CURLINFO_SIZE_UPLOAD_T);
+
+	long header_size = -1;
+	if (curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &header_size) == CURLE_OK)
+		timing.header_bytes = header_size;
+
+	long request_size = -1;
+	if (curl_easy_getinfo(handle, CURLINFO_REQUEST_SIZE, &request_size) == CURLE_OK)
+		timing.request_bytes = request_size;
+
+	return timing;
+}
+
+// the request gets one event, and each step gets its own event inside it, so they show up stacked under it in the viewer.
+void trace_request(const char* method, const std::string_view url, const net_response& response)
+{
+	if (!trace_enabled())
+		return;
+
+	const auto& timing = response.timing;
+	const auto end = std::chrono::steady_clock::now();
+	const auto us = [](long long count) { return std::chrono::microseconds(count > 0 ? count : 0); };
+	const auto start = end - us(timing.total_us);
+
+	trace_args args;
+	args.add("url", url).add("status", response.status_code)
+		.add("dns_us", timing.dns_us).add("connect_us", timing.connect_us).add("tls_us", timing.tls_us)
+		.add("first_byte_us", timing.first_byte_us).add("transfer_us", timing.transfer_us)
+		.add("wire_bytes", timing.wire_bytes).add("body_bytes", timing.body_bytes)
+		.add("header_bytes", timing.header_bytes).add("sent_bytes", timing.sent_bytes).add("request_bytes", timing.request_bytes);
+
+	trace_event(std::string{ method }.append(1, ' ').append(url), "net", start, us(timing.total_us), args);
+
+	if (timing.total_us < 0)
+		return;
+
+	trace_event("dns", "net", start, us(timing.dns_us));
+	trace_event("connect", "net", start + us(timing.dns_us), us(timing.connect_us));
+	trace_event("tls", "net", start + us(timing.dns_us + timing.connect_us), us(timing.tls_us));
+	trace_event("waiting for first byte", "net", end - us(timing.transfer_us + timing.first_byte_us), us(timing.first_byte_us));
+	trace_event("transfer", "net", end - us(timing.transfer_us), us(timing.transfer_us));
+}
+
+net_response handle_response(cpr::Response&& response, cpr::Session& session, const char* method, const std::string_view url)
 {
 	net_response to_return;
 
 	to_return.status_code = response.status_code;
 
+	to_return.timing = get_timing(session, response);
+	trace_request(method, url, to_return);
+
+	to_return.rate_limit.limit = header_to_int(response.header, "X-RateLimit-Limit");
+	to_return.rate_limit.remaining = header_to_int(response.header, "X-RateLimit-Remaining");
+	to_return.rate_limit.reset = header_or_empty(response.header, "X-RateLimit-Reset");
+
+	to_return.etag = header_or_empty(response.header, "ETag");
+	to_return.last_modified = header_or_empty(response.header, "Last-Modified");
+
 	to_return.retryable_error = response.error.code == cpr::ErrorCode::OPERATION_TIMEDOUT || (response.status_code >= 500 && response.status_code < 600);
 
 	// Some timeouts look like CONNECTION_FAILUREs and should be retried.
@@ -38,7 +153,8 @@ net_response handle_response(cpr::Response&& response)
 	}
 
 	// I think response.error refers to whether curl itself reported an error, as opposed to the remote server
-	to_return.okay = !response.error && response.status_code >= 200 && response.status_code < 300;
+	// a 304 only comes back from a conditional request, and it means whatever the caller already has is still good.
+	to_return.okay = !response.error && ((response.status_code >= 200 && response.status_code < 300) || response.status_code == 304);
 
 	// https://docs.joinmastodon.org/api/rate-limits/
 	if (response.status_code == 429)
@@ -68,32 +184,31 @@ constexpr auto idempotency_key_header{ "Idempotency-Key" };
 constexpr auto authorization_key_header{ "Authorization" };
 net_response simple_post(const std::string_view url, const std::string_view access_token)
 {
-	return handle_response(
-		cpr::Post(cpr::Url{ url },
-			cpr::Header{ { idempotency_key_header, std::string{ ensure_small_string(url) } } ,
-						 { authorization_key_header, make_bearer(access_token) } }
-		)
-	);
+	const pooled_session session{ url, request_kind::simple_post };
+	session->SetUrl(cpr::Url{ url });
+	session->SetHeader(cpr::Header{ { idempotency_key_header, std::string{ ensure_small_string(url) } } ,
+						 { authorization_key_header, make_bearer(access_token) } });
+	return handle_response(session->Post(), *session, "POST", url);
 }
 
 net_response simple_delete(const std::string_view url, const std::string_view access_token)
 {
-	return handle_response(
-		cpr::Delete(cpr::Url{ url },
-			cpr::Header{ {authorization_key_header, make_bearer(access_token) } })
-	);
+	const pooled_session session{ url, request_kind::del };
+	session->SetUrl(cpr::Url{ url });
+	session->SetHeader(cpr::Header{ {authorization_key_header, make_bearer(access_token) } });
+	return handle_response(session->Delete(), *session, "DELETE", url);
 }
 
 net_response upload_media(std::string_view url, std::string_view access_token, const fs::path& file, const std::string& description)
 {
-	return handle_response(
-		cpr::Post(cpr::Url{ url },
-			cpr::Header{ {authorization_key_header, make_bearer(access_token) } },
-			cpr::Multipart{ { "description", description },
-							{ "file", cpr::File{file.string()} } }
-			// cpr::File won't take a wchar string on Windows or a fs::path, so I think my best bet is to hope that .string()
-			// does whatever it does, and then CPR passes that on to the underlying filesystem unchanged and things will work out.
-	));
+	const pooled_session session{ url, request_kind::upload };
+	session->SetUrl(cpr::Url{ url });
+	session->SetHeader(cpr::Header{ {authorization_key_header, make_bearer(access_token) } });
+	session->SetMultipart(cpr::Multipart{ { "description", description },
+							{ "file", cpr::File{file.string()} } });
+	// cpr::File won't take a wchar string on Windows or a fs::path, so I think my best bet is to hope that .string()
+	// does whatever it does, and then CPR passes that on to the underlying filesystem unchanged and things will work out.
+	return handle_response(session->Post(), *session, "POST", url);
 }
 
 void add_if_value(cpr::Payload& params, const char* key, const std::string& value)
@@ -124,11 +239,12 @@ net_response new_status(std::string_view url, std::string_view access_token, con
 	add_array(post_params, "media_ids[]", params.attachment_ids);
 
 
-	return handle_response(
-		cpr::Post(cpr::Url{ url },
-			cpr::Header{ { idempotency_key_header, std::to_string(params.idempotency_key) },
-						 { authorization_key_header, make_bearer(access_token) } },
-			std::move(post_params)));
+	const pooled_session session{ url, request_kind::new_status };
+	session->SetUrl(cpr::Url{ url });
+	session->SetHeader(cpr::Header{ { idempotency_key_header, std::to_string(params.idempotency_key) },
+						 { authorization_key_header, make_bearer(access_token) } });
+	session->SetPayload(std::move(post_params));
+	return handle_response(session->Post(), *session, "POST", url);
 }
 
 void add_if_value(cpr::Parameters& params, const char* key, const std::string_view value)
@@ -155,10 +271,13 @@ net_response get_timeline_and_notifs(std::string_view url, std::string_view acce
 
 	if (params.exclude_notifs != nullptr) { add_array(query_params, "exclude_types[]", *params.exclude_notifs); }
 
-	return handle_response(
-		cpr::Get(cpr::Url{ url },
-			cpr::Header{ {authorization_key_header, make_bearer(access_token) } },
-			std::move(query_params)
-		)
-	);
+	const pooled_session session{ url, request_kind::get };
+	session->SetUrl(cpr::Url{ url });
+	cpr::Header headers{ {authorization_key_header, make_bearer(access_token) } };
+	if (!params.if_none_match.empty()) { headers.emplace("If-None-Match", params.if_none_match); }
+	if (!params.if_modified_since.empty()) { headers.emplace("If-Modified-Since", params.if_modified_since); }
+	session->SetHeader(std::move(headers));
+	// always set these, even if they're empty, so the last request's parameters don't stick around
+	session->SetParameters(std::move(query_params));
+	return handle_response(session->Get(), *session, "GET", url);
 }
@@ -0,0 +1,64 @@
+#include "session_pool.hpp"
+
+#include "../util/util.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// urls that don't have an instance in them just get pooled by the whole url, which is fine.
+std::string make_key(const std::string_view url, const request_kind kind)
+{
+	const auto instance = instance_of(url);
+	std::string key;
+	key.reserve(instance.size() + 1);
+	key.append(instance).push_back(static_cast<char>('0' + static_cast<uint8_t>(kind)));
+	return key;
+}
+
+class session_pool
+{
+public:
+	std::unique_ptr<cpr::Session> acquire(const std::string& key)
+	{
+		{
+			const std::lock_guard<std::mutex> lock{ pool_lock };
+			const auto idle = sessions.find(key);
+			if (idle != sessions.end() && !idle->second.empty())
+			{
+				auto session = std::move(idle->second.back());
+				idle->second.pop_back();
+				return session;
+			}
+		}
+
+		// making a new session doesn't connect to anything, so no need to hold the lock for it.
+		return std::make_unique<cpr::Session>();
+	}
+
+	void release(std::string&& key, std::unique_ptr<cpr::Session>&& session)
+	{
+		const std::lock_guard<std::mutex> lock{ pool_lock };
+		sessions[std::move(key)].push_back(std::move(session));
+	}
+
+private:
+	std::mutex pool_lock;
+	std::unordered_map<std::string, std::vector<std::unique_ptr<cpr::Session>>> sessions;
+};
+
+session_pool& pool()
+{
+	static session_pool pool;
+	return pool;
+}
+
+pooled_session::pooled_session(const std::string_view url, const request_kind kind) : key(make_key(url, kind)), session(pool().acquire(key))
+{
+}
+
+pooled_session::~pooled_session()
+{
+	pool().release(std::move(key), std::move(session));
+}
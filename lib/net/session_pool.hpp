@@ -0,0 +1,46 @@
+#ifndef MSYNC_SESSION_POOL_HPP
+#define MSYNC_SESSION_POOL_HPP
+
+#include <cpr/cpr.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// a cpr::Session holds on to a curl handle, and curl keeps connections open and caches TLS sessions per handle.
+// so, if every request to an instance goes through a session that's already been used, only the first request
+// pays for the TCP connection and the TLS handshake, and the rest just reuse the open connection.
+
+// sessions remember whatever options were set on them last (a payload, a multipart form, query parameters)
+// so, rather than try to scrub every option between requests, each kind of request gets its own sessions.
+// that way, a session only ever sees requests of the same shape, and setting the url, headers, and body overwrites everything.
+enum class request_kind : uint8_t
+{
+	get,
+	simple_post,
+	del,
+	new_status,
+	upload,
+};
+
+// borrows an idle session for this instance and request kind (or makes a new one) and gives it back when it goes out of scope.
+// sessions aren't thread safe, but the pool is, so it's fine to make requests from several threads at once-
+// each thread will just get its own session.
+class pooled_session
+{
+public:
+	pooled_session(std::string_view url, request_kind kind);
+	~pooled_session();
+
+	cpr::Session& operator*() const noexcept { return *session; }
+	cpr::Session* operator->() const noexcept { return session.get(); }
+
+	pooled_session(const pooled_session&) = delete;
+	pooled_session& operator=(const pooled_session&) = delete;
+
+private:
+	std::string key;
+	std::unique_ptr<cpr::Session> session;
+};
+
+#endif
@@ -7,12 +7,46 @@
 
 #include <filesystem.hpp>
 
+// what the X-RateLimit-* headers said. Mastodon sends these on every response, not just 429s.
+// https://docs.joinmastodon.org/api/rate-limits/
+struct rate_limit_info
+{
+	int limit = -1; // -1 means the header wasn't there
+	int remaining = -1;
+	std::string reset; // an ISO 8601 timestamp
+};
+
+// where a request's time went, according to curl. The times are in microseconds, and every field is -1 if curl didn't say.
+// if a connection got reused, the DNS, connect, and TLS times are zero.
+struct transfer_timing
+{
+	long long dns_us = -1;
+	long long connect_us = -1;
+	long long tls_us = -1;
+	long long first_byte_us = -1; // from sending the request to the first byte of the response coming back
+	long long transfer_us = -1; // from the first byte to the last one
+	long long total_us = -1;
+
+	long long wire_bytes = -1; // the body as it came over the network, so compressed if the server compressed it
+	long long body_bytes = -1; // the body after curl decompressed it
+	long long header_bytes = -1;
+	long long sent_bytes = -1; // the request body
+	long long request_bytes = -1; // the request line and headers, plus the body if it was small enough to go out with them
+};
+
 struct net_response
 {
 	int status_code = 200;
 	bool retryable_error = false;
 	bool okay = true;
 	std::string message;
+	rate_limit_info rate_limit;
+
+	// the ETag and Last-Modified headers, if the server sent them. Send them back later to ask if anything's changed.
+	std::string etag;
+	std::string last_modified;
+
+	transfer_timing timing;
 };
 
 struct status_params
@@ -31,6 +65,10 @@ struct timeline_params
 	std::string_view max_id;
 	std::string_view since_id;
 	std::vector<std::string_view>* exclude_notifs = nullptr;
+
+	// if either of these are set, the request is conditional, and the server can answer with a 304 and no body if nothing's changed.
+	std::string_view if_none_match;
+	std::string_view if_modified_since;
 };
 
 using post_request = net_response (std::string_view url, std::string_view access_token);
@@ -47,6 +85,8 @@ inline constexpr const char* get_error_message(const int status_code, const bool
 	case 201:
 	case 204:
 		return verbose ? "OK\n" : "";
+	case 304:
+		return verbose ? "Not modified\n" : "";
 
 	case 400:
 		return "Bad request. This is probably a programming error. Sorry about that.\n";
@@ -43,12 +43,14 @@ enum class user_option
 	last_dm_id,
 	last_bookmark_id,
 	last_notification_id,
+	max_bytes,
 	is_default,
 	exclude_follows,
 	exclude_favs,
 	exclude_boosts,
 	exclude_mentions,
 	exclude_polls,
+	post_store,
 	pull_home,
 	pull_dms,
 	pull_bookmarks,
@@ -59,8 +61,9 @@ constexpr auto USER_OPTION_NAMES =
 	std::array<std::string_view,
 			   static_cast<int>(user_option::pull_notifications) + 1>(
 		{"file_version", "account_name", "instance_url", "auth_code", "access_token", "client_secret", "client_id",
-				   "last_home_id", "last_dm_id", "last_bookmark_id", "last_notification_id", 
+				   "last_home_id", "last_dm_id", "last_bookmark_id", "last_notification_id", "max_bytes",
 				   "is_default",
 				   "exclude_follows", "exclude_favs", "exclude_boosts", "exclude_mentions", "exclude_polls",
+				   "post_store",
 		 "pull_home", "pull_dms", "pull_bookmarks", "pull_notifications"});
 #endif
@@ -8,7 +8,7 @@ bool Read(std::map<std::string, std::string, std::less<>>& parsed, std::string&&
 }
 
 
-void Write(std::map<std::string, std::string, std::less<>>&& map, std::ofstream& of)
+void Write(std::map<std::string, std::string, std::less<>>&& map, std::ostream& of)
 {
 	using namespace std::string_literals;
 	map.try_emplace("file_version"s, "1"s);
@@ -9,7 +9,7 @@
 // adding this std::less<> thing makes the comparators "transparent", which means
 // that using, say, a string view as a key doesn't make you construct a new string.
 bool Read(std::map<std::string, std::string, std::less<>>&, std::string&&);
-void Write(std::map<std::string, std::string, std::less<>>&&, std::ofstream&);
+void Write(std::map<std::string, std::string, std::less<>>&&, std::ostream&);
 
 using option_file = file_backed<std::map<std::string, std::string, std::less<>>, Read, Write>;
 
@@ -95,7 +95,7 @@ bool Read(post_content& post, std::string&& line)
 	return true;
 }
 
-void Write(post_content&& post, std::ofstream& of)
+void Write(post_content&& post, std::ostream& of)
 {
 	if (!post.content_warning.empty())
 	{
@@ -33,7 +33,7 @@ struct post_content
 };
 
 bool Read(post_content&, std::string&&);
-void Write(post_content&&, std::ofstream&);
+void Write(post_content&&, std::ostream&);
 
 using outgoing_post = file_backed<post_content, Read, Write, false, false, false>;
 using readonly_outgoing_post = file_backed<post_content, Read, Write, false, false, true>;
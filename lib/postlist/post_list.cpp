@@ -1,58 +1,84 @@
 #include "post_list.hpp"
 
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <type_traits>
 
-void print(std::ostream& out, const char* key, const std::string& val, bool newline = true)
+// everything gets written into one string and handed to the stream all at once,
+// which is a lot cheaper than a couple dozen little << calls per post.
+
+template <typename number_type>
+void append_number(std::string& out, const number_type number)
+{
+	// big enough for a 64 bit integer or a double with six significant digits, with room to spare
+	std::array<char, 32> buffer;
+#if defined(__cpp_lib_to_chars)
+	// precision 6 in general format is what an ostream does with a double by default, so the text comes out the same
+	std::to_chars_result result;
+	if constexpr (std::is_floating_point_v<number_type>)
+		result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number, std::chars_format::general, 6);
+	else
+		result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number);
+	out.append(buffer.data(), result.ptr - buffer.data());
+#else
+	// some standard libraries don't have to_chars for doubles yet. %g is the same format the ostream would use.
+	int written;
+	if constexpr (std::is_floating_point_v<number_type>)
+		written = std::snprintf(buffer.data(), buffer.size(), "%g", static_cast<double>(number));
+	else if constexpr (std::is_signed_v<number_type>)
+		written = std::snprintf(buffer.data(), buffer.size(), "%lld", static_cast<long long>(number));
+	else
+		written = std::snprintf(buffer.data(), buffer.size(), "%llu", static_cast<unsigned long long>(number));
+	out.append(buffer.data(), written);
+#endif
+}
+
+void print(std::string& out, const std::string_view key, const std::string& val, bool newline = true)
 {
 	if (!val.empty())
 	{
-		out << key << val;
+		out.append(key).append(val);
 		if (newline)
-			out << '\n';
+			out.push_back('\n');
 	}
 }
 
-void print_author(std::ostream& out, const char* key, const std::string& display_name, const std::string& account, bool bot, bool newline = true)
+void print_author(std::string& out, const std::string_view key, const std::string& display_name, const std::string& account, bool bot, bool newline = true)
 { 
 	// this is so that posts that aren't boosts don't print that boosted_by section
 	if (account.empty()) { return; }
 
-	out << key << display_name << " (@" << account << ')';
+	out.append(key).append(display_name).append(" (@").append(account).push_back(')');
 
-	if (bot) out << " [bot]";
+	if (bot) out.append(" [bot]");
 
-	if (newline) out << '\n';
+	if (newline) out.push_back('\n');
 }
 
-void print(std::ostream& out, const char* key, bool val, bool newline = true)
-{
-	if (val)
-	{
-		out << key;
-		if (newline)
-			out << '\n';
-	}
-}
-
-std::ostream& operator<<(std::ostream& out, const mastodon_poll& poll)
+void append_post(std::string& out, const mastodon_poll& poll)
 {
 	print(out, "poll id: ", poll.id);
 	print(out, poll.expired ? "expired at: " : "expires at: ", poll.expires_at);
 	for (size_t i = 0; i < poll.options.size(); ++i)
 	{
-		out << " - " << poll.options[i].title << ' ' << 
-			poll.options[i].votes << '/' << poll.total_votes << " votes (" << (poll.total_votes == 0 ? 0 : ((double)poll.options[i].votes / poll.total_votes) * 100) << "%)";
+		out.append(" - ").append(poll.options[i].title).push_back(' ');
+		append_number(out, poll.options[i].votes);
+		out.push_back('/');
+		append_number(out, poll.total_votes);
+		out.append(" votes (");
+		append_number(out, poll.total_votes == 0 ? 0 : ((double)poll.options[i].votes / poll.total_votes) * 100);
+		out.append("%)");
 		if (std::find(poll.voted_for.begin(), poll.voted_for.end(), i) != poll.voted_for.end())
 		{
-			out << " [your vote]";
+			out.append(" [your vote]");
 		}
-		out << '\n';
+		out.push_back('\n');
 	}
-
-	return out;
 }
 
-std::ostream& operator<<(std::ostream& out, const mastodon_status& status)
+void append_post(std::string& out, const mastodon_status& status)
 {
 	print(out, "status id: ", status.id);
 	print(out, "url: ", status.url);
@@ -65,23 +91,26 @@ std::ostream& operator<<(std::ostream& out, const mastodon_status& status)
 
 	for (const auto& attachment : status.attachments)
 	{
-		out << "attached: " << attachment.url << '\n';
+		out.append("attached: ").append(attachment.url).push_back('\n');
 		if (!attachment.description.empty())
 		{
-			out << "description: " << attachment.description << '\n';
+			out.append("description: ").append(attachment.description).push_back('\n');
 		}
 	}
 
 	if (status.poll.has_value())
 	{
-		out << *status.poll;
+		append_post(out, *status.poll);
 	}
 
 	print(out, "visibility: ", status.visibility);
 	print(out, "posted on: ", status.created_at);
-	out << status.favorites << " favs | " << status.boosts << " boosts | " << status.replies << " replies";
-
-	return out;
+	append_number(out, status.favorites);
+	out.append(" favs | ");
+	append_number(out, status.boosts);
+	out.append(" boosts | ");
+	append_number(out, status.replies);
+	out.append(" replies");
 }
 
 const char* notification_verb(notif_type t)
@@ -103,18 +132,39 @@ const char* notification_verb(notif_type t)
 	}
 }
 
-std::ostream& operator<<(std::ostream& out, const mastodon_notification& notification)
+void append_post(std::string& out, const mastodon_notification& notification)
 {
-	out << "notification id: " << notification.id << '\n';
-	out << "at " << notification.created_at << ", ";
+	out.append("notification id: ").append(notification.id).push_back('\n');
+	out.append("at ").append(notification.created_at).append(", ");
 	print_author(out, "", notification.account.display_name, notification.account.account_name, notification.account.is_bot, false);
-	out << notification_verb(notification.type);
+	out.append(notification_verb(notification.type));
 
 	if (notification.status.has_value())
 	{
-		out << '\n';
-		out << *notification.status;
+		out.push_back('\n');
+		append_post(out, *notification.status);
 	}
+}
+
+template <typename post_type>
+std::ostream& write_post(std::ostream& out, const post_type& post)
+{
+	std::string text;
+	append_post(text, post);
+	return out.write(text.data(), text.size());
+}
+
+std::ostream& operator<<(std::ostream& out, const mastodon_poll& poll)
+{
+	return write_post(out, poll);
+}
 
-	return out;
+std::ostream& operator<<(std::ostream& out, const mastodon_status& status)
+{
+	return write_post(out, status);
+}
+
+std::ostream& operator<<(std::ostream& out, const mastodon_notification& notification)
+{
+	return write_post(out, notification);
 }
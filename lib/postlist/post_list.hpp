@@ -4,6 +4,8 @@
 #include <filesystem.hpp>
 
 #include <fstream>
+#include <string>
+#include <string_view>
 
 #include "../entities/entities.hpp"
 
@@ -11,6 +13,14 @@ std::ostream& operator<<(std::ostream& out, const mastodon_status& status);
 std::ostream& operator<<(std::ostream& out, const mastodon_notification& notification);
 std::ostream& operator<<(std::ostream& out, const mastodon_poll& poll);
 
+// these append the same text the operator<<s write to the end of out.
+void append_post(std::string& out, const mastodon_status& status);
+void append_post(std::string& out, const mastodon_notification& notification);
+void append_post(std::string& out, const mastodon_poll& poll);
+
+// goes after every post in a .list file.
+inline constexpr std::string_view post_separator = "\n--------------\n";
+
 template <typename post_type>
 class post_list
 {
@@ -24,12 +34,36 @@ public:
 
 	void write(const post_type& post)
 	{
-		// this assumes that the operator<< for post doesn't add a newline at the end
-		outfile << post;
-		outfile << "\n--------------\n";
+		write(&post, &post + 1);
+	}
+
+	// writes a whole page of posts, from first to last, with one write.
+	// pages come from the API newest first, so pass reverse iterators to get the newest at the bottom.
+	template <typename iterator>
+	void write(iterator first, iterator last)
+	{
+		page.clear();
+		for (; first != last; ++first)
+		{
+			// this assumes that append_post doesn't add a newline at the end
+			append_post(page, *first);
+			page.append(post_separator);
+		}
+		outfile.write(page.data(), page.size());
+	}
+
+	// hands everything written so far to the OS, so it's there even if msync dies right after.
+	// returns false if any of the writes so far didn't work out.
+	bool flush()
+	{
+		outfile.flush();
+		return outfile.good();
 	}
 
 private:
 	std::ofstream outfile;
+
+	// kept around so that its memory gets reused from page to page
+	std::string page;
 };
 #endif
@@ -0,0 +1,93 @@
+#include "reverse_post_reader.hpp"
+
+#include "post_list.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <algorithm>
+
+reverse_post_reader::reverse_post_reader(const fs::path& filename, size_t chunk) : file(filename.c_str(), std::ios::binary | std::ios::in), chunk_size(std::max<size_t>(chunk, 1))
+{
+	if (!file.is_open())
+		return;
+
+	file.seekg(0, std::ios::end);
+	const auto size = file.tellg();
+	if (size > 0)
+		buffer_start = unread_end = static_cast<uint64_t>(size);
+}
+
+bool reverse_post_reader::read_previous_chunk()
+{
+	if (buffer_start == 0)
+		return false;
+
+	// line the reads up on chunk boundaries so they're the same blocks the disk and the page cache deal in
+	const uint64_t chunk_start = (buffer_start - 1) / chunk_size * chunk_size;
+	const auto length = static_cast<size_t>(buffer_start - chunk_start);
+
+	std::string chunk(length, '\0');
+	file.seekg(static_cast<std::streamoff>(chunk_start));
+	file.read(chunk.data(), static_cast<std::streamsize>(length));
+	if (static_cast<size_t>(file.gcount()) != length)
+		throw msync_exception("Couldn't read a post list. It might have been changed while it was being read.");
+
+	buffer.insert(0, chunk);
+	buffer_start = chunk_start;
+	return true;
+}
+
+std::optional<std::string> reverse_post_reader::next()
+{
+	if (unread_end == 0)
+		return std::nullopt;
+
+	const size_t separator_size = post_separator.size();
+
+	// every post has a separator after it, but the last one might not if the file got cut off or edited
+	while (unread_end - buffer_start < separator_size && read_previous_chunk()) { }
+
+	uint64_t post_end = unread_end;
+	if (unread_end - buffer_start >= separator_size && std::string_view{ buffer }.substr(static_cast<size_t>(unread_end - buffer_start) - separator_size) == post_separator)
+		post_end -= separator_size;
+
+	// the post starts right after the separator before it, or at the beginning of the file if there isn't one
+	uint64_t post_start = 0;
+	if (post_end >= separator_size)
+	{
+		// the last place a separator could start without running into the post's end.
+		// every time a chunk comes up empty, only the newly read part gets searched
+		uint64_t search_from = post_end - separator_size;
+		while (true)
+		{
+			if (search_from >= buffer_start)
+			{
+				const auto found = buffer.rfind(post_separator.data(), static_cast<size_t>(search_from - buffer_start), separator_size);
+				if (found != std::string::npos)
+				{
+					post_start = buffer_start + found + separator_size;
+					break;
+				}
+			}
+
+			if (buffer_start == 0)
+				break;
+
+			// a separator that starts in the next chunk could run into this one
+			search_from = std::min<uint64_t>(search_from, buffer_start - 1);
+			read_previous_chunk();
+		}
+	}
+	else
+	{
+		while (read_previous_chunk()) { }
+	}
+
+	std::string post = buffer.substr(static_cast<size_t>(post_start - buffer_start), static_cast<size_t>(post_end - post_start));
+
+	// nobody needs anything after this post again
+	unread_end = post_start;
+	buffer.resize(static_cast<size_t>(unread_end - buffer_start));
+
+	return post;
+}
@@ -0,0 +1,38 @@
+#ifndef MSYNC_REVERSE_POST_READER_HPP
+#define MSYNC_REVERSE_POST_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include <filesystem.hpp>
+
+// reads a .list file written by post_list from the end, one post at a time, newest first.
+// the file is read backwards in big chunks that start on a multiple of chunk_size, so getting the last few posts
+// out of a huge file only reads the last chunk or two instead of the whole thing.
+// a missing file is just empty.
+class reverse_post_reader
+{
+public:
+	explicit reverse_post_reader(const fs::path& file, size_t chunk_size = 1024 * 1024);
+
+	// the next post going backwards, without the separator after it, or nothing once the start of the file is reached.
+	std::optional<std::string> next();
+
+private:
+	// reads the chunk before buffer_start into the front of the buffer. Returns false if there's nothing before it.
+	bool read_previous_chunk();
+
+	std::ifstream file;
+	const size_t chunk_size;
+
+	// buffer holds the file from buffer_start up to unread_end.
+	// everything after unread_end has already been handed out.
+	std::string buffer;
+	uint64_t buffer_start = 0;
+	uint64_t unread_end = 0;
+};
+
+#endif
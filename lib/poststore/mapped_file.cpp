@@ -0,0 +1,138 @@
+#include "mapped_file.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string make_map_error(const fs::path& file)
+{
+	return std::string{ "Couldn't read " }.append(file.string()).append(1, '.');
+}
+
+#ifdef _WIN32
+mapped_file::mapped_file(const fs::path& file)
+{
+	const HANDLE handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return;
+
+	file_handle = handle;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size))
+	{
+		unmap();
+		throw msync_exception(make_map_error(file));
+	}
+
+	// you can't map an empty file on Windows, but there's nothing to see in one anyway.
+	if (file_size.QuadPart == 0)
+		return;
+
+	mapping_handle = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle == nullptr)
+	{
+		unmap();
+		throw msync_exception(make_map_error(file));
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		unmap();
+		throw msync_exception(make_map_error(file));
+	}
+
+	size = static_cast<size_t>(file_size.QuadPart);
+}
+
+void mapped_file::unmap() noexcept
+{
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping_handle != nullptr)
+		CloseHandle(mapping_handle);
+	if (file_handle != nullptr)
+		CloseHandle(file_handle);
+
+	data = nullptr;
+	size = 0;
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+}
+#else
+mapped_file::mapped_file(const fs::path& file)
+{
+	const int descriptor = open(file.c_str(), O_RDONLY);
+	if (descriptor == -1)
+		return;
+
+	struct stat file_info {};
+	if (fstat(descriptor, &file_info) != 0)
+	{
+		close(descriptor);
+		throw msync_exception(make_map_error(file));
+	}
+
+	if (file_info.st_size == 0)
+	{
+		close(descriptor);
+		return;
+	}
+
+	void* const mapped = mmap(nullptr, static_cast<size_t>(file_info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+
+	// the mapping hangs on to the file by itself, so there's no need to keep the descriptor around
+	close(descriptor);
+
+	if (mapped == MAP_FAILED)
+		throw msync_exception(make_map_error(file));
+
+	data = static_cast<const char*>(mapped);
+	size = static_cast<size_t>(file_info.st_size);
+}
+
+void mapped_file::unmap() noexcept
+{
+	if (data != nullptr)
+		munmap(const_cast<char*>(data), size);
+
+	data = nullptr;
+	size = 0;
+}
+#endif
+
+mapped_file::~mapped_file()
+{
+	unmap();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	unmap();
+	std::swap(data, other.data);
+	std::swap(size, other.size);
+#ifdef _WIN32
+	std::swap(file_handle, other.file_handle);
+	std::swap(mapping_handle, other.mapping_handle);
+#endif
+	return *this;
+}
@@ -0,0 +1,38 @@
+#ifndef MSYNC_MAPPED_FILE_HPP
+#define MSYNC_MAPPED_FILE_HPP
+
+#include <string_view>
+#include <cstddef>
+
+#include <filesystem.hpp>
+
+// a read-only view of a whole file, mapped into memory so that only the parts that actually get looked at are read off the disk.
+// an empty or missing file just gives an empty view.
+class mapped_file
+{
+public:
+	mapped_file() noexcept = default;
+	explicit mapped_file(const fs::path& file);
+	~mapped_file();
+
+	mapped_file(mapped_file&& other) noexcept;
+	mapped_file& operator=(mapped_file&& other) noexcept;
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	std::string_view view() const noexcept { return { data, size }; }
+
+private:
+	void unmap() noexcept;
+
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
+
+#endif
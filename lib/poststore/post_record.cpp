@@ -0,0 +1,246 @@
+#include "post_record.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <cstdint>
+
+constexpr uint8_t record_version = 1;
+
+void append_u32(std::string& out, const uint32_t value)
+{
+	for (int shift = 0; shift < 32; shift += 8)
+		out.push_back(static_cast<char>((value >> shift) & 0xff));
+}
+
+void append_string(std::string& out, const std::string& str)
+{
+	append_u32(out, static_cast<uint32_t>(str.size()));
+	out.append(str);
+}
+
+void append_bool(std::string& out, const bool value)
+{
+	out.push_back(value ? 1 : 0);
+}
+
+void append_account(std::string& out, const mastodon_account& account)
+{
+	append_string(out, account.id);
+	append_string(out, account.account_name);
+	append_string(out, account.display_name);
+	append_string(out, account.note);
+	append_string(out, account.url);
+	append_string(out, account.avatar);
+	append_bool(out, account.is_bot);
+	append_u32(out, static_cast<uint32_t>(account.fields.size()));
+	for (const auto& field : account.fields)
+	{
+		append_string(out, field.name);
+		append_string(out, field.value);
+	}
+}
+
+void append_poll(std::string& out, const mastodon_poll& poll)
+{
+	append_string(out, poll.id);
+	append_string(out, poll.expires_at);
+	append_bool(out, poll.expired);
+	append_u32(out, static_cast<uint32_t>(poll.total_votes));
+	append_bool(out, poll.you_voted);
+	append_u32(out, static_cast<uint32_t>(poll.voted_for.size()));
+	for (const auto vote : poll.voted_for)
+		append_u32(out, static_cast<uint32_t>(vote));
+	append_u32(out, static_cast<uint32_t>(poll.options.size()));
+	for (const auto& option : poll.options)
+	{
+		append_string(out, option.title);
+		append_u32(out, static_cast<uint32_t>(option.votes));
+	}
+}
+
+void append_status(std::string& out, const mastodon_status& status)
+{
+	append_string(out, status.id);
+	append_string(out, status.url);
+	append_string(out, status.content_warning);
+	append_string(out, status.content);
+	append_string(out, status.visibility);
+	append_string(out, status.created_at);
+	append_string(out, status.reply_to_post_id);
+	append_string(out, status.original_post_url);
+	append_string(out, status.boosted_by);
+	append_string(out, status.boosted_by_display_name);
+	append_bool(out, status.boosted_by_bot);
+	append_u32(out, status.favorites);
+	append_u32(out, status.boosts);
+	append_u32(out, status.replies);
+	append_u32(out, static_cast<uint32_t>(status.attachments.size()));
+	for (const auto& attachment : status.attachments)
+	{
+		append_string(out, attachment.url);
+		append_string(out, attachment.description);
+	}
+	append_account(out, status.author);
+	append_bool(out, status.poll.has_value());
+	if (status.poll.has_value())
+		append_poll(out, *status.poll);
+}
+
+void append_record(std::string& out, const mastodon_status& status)
+{
+	out.push_back(static_cast<char>(record_version));
+	append_status(out, status);
+}
+
+void append_record(std::string& out, const mastodon_notification& notification)
+{
+	out.push_back(static_cast<char>(record_version));
+	append_string(out, notification.id);
+	out.push_back(static_cast<char>(notification.type));
+	append_string(out, notification.created_at);
+	append_account(out, notification.account);
+	append_bool(out, notification.status.has_value());
+	if (notification.status.has_value())
+		append_status(out, *notification.status);
+}
+
+struct record_reader
+{
+	std::string_view remaining;
+
+	void need(size_t count) const
+	{
+		if (remaining.size() < count)
+			throw msync_exception("A post in the post store is cut off. The store might be damaged.");
+	}
+
+	uint8_t byte()
+	{
+		need(1);
+		const auto value = static_cast<uint8_t>(remaining[0]);
+		remaining.remove_prefix(1);
+		return value;
+	}
+
+	uint32_t u32()
+	{
+		need(4);
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= static_cast<uint32_t>(static_cast<uint8_t>(remaining[i])) << (i * 8);
+		remaining.remove_prefix(4);
+		return value;
+	}
+
+	void string(std::string& out)
+	{
+		const auto size = u32();
+		need(size);
+		out.assign(remaining.data(), size);
+		remaining.remove_prefix(size);
+	}
+
+	bool boolean()
+	{
+		return byte() != 0;
+	}
+
+	// every element of a list takes at least a byte, so a damaged count can't make anyone allocate more than the record's size
+	size_t count()
+	{
+		const auto size = u32();
+		need(size);
+		return size;
+	}
+};
+
+void read_account_fields(record_reader& in, mastodon_account& account)
+{
+	in.string(account.id);
+	in.string(account.account_name);
+	in.string(account.display_name);
+	in.string(account.note);
+	in.string(account.url);
+	in.string(account.avatar);
+	account.is_bot = in.boolean();
+	account.fields.resize(in.count());
+	for (auto& field : account.fields)
+	{
+		in.string(field.name);
+		in.string(field.value);
+	}
+}
+
+void read_poll_fields(record_reader& in, mastodon_poll& poll)
+{
+	in.string(poll.id);
+	in.string(poll.expires_at);
+	poll.expired = in.boolean();
+	poll.total_votes = static_cast<int>(in.u32());
+	poll.you_voted = in.boolean();
+	poll.voted_for.resize(in.count());
+	for (auto& vote : poll.voted_for)
+		vote = static_cast<int>(in.u32());
+	poll.options.resize(in.count());
+	for (auto& option : poll.options)
+	{
+		in.string(option.title);
+		option.votes = static_cast<int>(in.u32());
+	}
+}
+
+void read_status_fields(record_reader& in, mastodon_status& status)
+{
+	in.string(status.id);
+	in.string(status.url);
+	in.string(status.content_warning);
+	in.string(status.content);
+	in.string(status.visibility);
+	in.string(status.created_at);
+	in.string(status.reply_to_post_id);
+	in.string(status.original_post_url);
+	in.string(status.boosted_by);
+	in.string(status.boosted_by_display_name);
+	status.boosted_by_bot = in.boolean();
+	status.favorites = in.u32();
+	status.boosts = in.u32();
+	status.replies = in.u32();
+	status.attachments.resize(in.count());
+	for (auto& attachment : status.attachments)
+	{
+		in.string(attachment.url);
+		in.string(attachment.description);
+	}
+	read_account_fields(in, status.author);
+	if (in.boolean())
+		read_poll_fields(in, status.poll.emplace());
+	else
+		status.poll.reset();
+}
+
+void check_version(record_reader& in)
+{
+	if (in.byte() > record_version)
+		throw msync_exception("A post in the post store was written by a newer version of msync. Try updating msync.");
+}
+
+void read_record(const std::string_view record, mastodon_status& status)
+{
+	record_reader in{ record };
+	check_version(in);
+	read_status_fields(in, status);
+}
+
+void read_record(const std::string_view record, mastodon_notification& notification)
+{
+	record_reader in{ record };
+	check_version(in);
+	in.string(notification.id);
+	notification.type = static_cast<notif_type>(in.byte());
+	in.string(notification.created_at);
+	read_account_fields(in, notification.account);
+	if (in.boolean())
+		read_status_fields(in, notification.status.emplace());
+	else
+		notification.status.reset();
+}
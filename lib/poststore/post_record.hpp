@@ -0,0 +1,21 @@
+#ifndef MSYNC_POST_RECORD_HPP
+#define MSYNC_POST_RECORD_HPP
+
+#include <string>
+#include <string_view>
+
+#include "../entities/entities.hpp"
+
+// the binary form of a post, as it's kept in the post store's segment files.
+// numbers are little endian and strings are a length followed by their bytes, so a record reads the same on any machine.
+// each record starts with a version byte, so that old records can still be read if any fields get added later.
+
+// appends the record for this post to out.
+void append_record(std::string& out, const mastodon_status& status);
+void append_record(std::string& out, const mastodon_notification& notification);
+
+// throws an msync_exception if the record is cut off or from a newer version of msync.
+void read_record(std::string_view record, mastodon_status& status);
+void read_record(std::string_view record, mastodon_notification& notification);
+
+#endif
@@ -0,0 +1,400 @@
+#include "post_store.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <print_logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+constexpr std::string_view ids_index_filename = "ids.idx";
+constexpr std::string_view created_at_index_filename = "created_at.idx";
+
+// start a new segment once the current one is bigger than this.
+constexpr uint64_t max_segment_size = 64 * 1024 * 1024;
+
+constexpr size_t id_key_offset = 0;
+constexpr size_t created_at_key_offset = store_key_size;
+constexpr size_t location_offset = store_key_size * 2;
+
+fs::path segment_path(const fs::path& directory, uint32_t number)
+{
+	std::string filename(8, '0');
+	for (auto digit = filename.rbegin(); digit != filename.rend() && number != 0; ++digit)
+	{
+		*digit = static_cast<char>('0' + number % 10);
+		number /= 10;
+	}
+	filename += ".seg";
+	return directory / filename;
+}
+
+void write_u32(char* out, const uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out[i] = static_cast<char>((value >> (i * 8)) & 0xff);
+}
+
+void write_u64(char* out, const uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		out[i] = static_cast<char>((value >> (i * 8)) & 0xff);
+}
+
+uint64_t read_le(const char* in, int bytes)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (i * 8);
+	return value;
+}
+
+// returns false if the key's too long to fit.
+bool write_key(char* out, const std::string_view key)
+{
+	if (key.size() > store_key_size)
+		return false;
+
+	std::memset(out, 0, store_key_size - key.size());
+	std::memcpy(out + (store_key_size - key.size()), key.data(), key.size());
+	return true;
+}
+
+std::array<char, store_key_size> make_key(const std::string_view key)
+{
+	std::array<char, store_key_size> toreturn;
+	if (!write_key(toreturn.data(), key))
+		throw msync_exception(std::string{ "Can't put a post in the post store because this is too long to index: " }.append(key));
+	return toreturn;
+}
+
+int compare_keys(const char* first, const char* second)
+{
+	return std::memcmp(first, second, store_key_size);
+}
+
+bool id_less(const index_entry& first, const index_entry& second)
+{
+	return compare_keys(first.data() + id_key_offset, second.data() + id_key_offset) < 0;
+}
+
+// ties go by ID, so the order's always the same.
+bool created_at_less(const char* first, const char* second)
+{
+	const auto by_time = compare_keys(first + created_at_key_offset, second + created_at_key_offset);
+	if (by_time != 0)
+		return by_time < 0;
+	return compare_keys(first + id_key_offset, second + id_key_offset) < 0;
+}
+
+store_location location_of(const char* entry)
+{
+	store_location toreturn;
+	toreturn.segment = static_cast<uint32_t>(read_le(entry + location_offset, 4));
+	toreturn.length = static_cast<uint32_t>(read_le(entry + location_offset + 4, 4));
+	toreturn.offset = read_le(entry + location_offset + 8, 8);
+	return toreturn;
+}
+
+size_t entry_count(const std::string_view index)
+{
+	return index.size() / index_entry_size;
+}
+
+const char* entry_at(const std::string_view index, const size_t idx)
+{
+	return index.data() + idx * index_entry_size;
+}
+
+post_store_writer::post_store_writer(fs::path dir) : directory(std::move(dir))
+{
+	fs::create_directories(directory);
+
+	// pick up where the last writer left off
+	uint32_t last_segment = 1;
+	while (fs::exists(segment_path(directory, last_segment + 1)))
+		last_segment++;
+
+	start_segment(last_segment);
+}
+
+post_store_writer::~post_store_writer()
+{
+	try
+	{
+		flush();
+	}
+	catch (const std::exception& e)
+	{
+		pl() << "Couldn't update the post store index in " << directory << ": " << e.what() << '\n';
+	}
+}
+
+void post_store_writer::start_segment(const uint32_t number)
+{
+	segment.close();
+
+	const auto path = segment_path(directory, number);
+	segment.open(path.c_str(), std::ios::binary | std::ios::app | std::ios::ate | std::ios::out);
+	if (!segment.is_open())
+		throw msync_exception(std::string{ "Couldn't open " }.append(path.string()).append(" to write posts to."));
+
+	segment_number = number;
+	segment_size = static_cast<uint64_t>(segment.tellp());
+}
+
+void post_store_writer::append(const std::string_view id, const std::string_view created_at, const std::string_view record)
+{
+	if (segment_size >= max_segment_size)
+		start_segment(segment_number + 1);
+
+	index_entry entry;
+	const auto id_key = make_key(id);
+	std::copy(id_key.begin(), id_key.end(), entry.begin() + id_key_offset);
+
+	// a timestamp that's too long to index just sorts first. Anything that comes from Mastodon will fit.
+	if (!write_key(entry.data() + created_at_key_offset, created_at))
+		std::fill(entry.begin() + created_at_key_offset, entry.begin() + location_offset, '\0');
+
+	char length[4];
+	write_u32(length, static_cast<uint32_t>(record.size()));
+	segment.write(length, sizeof(length));
+	segment_size += sizeof(length);
+
+	write_u32(entry.data() + location_offset, segment_number);
+	write_u32(entry.data() + location_offset + 4, static_cast<uint32_t>(record.size()));
+	write_u64(entry.data() + location_offset + 8, segment_size);
+
+	segment.write(record.data(), record.size());
+	segment_size += record.size();
+
+	// a post that didn't make it to the disk can't go in the index
+	if (!segment)
+		throw msync_exception(std::string{ "Couldn't write a post to " }.append(segment_path(directory, segment_number).string()).append(". The disk might be full."));
+
+	pending.push_back(entry);
+}
+
+// the new index goes in a temporary file that gets moved over the old one afterwards, so a crash partway through leaves the old index alone.
+fs::path temp_index_path(const fs::path& index_file)
+{
+	auto temp_file = index_file;
+	temp_file += ".tmp";
+	return temp_file;
+}
+
+template <typename write_entries>
+void write_index(const fs::path& temp_file, write_entries write)
+{
+	std::ofstream out{ temp_file.c_str(), std::ios::binary | std::ios::trunc };
+	write(out);
+	if (!out)
+		throw msync_exception(std::string{ "Couldn't write " }.append(temp_file.string()));
+}
+
+void post_store_writer::flush()
+{
+	if (pending.empty())
+		return;
+
+	// the indexes can't point at anything that isn't on the disk yet
+	segment.flush();
+	if (!segment)
+		throw msync_exception(std::string{ "Couldn't write posts to " }.append(segment_path(directory, segment_number).string()).append(". The disk might be full."));
+
+	// if the same ID got written twice, only keep the last one
+	std::stable_sort(pending.begin(), pending.end(), id_less);
+	std::vector<index_entry> by_id;
+	by_id.reserve(pending.size());
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		if (i + 1 < pending.size() && !id_less(pending[i], pending[i + 1]))
+			continue;
+		by_id.push_back(pending[i]);
+	}
+
+	const auto is_replaced = [&by_id](const char* old_entry)
+	{
+		const auto found = std::lower_bound(by_id.begin(), by_id.end(), old_entry, [](const index_entry& entry, const char* key)
+		{
+			return compare_keys(entry.data() + id_key_offset, key + id_key_offset) < 0;
+		});
+		return found != by_id.end() && compare_keys(found->data() + id_key_offset, old_entry + id_key_offset) == 0;
+	};
+
+	// the old index has to be unmapped before the new one can be moved over it, at least on Windows
+	const auto ids_file = directory / ids_index_filename;
+	{
+		const mapped_file old_ids{ ids_file };
+		const auto old = old_ids.view();
+
+		write_index(temp_index_path(ids_file), [&](std::ofstream& out)
+		{
+			size_t old_idx = 0;
+			const size_t old_count = entry_count(old);
+			for (const auto& entry : by_id)
+			{
+				// everything older that sorts before this one goes first, and an older entry with the same ID gets dropped
+				while (old_idx < old_count && compare_keys(entry_at(old, old_idx) + id_key_offset, entry.data() + id_key_offset) < 0)
+					out.write(entry_at(old, old_idx++), index_entry_size);
+				if (old_idx < old_count && compare_keys(entry_at(old, old_idx) + id_key_offset, entry.data() + id_key_offset) == 0)
+					old_idx++;
+				out.write(entry.data(), index_entry_size);
+			}
+			out.write(entry_at(old, old_idx), (old_count - old_idx) * index_entry_size);
+		});
+	}
+	fs::rename(temp_index_path(ids_file), ids_file);
+
+	std::vector<index_entry> by_created_at = by_id;
+	std::sort(by_created_at.begin(), by_created_at.end(), [](const index_entry& first, const index_entry& second) { return created_at_less(first.data(), second.data()); });
+
+	const auto created_at_file = directory / created_at_index_filename;
+	{
+		const mapped_file old_created_at{ created_at_file };
+		const auto old = old_created_at.view();
+
+		write_index(temp_index_path(created_at_file), [&](std::ofstream& out)
+		{
+			size_t old_idx = 0;
+			const size_t old_count = entry_count(old);
+			const auto write_old_until = [&](const char* stop_at)
+			{
+				for (; old_idx < old_count && (stop_at == nullptr || created_at_less(entry_at(old, old_idx), stop_at)); old_idx++)
+				{
+					// posts that just got written again are in the new entries, so skip their old spots
+					if (!is_replaced(entry_at(old, old_idx)))
+						out.write(entry_at(old, old_idx), index_entry_size);
+				}
+			};
+
+			for (const auto& entry : by_created_at)
+			{
+				write_old_until(entry.data());
+				out.write(entry.data(), index_entry_size);
+			}
+			write_old_until(nullptr);
+		});
+	}
+	fs::rename(temp_index_path(created_at_file), created_at_file);
+
+	pending.clear();
+}
+
+post_store_reader::post_store_reader(fs::path dir) : directory(std::move(dir)), ids(directory / ids_index_filename), created_at(directory / created_at_index_filename)
+{
+}
+
+size_t post_store_reader::size() const noexcept
+{
+	return entry_count(ids.view());
+}
+
+std::string_view post_store_reader::record_at(const char* entry)
+{
+	const auto location = location_of(entry);
+
+	if (segments.size() <= location.segment)
+		segments.resize(location.segment + 1);
+
+	auto& segment = segments[location.segment];
+	if (!segment.has_value())
+		segment.emplace(segment_path(directory, location.segment));
+
+	const auto contents = segment->view();
+	if (location.offset > contents.size() || contents.size() - location.offset < location.length)
+		throw msync_exception(std::string{ "The post store in " }.append(directory.string()).append(" points at a post that isn't there. The store might be damaged."));
+
+	return contents.substr(static_cast<size_t>(location.offset), location.length);
+}
+
+std::optional<std::string_view> post_store_reader::find(const std::string_view id)
+{
+	std::array<char, store_key_size> key;
+	if (!write_key(key.data(), id))
+		return std::nullopt;
+
+	const auto index = ids.view();
+	size_t low = 0;
+	size_t high = entry_count(index);
+	while (low < high)
+	{
+		const size_t mid = low + (high - low) / 2;
+		const int compared = compare_keys(entry_at(index, mid) + id_key_offset, key.data());
+		if (compared == 0)
+			return record_at(entry_at(index, mid));
+		if (compared < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return std::nullopt;
+}
+
+std::vector<std::string_view> post_store_reader::between(const std::string_view index, const size_t key_offset, const std::string_view first, const std::string_view last)
+{
+	const size_t count = entry_count(index);
+
+	// finds the first entry whose key isn't less than (or, if after is set, is greater than) key
+	const auto bound = [&](const std::string_view key, bool after)
+	{
+		// keys that are too long to store sort after everything that was stored
+		std::array<char, store_key_size> padded;
+		if (!write_key(padded.data(), key))
+			return count;
+
+		size_t low = 0;
+		size_t high = count;
+		while (low < high)
+		{
+			const size_t mid = low + (high - low) / 2;
+			const int compared = compare_keys(entry_at(index, mid) + key_offset, padded.data());
+			if (compared < 0 || (after && compared == 0))
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		return low;
+	};
+
+	const size_t start = first.empty() ? 0 : bound(first, false);
+	const size_t end = last.empty() ? count : bound(last, true);
+
+	std::vector<std::string_view> records;
+	if (start < end)
+	{
+		records.reserve(end - start);
+		for (size_t i = start; i < end; i++)
+			records.push_back(record_at(entry_at(index, i)));
+	}
+	return records;
+}
+
+std::vector<std::string_view> post_store_reader::ids_between(const std::string_view first, const std::string_view last)
+{
+	return between(ids.view(), id_key_offset, first, last);
+}
+
+std::vector<std::string_view> post_store_reader::posted_between(const std::string_view first, const std::string_view last)
+{
+	return between(created_at.view(), created_at_key_offset, first, last);
+}
+
+std::vector<std::string_view> post_store_reader::all()
+{
+	return between(ids.view(), id_key_offset, {}, {});
+}
+
+std::vector<std::string_view> post_store_reader::newest(const size_t count)
+{
+	const auto index = ids.view();
+	const size_t total = entry_count(index);
+
+	std::vector<std::string_view> records;
+	records.reserve(std::min(count, total));
+	for (size_t i = total; i > 0 && records.size() < count; i--)
+		records.push_back(record_at(entry_at(index, i - 1)));
+	return records;
+}
@@ -0,0 +1,188 @@
+#ifndef MSYNC_POST_STORE_HPP
+#define MSYNC_POST_STORE_HPP
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <filesystem.hpp>
+
+#include "../entities/entities.hpp"
+#include "../postlist/post_list.hpp"
+
+#include "mapped_file.hpp"
+#include "post_record.hpp"
+
+// another place to keep downloaded posts, for when a .list file gets too big to search through.
+// a store is a folder with:
+// - segment files (00000001.seg, 00000002.seg...) that posts get appended to in the binary format from post_record.hpp.
+//   once a segment gets big enough, a new one is started. Each record is its length followed by the record.
+// - ids.idx, which has an entry for every post, sorted by ID.
+// - created_at.idx, which has the same entries, sorted by when the post was made.
+// the indexes are just fixed size entries in order, so they can be mapped and binary searched without reading the whole thing.
+// if the same ID gets written more than once, the index points at the newest one.
+
+// each key is right aligned with zeroes in front, so comparing the bytes compares by length and then alphabetically,
+// which is how Mastodon's numeric IDs and the ISO 8601 timestamps in created_at sort.
+constexpr size_t store_key_size = 32;
+constexpr size_t index_entry_size = store_key_size * 2 + 16;
+using index_entry = std::array<char, index_entry_size>;
+
+struct store_location
+{
+	uint32_t segment = 0;
+	uint32_t length = 0;
+	uint64_t offset = 0;
+};
+
+class post_store_writer
+{
+public:
+	explicit post_store_writer(fs::path directory);
+
+	// writes out the indexes if there's anything that hasn't been indexed yet.
+	~post_store_writer();
+
+	post_store_writer(const post_store_writer&) = delete;
+	post_store_writer& operator=(const post_store_writer&) = delete;
+
+	// id and created_at go in the indexes, and record is what gets handed back when the post is looked up.
+	void append(std::string_view id, std::string_view created_at, std::string_view record);
+
+	// adds everything appended since the last flush to the indexes.
+	void flush();
+
+private:
+	void start_segment(uint32_t number);
+
+	const fs::path directory;
+	std::ofstream segment;
+	uint32_t segment_number = 0;
+	uint64_t segment_size = 0;
+	std::vector<index_entry> pending;
+};
+
+class post_store_reader
+{
+public:
+	explicit post_store_reader(fs::path directory);
+
+	size_t size() const noexcept;
+
+	// the record for this ID, if there is one. The record stays good as long as this reader does.
+	std::optional<std::string_view> find(std::string_view id);
+
+	// every record with an ID from first to last, including those two, lowest ID first.
+	// an empty first or last means there's no limit on that end.
+	std::vector<std::string_view> ids_between(std::string_view first, std::string_view last);
+
+	// same, but by created_at, oldest first.
+	std::vector<std::string_view> posted_between(std::string_view first, std::string_view last);
+
+	// every record, lowest ID first.
+	std::vector<std::string_view> all();
+
+	// the count records with the highest IDs, highest first.
+	std::vector<std::string_view> newest(size_t count);
+
+private:
+	std::string_view record_at(const char* entry);
+	std::vector<std::string_view> between(std::string_view index, size_t key_offset, std::string_view first, std::string_view last);
+
+	const fs::path directory;
+	mapped_file ids;
+	mapped_file created_at;
+	std::vector<std::optional<mapped_file>> segments;
+};
+
+template <typename post_type>
+class post_store
+{
+public:
+	explicit post_store(fs::path directory) : store(std::move(directory)) { }
+
+	// this is the same as post_list's write, so either one can be used to save downloaded posts
+	void write(const post_type& post)
+	{
+		buffer.clear();
+		append_record(buffer, post);
+		store.append(post.id, post.created_at, buffer);
+	}
+
+	template <typename iterator>
+	void write(iterator first, iterator last)
+	{
+		for (; first != last; ++first)
+			write(*first);
+	}
+
+private:
+	post_store_writer store;
+	std::string buffer;
+};
+
+template <typename post_type>
+class post_store_view
+{
+public:
+	explicit post_store_view(fs::path directory) : store(std::move(directory)) { }
+
+	size_t size() const noexcept { return store.size(); }
+
+	std::optional<post_type> find(std::string_view id)
+	{
+		const auto record = store.find(id);
+		if (!record.has_value())
+			return std::nullopt;
+
+		post_type post;
+		read_record(*record, post);
+		return post;
+	}
+
+	std::vector<post_type> ids_between(std::string_view first, std::string_view last)
+	{
+		return read_all(store.ids_between(first, last));
+	}
+
+	std::vector<post_type> posted_between(std::string_view first, std::string_view last)
+	{
+		return read_all(store.posted_between(first, last));
+	}
+
+	std::vector<post_type> newest(size_t count)
+	{
+		return read_all(store.newest(count));
+	}
+
+	// writes every post in the store out the same way post_list would, lowest ID first.
+	// this is how the .list view of a store is made when somebody wants to read it.
+	void render(std::ostream& out)
+	{
+		post_type post;
+		for (const auto record : store.all())
+		{
+			read_record(record, post);
+			out << post << post_separator;
+		}
+	}
+
+private:
+	post_store_reader store;
+
+	static std::vector<post_type> read_all(const std::vector<std::string_view>& records)
+	{
+		std::vector<post_type> posts(records.size());
+		for (size_t i = 0; i < records.size(); i++)
+			read_record(records[i], posts[i]);
+		return posts;
+	}
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "print_logger.hpp"
 #include <constants.hpp>
 
+#include <mutex>
+
 bool verbose_logs = false;
 bool logs_off = false;
 
@@ -28,3 +30,32 @@ print_logger<logtype::fileonly>& plfile()
 	static print_logger<logtype::fileonly> pl(logfile);
 	return pl;
 }
+
+thread_local log_group* active_log_group = nullptr;
+
+std::mutex& log_output_lock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+log_group::log_group() : outer(active_log_group)
+{
+	active_log_group = this;
+}
+
+log_group::~log_group()
+{
+	active_log_group = outer;
+
+	if (outer != nullptr)
+	{
+		outer->console << console.str();
+		outer->file << file.str();
+		return;
+	}
+
+	const std::lock_guard<std::mutex> lock{ log_output_lock() };
+	std::cout << console.str() << std::flush;
+	logfile << file.str();
+}
@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <mutex>
 
 enum class logtype
 {
@@ -13,6 +15,31 @@ enum class logtype
 extern bool verbose_logs;
 extern bool logs_off;
 
+// while one of these is alive, everything logged on the thread that made it is held onto
+// and written out all at once when it's destroyed. This keeps output from work that runs on
+// different threads at the same time from getting interleaved.
+// if one is made while another is already collecting on the same thread, the inner one's
+// output goes to the outer one when it's done, so nothing gets reordered.
+struct log_group
+{
+	log_group();
+	~log_group();
+
+	log_group(const log_group&) = delete;
+	log_group& operator=(const log_group&) = delete;
+
+	std::ostringstream console;
+	std::ostringstream file;
+
+private:
+	log_group* const outer;
+};
+
+extern thread_local log_group* active_log_group;
+
+// held while writing straight to the console and log file, so that threads that aren't in a log_group can still log safely.
+std::mutex& log_output_lock();
+
 template <logtype isverbose = logtype::normal>
 struct print_logger
 {
@@ -24,27 +51,45 @@ struct print_logger
 		if (logs_off)
 			return *this;
 
-		if constexpr (isverbose == logtype::verbose)
+		if (active_log_group != nullptr)
 		{
-			if (verbose_logs)
-				std::cout << towrite;
-		}
-		else if constexpr (isverbose != logtype::fileonly)
-		{
-			std::cout << towrite;
+			write(active_log_group->console, active_log_group->file, towrite);
+			return *this;
 		}
 
-		logfile << towrite;
+		const std::lock_guard<std::mutex> lock{ log_output_lock() };
+		write(std::cout, logfile, towrite);
 		return *this;
 	}
 
 	void flush()
 	{
-		std::cout << std::flush;
+		// grouped output gets printed when the group's done, so there's nothing to flush yet
+		if (active_log_group == nullptr)
+		{
+			const std::lock_guard<std::mutex> lock{ log_output_lock() };
+			std::cout << std::flush;
+		}
 	}
 
 private:
 	std::ofstream& logfile;
+
+	template <typename T>
+	static void write(std::ostream& console, std::ostream& file, const T& towrite)
+	{
+		if constexpr (isverbose == logtype::verbose)
+		{
+			if (verbose_logs)
+				console << towrite;
+		}
+		else if constexpr (isverbose != logtype::fileonly)
+		{
+			console << towrite;
+		}
+
+		file << towrite;
+	}
 };
 
 print_logger<logtype::normal>& pl();
@@ -1,7 +1,14 @@
 #include "queue_list.hpp"
 
+#include <msync_exception.hpp>
+
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <fstream>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 // not +1 because unknown doesn't get a string
 constexpr std::array<std::string_view, static_cast<uint8_t>(api_route::unknown)> ROUTE_NAMES = {
@@ -24,7 +31,46 @@ api_route parse_route(std::string_view str)
 	return api_route::unknown;
 }
 
-bool Read(std::deque<api_call>& queued, std::string&& line)
+constexpr std::array<std::string_view, 2> CHANGE_NAMES = { "ADD ", "REMOVE " };
+
+constexpr std::string_view FAILED_PREFIX = "FAILED ";
+
+constexpr std::array<std::string_view, 7> ERROR_NAMES = { "none", "network", "server", "rate_limited", "rejected", "other", "unauthorized" };
+
+std::string_view print_error(call_error error)
+{
+	return ERROR_NAMES[static_cast<uint8_t>(error)];
+}
+
+call_error parse_error(std::string_view str)
+{
+	for (size_t i = 0; i < ERROR_NAMES.size(); i++)
+	{
+		if (str == ERROR_NAMES[i])
+			return static_cast<call_error>(i);
+	}
+
+	return call_error::other;
+}
+
+// takes the next word off the front of line.
+std::string_view next_word(std::string_view& line)
+{
+	const auto space = line.find(' ');
+	const auto word = line.substr(0, space);
+	line.remove_prefix(space == std::string_view::npos ? line.size() : space + 1);
+	return word;
+}
+
+template <typename Number>
+Number parse_number(std::string_view str)
+{
+	Number number = 0;
+	std::from_chars(str.data(), str.data() + str.size(), number);
+	return number;
+}
+
+api_call parse_call(std::string&& line)
 {
 	const auto first_space = line.find(' ');
 
@@ -36,16 +82,167 @@ bool Read(std::deque<api_call>& queued, std::string&& line)
 	else
 		line.clear();
 
-	queued.push_back(api_call{ parsed_route, std::move(line) });
-	return false;
+	return api_call{ parsed_route, std::move(line) };
+}
+
+// "FAILED 2 server 1700000000 FAV 1234" -> the call, with how it failed filled in.
+api_call parse_failed_call(std::string_view line)
+{
+	line.remove_prefix(FAILED_PREFIX.size());
+	const auto attempts = parse_number<unsigned int>(next_word(line));
+	const auto error = parse_error(next_word(line));
+	const auto not_before = parse_number<long long>(next_word(line));
+
+	api_call call = parse_call(std::string{ line });
+	call.attempts = attempts;
+	call.last_error = error;
+	call.not_before = not_before;
+	return call;
+}
+
+// a call in the queue being replayed, pointing at its argument instead of copying it.
+struct call_key
+{
+	api_route route;
+	std::string_view argument;
+
+	bool operator==(const call_key& other) const noexcept { return route == other.route && argument == other.argument; }
+};
+
+struct call_key_hash
+{
+	size_t operator()(const call_key& key) const noexcept { return hash_call(key.route, key.argument); }
+};
+
+struct indexed_call
+{
+	// a REMOVE takes out every copy that came before it, but not ones that get added again later
+	size_t removed_before = 0;
+	bool queued = false;
+};
+
+void replay(std::deque<api_call>& queued, std::string_view text)
+{
+	// a deque never moves what's in it when it grows at the end, so the keys can point right at the arguments
+	std::deque<api_call> replayed = std::move(queued);
+	queued.clear();
+	std::unordered_map<call_key, indexed_call, call_key_hash> index;
+
+	// about one call per line, so it doesn't have to keep growing
+	index.reserve(replayed.size() + static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) + 1);
+
+	const auto key = [](const api_call& call) { return call_key{ call.queued_call, call.argument }; };
+
+	for (const auto& call : replayed)
+		index[key(call)].queued = true;
+
+	const auto starts_with = [](std::string_view line, std::string_view prefix) { return line.compare(0, prefix.size(), prefix) == 0; };
+	const auto add_change = CHANGE_NAMES[static_cast<uint8_t>(queue_change::add)];
+	const auto remove_change = CHANGE_NAMES[static_cast<uint8_t>(queue_change::remove)];
+
+	while (!text.empty())
+	{
+		const auto line_end = text.find('\n');
+		const auto line = text.substr(0, line_end);
+		text.remove_prefix(line_end == std::string_view::npos ? text.size() : line_end + 1);
+
+		// file_backed skips these for the first line, but the rest of the file comes in all at once
+		const auto first_non_whitespace = line.find_first_not_of(" \t\r\n");
+		if (first_non_whitespace == std::string_view::npos || line[first_non_whitespace] == '#')
+			continue;
+
+		if (starts_with(line, add_change))
+		{
+			auto call = parse_call(std::string{ line.substr(add_change.size()) });
+			const auto found = index.find(key(call));
+			if (found != index.end() && found->second.queued)
+				continue;
+
+			replayed.push_back(std::move(call));
+			if (found != index.end())
+				found->second.queued = true;
+			else
+				index.emplace(key(replayed.back()), indexed_call{ 0, true });
+		}
+		else if (starts_with(line, remove_change))
+		{
+			const auto call = parse_call(std::string{ line.substr(remove_change.size()) });
+			const auto found = index.find(key(call));
+			if (found != index.end())
+				found->second = indexed_call{ replayed.size(), false };
+		}
+		else
+		{
+			replayed.push_back(starts_with(line, FAILED_PREFIX) ? parse_failed_call(line) : parse_call(std::string{ line }));
+			index[key(replayed.back())].queued = true;
+		}
+	}
+
+	// figure out what's left before moving anything, since the index points into the calls
+	std::vector<bool> keep(replayed.size());
+	for (size_t i = 0; i < replayed.size(); i++)
+		keep[i] = i >= index.find(key(replayed[i]))->second.removed_before;
+
+	for (size_t i = 0; i < replayed.size(); i++)
+	{
+		if (keep[i])
+			queued.push_back(std::move(replayed[i]));
+	}
 }
 
-void Write(std::deque<api_call>&& que, std::ofstream& of)
+bool Read(std::deque<api_call>& queued, std::string&& text)
+{
+	replay(queued, text);
+
+	// the first line comes in by itself. After that, ask for the rest of the file in one go,
+	// so the whole log gets replayed with one index instead of searching the queue for every ADD and REMOVE.
+	return true;
+}
+
+// whatever was there last might not have a newline after it if someone edited the file by hand,
+// and the first change would get stuck on the end of it.
+bool needs_newline(const fs::path& queue_file)
+{
+	std::ifstream existing{ queue_file.c_str(), std::ios::binary | std::ios::ate };
+	if (!existing.is_open() || existing.tellg() <= 0)
+		return false;
+
+	existing.seekg(-1, std::ios::end);
+	return existing.get() != '\n';
+}
+
+void append_changes(const fs::path& queue_file, queue_change change, const std::vector<api_call>& calls)
+{
+	std::string changes;
+	if (needs_newline(queue_file))
+		changes.push_back('\n');
+
+	for (const auto& call : calls)
+	{
+		if (call.queued_call == api_route::unknown) continue;
+
+		changes.append(CHANGE_NAMES[static_cast<uint8_t>(change)]).append(print_route(call.queued_call));
+
+		if (!call.argument.empty())
+			changes.append(1, ' ').append(call.argument);
+
+		changes.push_back('\n');
+	}
+
+	// all at once, so that if msync dies partway through, at worst the last line gets cut off
+	if (!append_to_file(queue_file, changes))
+		throw msync_exception("Couldn't add to the queue in " + to_utf8(queue_file) + ". Is the disk full?");
+}
+
+void Write(std::deque<api_call>&& que, std::ostream& of)
 {
 	for (const auto& call : que)
 	{
 		if (call.queued_call == api_route::unknown) continue;
 
+		if (call.attempts != 0 || call.last_error != call_error::none)
+			of << FAILED_PREFIX << call.attempts << ' ' << print_error(call.last_error) << ' ' << call.not_before << ' ';
+
 		of << print_route(call.queued_call);
 
 		if (!call.argument.empty())
@@ -55,6 +252,11 @@ void Write(std::deque<api_call>&& que, std::ofstream& of)
 	}
 }
 
+size_t hash_call(api_route route, std::string_view argument) noexcept
+{
+	return std::hash<std::string_view>{}(argument) * 31 + static_cast<size_t>(route);
+}
+
 bool operator== (const api_call& rhs, const api_call& lhs)
 {
 	return rhs.queued_call == lhs.queued_call && rhs.argument == lhs.argument;
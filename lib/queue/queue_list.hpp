@@ -3,6 +3,8 @@
 
 #include <deque>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "../filebacked/file_backed.hpp"
 
@@ -20,18 +22,62 @@ enum class api_route : uint8_t
 	unknown,
 };
 
+// why a queued call failed the last time it was sent, which decides when, or if, it gets tried again.
+enum class call_error : uint8_t
+{
+	none,
+	network, // no response at all, or the request timed out
+	server, // a 5xx
+	rate_limited, // a 429
+	rejected, // any other 4xx, like faving a post that's been deleted. Trying again won't help.
+	other, // something on this end, like a post that replies to one that didn't get sent
+	unauthorized, // a 401 or 403. The token was revoked or the account was suspended, so nothing else in the queue will go through either.
+};
+
+std::string_view print_error(call_error error);
+
 struct api_call
 {
 	api_route queued_call;
 	std::string argument;
+
+	// how many times this has been sent and failed, how it failed last, and, in seconds since the epoch,
+	// when it's allowed to be tried again. They're all zero for calls that have never failed.
+	unsigned int attempts = 0;
+	call_error last_error = call_error::none;
+	long long not_before = 0;
 };
 
+// two calls are the same if they'd make the same request, no matter how they've failed before.
 bool operator== (const api_call& rhs, const api_call& lhs);
 
+// hashes a call by its route and argument, so a big queue can be looked through once instead of once per call.
+size_t hash_call(api_route route, std::string_view argument) noexcept;
+
+struct api_call_hash
+{
+	size_t operator()(const api_call& call) const noexcept { return hash_call(call.queued_call, call.argument); }
+};
+
 std::string_view print_route(api_route route);
 
+// sync.queue starts with the queue as of the last time it was rewritten, one call per line, like "FAV 1234".
+// after that comes a log of everything that's changed since then: "ADD FAV 1234" puts a call at the end of the queue
+// unless it's already in there, and "REMOVE FAV 1234" takes every copy of it out.
+// a call that's failed before has "FAILED <attempts> <error> <not before> " in front of it, like "FAILED 2 server 1700000000 FAV 1234".
+// Read replays the log with a hashed index of what's queued, so it takes about as long as reading the file does, no matter how long the queue is.
+// Write always writes a plain queue with no log, so opening a queue_list and letting it save compacts it.
 bool Read(std::deque<api_call>&, std::string&&);
-void Write(std::deque<api_call>&&, std::ofstream&);
+void Write(std::deque<api_call>&&, std::ostream&);
+
+enum class queue_change : uint8_t
+{
+	add,
+	remove,
+};
+
+// adds changes to the end of the log without reading or rewriting the rest of the file. Throws an msync_exception if it can't.
+void append_changes(const fs::path& queue_file, queue_change change, const std::vector<api_call>& calls);
 
 using queue_list = file_backed<std::deque<api_call>, Read, Write>;
 using readonly_queue_list = file_backed<std::deque<api_call>, Read, Write, true, true, true>;
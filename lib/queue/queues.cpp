@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <functional>
 #include <array>
+#include <unordered_map>
 #include <msync_exception.hpp>
 
 fs::path get_file_queue_directory(const fs::path& user_account_dir)
@@ -190,6 +191,46 @@ queue_t open_queue(const fs::path& user_account_dir)
 	return queue_t{ user_account_dir / Queue_Filename };
 }
 
+uintmax_t size_or_zero(const fs::path& file)
+{
+#if MSYNC_USE_BOOST
+	boost::system::error_code err;
+#else
+	std::error_code err;
+#endif
+	const auto size = fs::file_size(file, err);
+	return err ? 0 : size;
+}
+
+// which power of two the size is past.
+int size_class(uintmax_t size)
+{
+	int bits = 0;
+	for (; size != 0; size >>= 1)
+		bits++;
+	return bits;
+}
+
+void append_to_queue(const fs::path& user_account_dir, queue_change change, const std::vector<api_call>& calls)
+{
+	if (calls.empty())
+		return;
+
+	const fs::path queue_file = user_account_dir / Queue_Filename;
+	const auto size_before = size_or_zero(queue_file);
+	append_changes(queue_file, change, calls);
+	const auto size_after = size_or_zero(queue_file);
+
+	// fold the log back into a plain queue every time the file doubles in size.
+	// that way, the file can't grow forever, but rewriting it only costs a constant amount of work per change, on average.
+	constexpr uintmax_t smallest_to_compact = 64 * 1024;
+	if (size_after >= smallest_to_compact && size_class(size_after) > size_class(size_before))
+	{
+		// it saves itself when it goes out of scope
+		queue_list compact = open_queue(user_account_dir);
+	}
+}
+
 std::vector<api_call> to_api_calls(std::vector<std::string>&& add, api_route target_route)
 {
 	std::vector<api_call> to_return;
@@ -205,17 +246,17 @@ std::vector<api_call> to_api_calls(std::vector<std::string>&& add, api_route tar
 
 void enqueue(const api_route toenqueue, const fs::path& user_account_dir, std::vector<std::string> add)
 {
-	queue_list toaddto = open_queue(user_account_dir);
-
 	if (toenqueue == api_route::post)
 	{
 		const auto dont_queue = std::remove_if(add.begin(), add.end(), std::not_fn(should_queue_post));
 
 		const fs::path filequeuedir = get_file_queue_directory(user_account_dir);
-		std::transform(add.begin(), dont_queue, std::back_inserter(toaddto.parsed), [&filequeuedir](const auto& id)
+		std::vector<api_call> posts;
+		std::transform(add.begin(), dont_queue, std::back_inserter(posts), [&filequeuedir](const auto& id)
 			{
 				return api_call{ api_route::post, queue_post(filequeuedir, id) };
 			});
+		append_to_queue(user_account_dir, queue_change::add, posts);
 
 		const auto queued = dont_queue - add.begin();
 		const auto skipped = add.end() - dont_queue;
@@ -223,37 +264,21 @@ void enqueue(const api_route toenqueue, const fs::path& user_account_dir, std::v
 	}
 	else
 	{
-		// hm, this is (add.size() * toaddto.size()) string compares, which isn't great, performance-wise
-		// but I think it's worth it to eliminate duplicates from the queue, since that saves network requests down the line.
-		// I do it like this because std::unique only works on adjacent duplicates, and sorting the list would destroy the order
-		// I might be able to get a speedup by copying toaddto into a std::unordered_set, but I'm not sure adding a bunch of
-		// allocations to the mix really helps for the small input sizes msync deals with. 
-		// similar to the dequeue situation
+		// this doesn't even look at what's already queued. Duplicates are eliminated when the log is read back in,
+		// since that saves network requests down the line, so queueing something is just adding a line to the end of the file.
 
 		// you could argue that order doesn't matter for favs and boosts, and I think that, too, but 
 		// - it absolutely matters for posts, especially since posts can be replies to others
 		// - if this part of the program is called 'queue', it should implement a queue
 
-		int queued, skipped;
-		queued = skipped = 0;
-		for (api_call& incoming_call : to_api_calls(std::move(add), toenqueue))
-		{
-			if (std::find(toaddto.parsed.begin(), toaddto.parsed.end(), incoming_call) == toaddto.parsed.end())
-			{
-				toaddto.parsed.push_back(std::move(incoming_call));
-				queued++;
-			}
-			else
-			{
-				skipped++;
-			}
-		}
+		const auto calls = to_api_calls(std::move(add), toenqueue);
+		append_to_queue(user_account_dir, queue_change::add, calls);
 
-		plverb() << "Enqueued " << queued << pluralize(queued, " item", " items") << " and skipped " << skipped << pluralize(skipped, " duplicate", " duplicates") << " for account " << user_account_dir.filename() << ".\n";
+		plverb() << "Enqueued " << calls.size() << pluralize(calls.size(), " item", " items") << " for account " << user_account_dir.filename() << ". Anything that was already queued is only kept once.\n";
 	}
 
-	// consider looking for those "delete" guys, the ones with the - at the end, and having this cancel them out, 
-	// but "unboost and reboost", for example, is a valid thing to want to do.
+	// calls that cancel each other out are left alone here, since "unboost and reboost", for example, is a valid thing to want to do.
+	// send_posts collapses them when it sends the queue, unless it's told not to.
 }
 
 void dequeue_post(const fs::path& queuedir, const fs::path& filename)
@@ -266,7 +291,8 @@ void dequeue_post(const fs::path& queuedir, const fs::path& filename)
 
 void dequeue(api_route todequeue, const fs::path& user_account_dir, std::vector<std::string> remove)
 {
-	queue_list toremovefrom = open_queue(user_account_dir);
+	// this only reads the queue to figure out what's in it. The changes get added to the end of the log
+	readonly_queue_list toremovefrom = open_queue<readonly_queue_list>(user_account_dir);
 
 	if (todequeue == api_route::post)
 	{
@@ -276,36 +302,29 @@ void dequeue(api_route todequeue, const fs::path& user_account_dir, std::vector<
 
 	auto toremove = to_api_calls(std::move(remove), todequeue);
 
-	// stable_partition is O(n) (assuming it can allocate a temporary buffer)
-	// but doing a O(n) find call for each one makes it O(n^2)
-	// sorting toremove and doing a binary search on it might be faster, 
-	// but that's an O(n lg n) sort and then an O(n lg n) partition-with-find.
-	// if the problem gets big enough, an unordered_set made from the elements of toremove would help
-	// but I think that's overkill for the small lists this program will likely deal with.
-
-	// what we really want is the set difference between these two, but:
-	// - it would require making a sorted or std::unordered_set copy of toremovefrom and same for toremove
-	// - it'd still be an O(n) operation to remove existing entries from toremovefrom because toremovefrom has to stay in order
-	// - you'd have have to do two set differences- one for the things to be removed from toremovefrom and one
-	//   for the things in toremove that get enqueued with the minus sign
-
-	// put the ones to keep first, and the ones to remove last
-	const auto removefrom_pivot = std::stable_partition(toremovefrom.parsed.begin(), toremovefrom.parsed.end(),
-		[&toremove](const auto& id) {
-			return std::find(toremove.begin(), toremove.end(), id) == toremove.end();
-		});
-
-
-	// put the ones that'll be removed from the queue first and the rest after 
+	// what we really want is the set difference between these two, but the queue has to stay in order,
+	// and you'd need two of them- one for the things to take out of the queue and one for the things that get enqueued as undos.
+	// so, instead, index what's being removed, go through the queue once to see which of them are in it,
+	// and then put the ones that are first. That's O(n + m), and the queue doesn't even need to be copied.
+	std::unordered_map<api_call, bool, api_call_hash> in_queue;
+	in_queue.reserve(toremove.size());
+	for (const auto& call : toremove)
+		in_queue.emplace(call, false);
+
+	size_t removed_count = 0;
+	for (const auto& call : toremovefrom.parsed)
+	{
+		const auto found = in_queue.find(call);
+		if (found != in_queue.end())
+		{
+			found->second = true;
+			removed_count++;
+		}
+	}
 
-	// all the ones in toremovefrom that are also in toremove are at the end, so we only have to check those.
-	// again, partitioning is O(n) and std::find is O(n), so this is another n^2 algorithm.
-	// but these should be relatively small and so I highly doubt it's going to matter. If it does,
-	// I could copy the things that'll be removed from the queue to an unordered set. Again, overkill for this.
+	// put the ones that'll be removed from the queue first and the rest after
 	const auto toremove_pivot = std::stable_partition(toremove.begin(), toremove.end(),
-		[&toremovefrom, removefrom_pivot](const auto& id) {
-			return std::find(removefrom_pivot, toremovefrom.parsed.end(), id) != toremovefrom.parsed.end();
-		});
+		[&in_queue](const auto& id) { return in_queue.find(id)->second; });
 
 	if (todequeue == api_route::post)
 	{
@@ -314,10 +333,7 @@ void dequeue(api_route todequeue, const fs::path& user_account_dir, std::vector<
 			[&filequeuedir](const auto& apicall) { dequeue_post(filequeuedir, apicall.argument); });
 	}
 
-	// gotta calculate this before erasing stuff
-	const auto removed_count = toremovefrom.parsed.end() - removefrom_pivot;
-
-	toremovefrom.parsed.erase(removefrom_pivot, toremovefrom.parsed.end());
+	append_to_queue(user_account_dir, queue_change::remove, std::vector<api_call>(toremove.begin(), toremove_pivot));
 
 	plverb() << "Removed " << removed_count << pluralize(removed_count, " item", " items") << " for account " << user_account_dir.filename() << ".\n";
 
@@ -329,8 +345,10 @@ void dequeue(api_route todequeue, const fs::path& user_account_dir, std::vector<
 	//consider removing duplicate removes?
 
 	const auto remove_route = undo_route(todequeue);
+	std::vector<api_call> undos;
 	std::for_each(toremove_pivot, toremove.end(),
-		[&toremovefrom, remove_route](api_call& queuedel) { toremovefrom.parsed.push_back(api_call{ remove_route, std::move(queuedel.argument) }); });
+		[&undos, remove_route](api_call& queuedel) { undos.push_back(api_call{ remove_route, std::move(queuedel.argument) }); });
+	append_to_queue(user_account_dir, queue_change::add, undos);
 
 	const auto enqueued_deletes = toremove.end() - toremove_pivot;
 	plverb() << "Enqueued " << enqueued_deletes << pluralize(enqueued_deletes, " deletion", " deletions") << " for account " << user_account_dir.filename() << ".\n";
@@ -339,13 +357,17 @@ void dequeue(api_route todequeue, const fs::path& user_account_dir, std::vector<
 void clear(api_route toclear, const fs::path& user_account_dir)
 {
 	queue_list clearthis = open_queue(user_account_dir);
+	queue_list clearfailed{ user_account_dir / Failed_Queue_Filename };
 	const auto toclearinsert = toclear;
 	const auto toclearremove = undo_route(toclear);
 
-	clearthis.parsed.erase(std::remove_if(clearthis.parsed.begin(), clearthis.parsed.end(), [toclearinsert, toclearremove](const api_call& call)
-		{
-			return call.queued_call == toclearinsert || call.queued_call == toclearremove;
-		}), clearthis.parsed.end());
+	const auto should_clear = [toclearinsert, toclearremove](const api_call& call)
+	{
+		return call.queued_call == toclearinsert || call.queued_call == toclearremove;
+	};
+
+	clearthis.parsed.erase(std::remove_if(clearthis.parsed.begin(), clearthis.parsed.end(), should_clear), clearthis.parsed.end());
+	clearfailed.parsed.erase(std::remove_if(clearfailed.parsed.begin(), clearfailed.parsed.end(), should_clear), clearfailed.parsed.end());
 
 
 	if (toclear == api_route::post)
@@ -359,19 +381,52 @@ queue_list get(const fs::path& user_account_dir)
 	return open_queue(user_account_dir);
 }
 
+std::string print_call(api_call&& call)
+{
+	const auto route_name = print_route(call.queued_call);
+	std::string toreturn = std::move(call.argument);
+	toreturn.insert(0, route_name.size() + 1, ' ');
+	toreturn.replace(0, route_name.size(), route_name);
+	return toreturn;
+}
+
 std::vector<std::string> print(const fs::path& user_account_dir)
 {
 	//prettyprint posts
 	readonly_queue_list printthis = open_queue<readonly_queue_list>(user_account_dir);
 	std::vector<std::string> toreturn(printthis.parsed.size());
 	std::transform(std::make_move_iterator(printthis.parsed.begin()), std::make_move_iterator(printthis.parsed.end()),
-		toreturn.begin(), [](api_call&& call) 
-		{
-			const auto route_name = print_route(call.queued_call);
-			std::string toreturn = std::move(call.argument);
-			toreturn.insert(0, route_name.size() + 1, ' ');
-			toreturn.replace(0, route_name.size(), route_name);
-			return toreturn;
-		});
+		toreturn.begin(), print_call);
+	return toreturn;
+}
+
+void move_to_failed(const fs::path& user_account_dir, std::vector<api_call> calls)
+{
+	if (calls.empty())
+		return;
+
+	// these don't happen often, so it's fine to just rewrite the whole thing
+	queue_list failed{ user_account_dir / Failed_Queue_Filename };
+
+	// if something was queued again after it failed, only keep how it failed the last time
+	for (auto& call : calls)
+	{
+		failed.parsed.erase(std::remove(failed.parsed.begin(), failed.parsed.end(), call), failed.parsed.end());
+		failed.parsed.push_back(std::move(call));
+	}
+}
+
+std::vector<std::string> print_failed(const fs::path& user_account_dir)
+{
+	readonly_queue_list printthis{ user_account_dir / Failed_Queue_Filename };
+	std::vector<std::string> toreturn;
+	for (auto& call : printthis.parsed)
+	{
+		const auto attempts = call.attempts;
+		const auto error = call.last_error;
+		std::string line = print_call(std::move(call));
+		line.append(" (").append(print_error(error)).append(" after ").append(std::to_string(attempts)).append(pluralize(attempts, " attempt)", " attempts)"));
+		toreturn.push_back(std::move(line));
+	}
 	return toreturn;
 }
@@ -18,4 +18,11 @@ queue_list get(const fs::path& user_account_dir);
 
 std::vector<std::string> print(const fs::path& user_account_dir);
 
+// calls that failed in a way that trying again won't fix get moved out of the queue and into their own file,
+// so they stop costing a request every sync, but can still be looked at.
+void move_to_failed(const fs::path& user_account_dir, std::vector<api_call> calls);
+
+// what's in that file, like print, but with how each one failed.
+std::vector<std::string> print_failed(const fs::path& user_account_dir);
+
 #endif
@@ -0,0 +1,82 @@
+#include "byte_budget.hpp"
+
+#include <algorithm>
+
+static unsigned long long request_cost(const transfer_totals& totals)
+{
+	return totals.sent_bytes + totals.received_bytes;
+}
+
+// even an empty response has headers, so nothing costs less than this.
+// it also keeps requests that start at the same time, before anything's been measured, from all guessing zero.
+constexpr unsigned long long smallest_guess = 1024;
+
+unsigned long long byte_budget::estimate() const
+{
+	unsigned long long guess = smallest_guess;
+	{
+		const std::lock_guard<std::mutex> guard{ budget_lock };
+		guess = std::max(guess, largest);
+	}
+
+	if (parent != nullptr)
+		guess = std::max(guess, parent->estimate());
+
+	return guess;
+}
+
+bool byte_budget::try_reserve(unsigned long long amount)
+{
+	{
+		const std::lock_guard<std::mutex> guard{ budget_lock };
+
+		// the first request always gets to go, so even a tiny limit gets something done
+		if (limit != 0 && started && used + reserved + amount > limit)
+			return false;
+
+		reserved += amount;
+		started = true;
+	}
+
+	if (parent != nullptr && !parent->try_reserve(amount))
+	{
+		release(amount);
+		return false;
+	}
+
+	return true;
+}
+
+void byte_budget::release(unsigned long long amount)
+{
+	const std::lock_guard<std::mutex> guard{ budget_lock };
+	reserved -= std::min(reserved, amount);
+}
+
+std::optional<unsigned long long> byte_budget::reserve()
+{
+	const auto amount = estimate();
+	if (!try_reserve(amount))
+		return {};
+	return amount;
+}
+
+void byte_budget::settle(unsigned long long amount, const transfer_totals& actual)
+{
+	const auto cost = request_cost(actual);
+	{
+		const std::lock_guard<std::mutex> guard{ budget_lock };
+		reserved -= std::min(reserved, amount);
+		used += cost;
+		largest = std::max(largest, cost);
+	}
+
+	if (parent != nullptr)
+		parent->settle(amount, actual);
+}
+
+unsigned long long byte_budget::spent() const
+{
+	const std::lock_guard<std::mutex> guard{ budget_lock };
+	return used;
+}
@@ -0,0 +1,61 @@
+#ifndef MSYNC_BYTE_BUDGET_HPP
+#define MSYNC_BYTE_BUDGET_HPP
+
+#include <mutex>
+#include <optional>
+
+#include "transfer_stats.hpp"
+
+// a limit on how many bytes a sync can send and receive, for people paying by the megabyte.
+// there's no way to know how big a response is going to be before asking for it, so each request reserves room first,
+// guessing it'll be as big as the biggest request so far, and settles up with what it actually cost when it's done.
+// that way, a sync stops before it goes over instead of after, even with several accounts syncing at once.
+// a budget can be inside another one, like an account's budget inside the whole sync's, and then a request has to fit in both.
+class byte_budget
+{
+public:
+	// a limit of zero means no limit. Requests still count toward the parent's, though.
+	explicit byte_budget(unsigned long long limit, byte_budget* parent = nullptr) : limit(limit), parent(parent) { }
+
+	byte_budget(const byte_budget&) = delete;
+	byte_budget& operator=(const byte_budget&) = delete;
+
+	// returns how much was reserved for the next request, or nothing if it might not fit. Nothing is reserved in that case.
+	std::optional<unsigned long long> reserve();
+
+	// call this once for each reservation, with what the request actually moved.
+	void settle(unsigned long long reserved, const transfer_totals& actual);
+
+	// how much requests have actually moved, not counting reservations.
+	unsigned long long spent() const;
+
+private:
+	bool try_reserve(unsigned long long amount);
+	void release(unsigned long long amount);
+	unsigned long long estimate() const;
+
+	mutable std::mutex budget_lock;
+	const unsigned long long limit;
+	byte_budget* const parent;
+
+	unsigned long long used = 0;
+	unsigned long long reserved = 0;
+	unsigned long long largest = 0;
+	bool started = false;
+};
+
+// the same as budget->reserve(), but there's always room if there's no budget.
+inline std::optional<unsigned long long> reserve_from(byte_budget* budget)
+{
+	if (budget == nullptr)
+		return 0;
+	return budget->reserve();
+}
+
+inline void settle_with(byte_budget* budget, unsigned long long reserved, const transfer_totals& actual)
+{
+	if (budget != nullptr)
+		budget->settle(reserved, actual);
+}
+
+#endif
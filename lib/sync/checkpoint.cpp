@@ -0,0 +1,39 @@
+#include "checkpoint.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <fstream>
+
+fs::path checkpoint_file(const fs::path& timeline_file)
+{
+	fs::path file = timeline_file;
+	file += ".checkpoint";
+	return file;
+}
+
+void write_checkpoint(const fs::path& file, std::string_view started_from, std::string_view written_through)
+{
+	fs::path temp_file = file;
+	temp_file += ".tmp";
+
+	{
+		std::ofstream out{ temp_file.c_str(), std::ios::trunc };
+		out << started_from << '\n' << written_through << '\n';
+		out.flush();
+		if (!out)
+			throw msync_exception(std::string{ "Couldn't write a checkpoint to " }.append(temp_file.string()).append(". Is the disk full?"));
+	}
+
+	fs::rename(temp_file, file);
+}
+
+std::string resume_from(const fs::path& file, std::string_view last_recorded_id)
+{
+	std::ifstream in{ file.c_str() };
+
+	std::string started_from, written_through;
+	if (!std::getline(in, started_from) || !std::getline(in, written_through) || written_through.empty() || started_from != last_recorded_id)
+		return std::string{ last_recorded_id };
+
+	return written_through;
+}
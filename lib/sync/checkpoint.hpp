@@ -0,0 +1,26 @@
+#ifndef MSYNC_CHECKPOINT_HPP
+#define MSYNC_CHECKPOINT_HPP
+
+#include <string>
+#include <string_view>
+
+#include <filesystem.hpp>
+
+// oldest_first appends every page to the timeline's file as soon as it's downloaded, but the new last ID only gets saved to the
+// account's options when msync exits. If it dies partway through, the next run would download all those pages again and write them twice.
+// so after each page, the last ID that made it into the file gets written down next to it, along with the last ID option it started from.
+// as long as that option hasn't changed since, the next run picks up from the checkpoint instead.
+
+// where the checkpoint for this timeline's file goes.
+fs::path checkpoint_file(const fs::path& timeline_file);
+
+// started_from is what the last ID option was when the sync started, and written_through is the newest ID in the file.
+// the new checkpoint goes in a temporary file that gets moved over the old one, so it's always either the old one or the new one.
+// throws an msync_exception if it can't be written.
+void write_checkpoint(const fs::path& file, std::string_view started_from, std::string_view written_through);
+
+// the ID to pick up from. That's the one in the checkpoint if it was made starting from last_recorded_id,
+// otherwise it's last_recorded_id. A missing or mangled checkpoint is ignored.
+std::string resume_from(const fs::path& file, std::string_view last_recorded_id);
+
+#endif
@@ -0,0 +1,112 @@
+#include "media_cache.hpp"
+
+#include "../util/util.hpp"
+
+#include <constants.hpp>
+
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <mutex>
+
+// a little less than a day, so the IDs are gone from here before the server would've gotten rid of them
+constexpr long long media_lifetime_seconds = 20 * 60 * 60;
+
+bool Read(std::map<std::string, cached_media, std::less<>>& parsed, std::string&& line)
+{
+	const auto first_space = line.find(' ');
+	const auto second_space = line.find(' ', first_space + 1);
+	if (first_space == std::string::npos || second_space == std::string::npos)
+		return false;
+
+	cached_media media;
+	const auto expires_end = line.data() + second_space;
+	const auto [end, error] = std::from_chars(line.data() + first_space + 1, expires_end, media.expires_at);
+	if (error != std::errc{} || end != expires_end)
+		return false;
+
+	media.id = line.substr(second_space + 1);
+	if (media.id.empty())
+		return false;
+
+	line.resize(first_space);
+	parsed.insert_or_assign(std::move(line), std::move(media));
+	return false;
+}
+
+void Write(std::map<std::string, cached_media, std::less<>>&& cache, std::ostream& out)
+{
+	for (const auto& [key, media] : cache)
+		out << key << ' ' << media.expires_at << ' ' << media.id << '\n';
+}
+
+std::string media_cache_key(const fs::path& file, std::string_view description)
+{
+	std::ifstream in{ file.c_str(), std::ios::binary };
+	if (!in.is_open())
+		return {};
+
+	uint_fast64_t content_hash = fnv1a({});
+	unsigned long long size = 0;
+	std::array<char, 64 * 1024> chunk;
+	while (in)
+	{
+		in.read(chunk.data(), chunk.size());
+		const auto got = static_cast<size_t>(in.gcount());
+		content_hash = fnv1a({ chunk.data(), got }, content_hash);
+		size += got;
+	}
+
+	if (in.bad())
+		return {};
+
+	// the size is in there so that two files would have to collide and be the same length to get mixed up
+	return hash_to_hex(content_hash) + '-' + std::to_string(size) + '-' + hash_to_hex(fnv1a(description));
+}
+
+static std::mutex media_cache_lock;
+
+static void drop_expired(std::map<std::string, cached_media, std::less<>>& cache, long long now)
+{
+	for (auto it = cache.begin(); it != cache.end();)
+	{
+		if (it->second.expires_at <= now)
+			it = cache.erase(it);
+		else
+			++it;
+	}
+}
+
+std::optional<std::string> find_upload(const fs::path& user_dir, std::string_view key, long long now)
+{
+	if (key.empty())
+		return std::nullopt;
+
+	const std::lock_guard<std::mutex> lock{ media_cache_lock };
+	media_cache_file cache{ user_dir / Media_Cache_Filename };
+	const auto found = cache.parsed.find(key);
+	if (found == cache.parsed.end() || found->second.expires_at <= now)
+		return std::nullopt;
+
+	return found->second.id;
+}
+
+void remember_upload(const fs::path& user_dir, std::string key, std::string media_id, long long now)
+{
+	if (key.empty())
+		return;
+
+	const std::lock_guard<std::mutex> lock{ media_cache_lock };
+	media_cache_file cache{ user_dir / Media_Cache_Filename };
+	drop_expired(cache.parsed, now);
+	cache.parsed.insert_or_assign(std::move(key), cached_media{ std::move(media_id), now + media_lifetime_seconds });
+}
+
+void forget_uploads(const fs::path& user_dir, const std::vector<std::string>& keys, long long now)
+{
+	const std::lock_guard<std::mutex> lock{ media_cache_lock };
+	media_cache_file cache{ user_dir / Media_Cache_Filename };
+	drop_expired(cache.parsed, now);
+	for (const auto& key : keys)
+		cache.parsed.erase(key);
+}
@@ -0,0 +1,44 @@
+#ifndef MSYNC_MEDIA_CACHE_HPP
+#define MSYNC_MEDIA_CACHE_HPP
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <ostream>
+
+#include <filesystem.hpp>
+
+#include "../filebacked/file_backed.hpp"
+
+// an attachment that's been uploaded, but whose post hasn't gone through yet.
+struct cached_media
+{
+	std::string id;
+
+	// seconds since the epoch. Mastodon cleans up media that isn't attached to anything after about a day,
+	// so this is a little before that.
+	long long expires_at = 0;
+};
+
+// keyed by media_cache_key. One line per upload: the key, when it expires, and the media ID.
+bool Read(std::map<std::string, cached_media, std::less<>>&, std::string&&);
+void Write(std::map<std::string, cached_media, std::less<>>&&, std::ostream&);
+
+using media_cache_file = file_backed<std::map<std::string, cached_media, std::less<>>, Read, Write>;
+
+// a hash of what's in the file, how big it is, and the description, so the same picture with the same description gets the same key
+// no matter what it's called or where it is. Returns an empty string if the file can't be read.
+std::string media_cache_key(const fs::path& file, std::string_view description);
+
+// these open the media cache in user_dir, and only one of them can do that at a time, so it's safe to call them from different threads.
+// find_upload returns the media ID if there's one for this key that hasn't expired yet.
+std::optional<std::string> find_upload(const fs::path& user_dir, std::string_view key, long long now);
+void remember_upload(const fs::path& user_dir, std::string key, std::string media_id, long long now);
+
+// once a post goes through, its media is attached to it and can't be attached to anything else, so there's no point keeping it around.
+// this also cleans out anything that's expired.
+void forget_uploads(const fs::path& user_dir, const std::vector<std::string>& keys, long long now);
+
+#endif
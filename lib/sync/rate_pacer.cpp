@@ -0,0 +1,71 @@
+#include "rate_pacer.hpp"
+
+#include "../util/util.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+std::chrono::milliseconds pacing_interval(const rate_limit_info& limits, const std::chrono::system_clock::time_point now)
+{
+	if (limits.remaining < 0 || limits.reset.empty())
+		return std::chrono::milliseconds{ 0 };
+
+	const auto until_reset = std::chrono::duration_cast<std::chrono::milliseconds>(parse_ISO8601_timestamp(limits.reset) - now);
+	if (until_reset.count() <= 0)
+		return std::chrono::milliseconds{ 0 };
+
+	// none left, so wait for the window to reset
+	if (limits.remaining == 0)
+		return until_reset;
+
+	// plenty left (or the server didn't say how many there are in total), so don't slow anything down yet
+	if (limits.limit <= 0 || limits.remaining * 2 > limits.limit)
+		return std::chrono::milliseconds{ 0 };
+
+	return until_reset / limits.remaining;
+}
+
+std::chrono::steady_clock::time_point rate_pacer::reserve()
+{
+	const std::lock_guard<std::mutex> lock{ pacer_lock };
+	const auto slot = std::max(std::chrono::steady_clock::now(), next_request);
+	next_request = slot + interval;
+	last_sent = slot;
+	return slot;
+}
+
+void rate_pacer::update(const rate_limit_info& limits)
+{
+	if (limits.remaining < 0 || limits.reset.empty())
+		return;
+
+	const auto new_interval = pacing_interval(limits, std::chrono::system_clock::now());
+
+	const std::lock_guard<std::mutex> lock{ pacer_lock };
+	interval = new_interval;
+
+	// the spacing counts from the last request that actually went out, not from slots handed out under the old interval.
+	// otherwise, a wait for the window to reset would still be there after the server says the reset happened.
+	// a slot that's still in the future hasn't been sent yet, and if nothing's been sent through this pacer, there's nothing to count from, so count from now instead.
+	const auto now = std::chrono::steady_clock::now();
+	const auto sent = last_sent == std::chrono::steady_clock::time_point{} ? now : std::min(last_sent, now);
+	next_request = sent + interval;
+}
+
+rate_pacer& pacer_for(const std::string_view url, const std::string_view access_token, const rate_limit_group group)
+{
+	static std::mutex pacers_lock;
+	static std::unordered_map<std::string, rate_pacer> pacers;
+
+	std::string key{ instance_of(url) };
+	key += '\n';
+	key += access_token;
+	key += '\n';
+	key += static_cast<char>('0' + static_cast<int>(group));
+
+	const std::lock_guard<std::mutex> lock{ pacers_lock };
+
+	// references to elements of an unordered_map stay good even when more get added
+	return pacers.try_emplace(std::move(key)).first->second;
+}
@@ -0,0 +1,47 @@
+#ifndef MSYNC_RATE_PACER_HPP
+#define MSYNC_RATE_PACER_HPP
+
+#include "../netinterface/net_interface.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <string_view>
+
+// Mastodon says how many requests you have left and when that count resets on every response.
+// if msync just goes as fast as it can, it uses them all up, gets a 429, and has to wait out the rest of the window, which can be five minutes.
+// instead, once half the requests in a window are used up, the rest get spread out evenly until the reset so they last.
+// until then, requests go out as fast as they like, so small syncs never wait at all.
+
+// how long to leave between requests, given what the server said last. zero means there's no need to wait.
+std::chrono::milliseconds pacing_interval(const rate_limit_info& limits, std::chrono::system_clock::time_point now);
+
+class rate_pacer
+{
+public:
+	// returns when the next request should go out and holds that time for it,
+	// so that threads sending to the same instance at once get spaced out too.
+	std::chrono::steady_clock::time_point reserve();
+
+	// call this with every response. responses that don't say anything about the rate limit are ignored.
+	void update(const rate_limit_info& limits);
+
+private:
+	std::mutex pacer_lock;
+	std::chrono::milliseconds interval{ 0 };
+	std::chrono::steady_clock::time_point next_request{};
+	std::chrono::steady_clock::time_point last_sent{};
+};
+
+// Mastodon counts uploads and deletes separately from everything else, and only allows 30 of each every half hour.
+// their headers say nothing about the general limit, so they get their own pacers instead of slowing down every other request.
+enum class rate_limit_group
+{
+	general,
+	media,
+	status_delete
+};
+
+// rate limits are per account on each instance, so each account, instance, and group gets its own pacer.
+rate_pacer& pacer_for(std::string_view url, std::string_view access_token, rate_limit_group group = rate_limit_group::general);
+
+#endif
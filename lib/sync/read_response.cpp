@@ -180,27 +180,121 @@ mastodon_status read_status(const std::string_view status_json)
 	return json::parse(status_json).get<mastodon_status>();
 }
 
-std::vector<mastodon_status> read_statuses(const std::string_view timeline_json)
-{
-	return json::parse(timeline_json).get<std::vector<mastodon_status>>();
-}
-
 mastodon_notification read_notification(const std::string_view notification_json)
 {
 	return json::parse(notification_json).get<mastodon_notification>();
 }
 
-std::vector<mastodon_notification> read_notifications(const std::string_view notifications_json)
-{
-	return json::parse(notifications_json).get<std::vector<mastodon_notification>>();
-}
-
+// parsing a whole thread into a json DOM and then converting that means the thread is in memory three times over:
+// once as text, once as json, and once as entities. Instead, this converts each post in ancestors and descendants
+// as soon as the parser finishes it and then tells the parser to throw that post's json away,
+// so there's only ever one post's worth of json around at a time.
 mastodon_context read_context(const std::string_view context_json)
 {
-	return json::parse(context_json).get<mastodon_context>();
+	mastodon_context context;
+	std::vector<mastodon_status>* current = nullptr;
+
+	const json parsed = json::parse(context_json, [&context, &current](int depth, json::parse_event_t event, json& element)
+	{
+		// keys of the top level object come in at depth 1
+		if (depth == 1 && event == json::parse_event_t::key)
+		{
+			const auto& key = element.get_ref<const std::string&>();
+			current = key == "ancestors" ? &context.ancestors : key == "descendants" ? &context.descendants : nullptr;
+			return true;
+		}
+
+		// depth is the depth after leaving the object, so posts in the top level object's arrays end at depth 2.
+		if (depth != 2 || event != json::parse_event_t::object_end || current == nullptr)
+			return true;
+
+		current->push_back(element.get<mastodon_status>());
+		return false;
+	});
+
+	// if this wasn't shaped like a context after all (like an error object), say what's wrong with it.
+	// at() throws instead of asserting when a key is missing, which is what from_json's [] would do.
+	if (!parsed.is_object() || !parsed.at("ancestors").is_array() || !parsed.at("descendants").is_array())
+	{
+		parsed.at("ancestors").get_to(context.ancestors);
+		parsed.at("descendants").get_to(context.descendants);
+	}
+
+	return context;
 }
 
 std::string read_upload_id(const std::string_view attachment_json)
 {
 	return json::parse(attachment_json)["id"].get<std::string>();
 }
+
+page_summary summarize_page(const std::string_view array_json)
+{
+	page_summary summary;
+
+	// the top level array is depth 1, so the keys for each status or notification are at depth 2.
+	// anything deeper, like the account's ID, doesn't matter here.
+	int depth = 0;
+	bool in_string = false;
+	bool escaped = false;
+	size_t string_start = 0;
+	std::string_view last_string;
+	bool value_is_id = false;
+
+	for (size_t i = 0; i < array_json.size(); i++)
+	{
+		const char c = array_json[i];
+		if (in_string)
+		{
+			if (escaped)
+				escaped = false;
+			else if (c == '\\')
+				escaped = true;
+			else if (c == '"')
+			{
+				in_string = false;
+				if (depth == 2 && summary.count == 1)
+				{
+					const auto str = array_json.substr(string_start, i - string_start);
+					if (value_is_id)
+						summary.first_id = str;
+					value_is_id = false;
+					last_string = str;
+				}
+			}
+			continue;
+		}
+
+		switch (c)
+		{
+		case '"':
+			in_string = true;
+			string_start = i + 1;
+			break;
+		case ':':
+			// the string right before a colon is a key
+			if (depth == 2 && summary.count == 1 && summary.first_id.empty())
+				value_is_id = last_string == "id"sv;
+			break;
+		case ',':
+			value_is_id = false;
+			break;
+		case '{':
+			if (depth == 1)
+				summary.count++;
+			depth++;
+			break;
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			depth--;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return summary;
+}
@@ -16,4 +16,14 @@ std::vector<mastodon_notification> read_notifications(std::string_view notificat
 mastodon_context read_context(std::string_view context_json);
 std::string read_upload_id(std::string_view attachment_json);
 
+// what can be known about a page of statuses or notifications without actually parsing it:
+// how many there are and the ID of the first (newest) one.
+// this is one quick pass over the text that only keeps track of brackets and strings, so it doesn't check that the JSON is any good.
+struct page_summary
+{
+	size_t count = 0;
+	std::string first_id;
+};
+page_summary summarize_page(std::string_view array_json);
+
 #endif
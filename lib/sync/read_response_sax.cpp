@@ -0,0 +1,496 @@
+#include "read_response.hpp"
+
+#include <nlohmann/json.hpp>
+#include <msync_exception.hpp>
+
+#include "../util/util.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+using namespace std::string_view_literals;
+
+// the from_json overloads in read_response.cpp need a whole json DOM to work with, which means building a json value for
+// everything in the response, including big stuff msync never looks at, like emojis, cards, tags, and the application a post was made with.
+// since timelines and notifications are most of what msync downloads, those get read with nlohmann's SAX interface instead.
+// the parser tells the reader about each key and value as it sees them, the reader copies out the handful it wants
+// straight into the entities, and everything else is skipped over without being kept.
+// this should always produce the same results as the from_json overloads, including how boosts get unwrapped.
+
+// a status, plus the things from_json pulls out of the json that don't go straight into mastodon_status
+struct raw_status
+{
+	mastodon_status status;
+	std::vector<std::pair<std::string, std::string>> mentions;
+	std::unique_ptr<raw_status> reblog;
+};
+
+struct raw_notification
+{
+	mastodon_notification notification;
+	std::unique_ptr<raw_status> status;
+};
+
+// every key msync cares about. anything else is unknown and gets skipped.
+enum class json_key : uint8_t
+{
+	unknown, id, uri, url, spoiler_text, content, visibility, reblog, account, acct, bot, display_name, username, mentions, in_reply_to_id,
+	created_at, favourites_count, reblogs_count, replies_count, media_attachments, poll, note, avatar, fields, name, value, description,
+	expires_at, expired, votes_count, options, title, voted, own_votes, type, status
+};
+
+constexpr std::array<std::pair<std::string_view, json_key>, 35> json_key_names{ {
+	{ "id"sv, json_key::id }, { "uri"sv, json_key::uri }, { "url"sv, json_key::url }, { "spoiler_text"sv, json_key::spoiler_text },
+	{ "content"sv, json_key::content }, { "visibility"sv, json_key::visibility }, { "reblog"sv, json_key::reblog }, { "account"sv, json_key::account },
+	{ "acct"sv, json_key::acct }, { "bot"sv, json_key::bot }, { "display_name"sv, json_key::display_name }, { "username"sv, json_key::username },
+	{ "mentions"sv, json_key::mentions }, { "in_reply_to_id"sv, json_key::in_reply_to_id }, { "created_at"sv, json_key::created_at },
+	{ "favourites_count"sv, json_key::favourites_count }, { "reblogs_count"sv, json_key::reblogs_count }, { "replies_count"sv, json_key::replies_count },
+	{ "media_attachments"sv, json_key::media_attachments }, { "poll"sv, json_key::poll }, { "note"sv, json_key::note }, { "avatar"sv, json_key::avatar },
+	{ "fields"sv, json_key::fields }, { "name"sv, json_key::name }, { "value"sv, json_key::value }, { "description"sv, json_key::description },
+	{ "expires_at"sv, json_key::expires_at }, { "expired"sv, json_key::expired }, { "votes_count"sv, json_key::votes_count },
+	{ "options"sv, json_key::options }, { "title"sv, json_key::title }, { "voted"sv, json_key::voted }, { "own_votes"sv, json_key::own_votes },
+	{ "type"sv, json_key::type }, { "status"sv, json_key::status }
+} };
+
+json_key lookup_key(const std::string_view key)
+{
+	for (const auto& known : json_key_names)
+	{
+		if (known.first == key)
+			return known.second;
+	}
+	return json_key::unknown;
+}
+
+notif_type parse_notif_type(const std::string_view type)
+{
+	if (type == "follow"sv) return notif_type::follow;
+	if (type == "mention"sv) return notif_type::mention;
+	if (type == "reblog"sv) return notif_type::boost;
+	if (type == "poll"sv) return notif_type::poll;
+	if (type == "favourite"sv) return notif_type::favorite;
+	return notif_type::unknown;
+}
+
+// what kind of json object or array the reader is currently inside of
+enum class json_scope : uint8_t
+{
+	status_array, notification_array, status, notification, account, fields, field, attachments, attachment,
+	mentions, mention, poll, poll_options, poll_option, own_votes
+};
+
+struct scope_frame
+{
+	json_scope scope;
+	void* target; // the thing being filled in. What type it is depends on the scope.
+	json_key key = json_key::unknown; // the most recent key seen in this object
+};
+
+template <typename T>
+T& target_of(const scope_frame& frame)
+{
+	return *static_cast<T*>(frame.target);
+}
+
+mastodon_status finish_status(raw_status&& raw)
+{
+	mastodon_status status = std::move(raw.status);
+	const auto* mentions = &raw.mentions;
+
+	// if this post is a boost, the post itself is in the reblog object, and the outer status is about who boosted it.
+	// the content, content warning, visibility, ID, and poll still come from the outer status, same as from_json.
+	if (raw.reblog != nullptr)
+	{
+		mastodon_status& original = raw.reblog->status;
+		status.boosted_by = std::move(status.author.account_name);
+		status.boosted_by_bot = status.author.is_bot;
+		status.boosted_by_display_name = std::move(status.author.display_name);
+		status.original_post_url = std::move(original.url);
+		status.reply_to_post_id = std::move(original.reply_to_post_id);
+		status.created_at = std::move(original.created_at);
+		status.favorites = original.favorites;
+		status.boosts = original.boosts;
+		status.replies = original.replies;
+		status.attachments = std::move(original.attachments);
+		status.author = std::move(original.author);
+		mentions = &raw.reblog->mentions;
+	}
+
+	std::vector<std::pair<std::string_view, std::string_view>> mention_views;
+	mention_views.reserve(mentions->size());
+	for (const auto& mention : *mentions)
+		mention_views.emplace_back(mention.first, mention.second);
+
+	bulk_replace_mentions(status.content, mention_views);
+	return status;
+}
+
+mastodon_notification finish_notification(raw_notification&& raw)
+{
+	mastodon_notification notification = std::move(raw.notification);
+	if (raw.status != nullptr)
+		notification.status = finish_status(std::move(*raw.status));
+	return notification;
+}
+
+template <typename entity>
+class entity_reader
+{
+	using raw_entity = std::conditional_t<std::is_same_v<entity, mastodon_status>, raw_status, raw_notification>;
+
+public:
+	std::vector<entity> entities;
+
+	bool null() { return scalar_is_allowed(); }
+
+	bool boolean(bool val)
+	{
+		if (skipping()) return true;
+
+		const auto& frame = top();
+		switch (frame.scope)
+		{
+		case json_scope::account:
+			if (frame.key == json_key::bot) target_of<mastodon_account>(frame).is_bot = val;
+			break;
+		case json_scope::poll:
+			if (frame.key == json_key::expired) target_of<mastodon_poll>(frame).expired = val;
+			else if (frame.key == json_key::voted) target_of<mastodon_poll>(frame).you_voted = val;
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	bool number_integer(json::number_integer_t val) { return number(val); }
+	bool number_unsigned(json::number_unsigned_t val) { return number(val); }
+	bool number_float(json::number_float_t, const json::string_t&) { return scalar_is_allowed(); }
+	bool binary(json::binary_t&) { return scalar_is_allowed(); }
+
+	bool string(json::string_t& val)
+	{
+		if (skipping()) return true;
+
+		const auto& frame = top();
+		switch (frame.scope)
+		{
+		case json_scope::status:
+		{
+			auto& status = target_of<raw_status>(frame).status;
+			switch (frame.key)
+			{
+			case json_key::id: status.id = val; break;
+			case json_key::uri: status.url = val; break;
+			case json_key::spoiler_text: status.content_warning = clean_up_html(val); break;
+			case json_key::content: status.content = clean_up_html(val); break;
+			case json_key::visibility: status.visibility = val; break;
+			case json_key::in_reply_to_id: status.reply_to_post_id = val; break;
+			case json_key::created_at: status.created_at = val; break;
+			default: break;
+			}
+			break;
+		}
+		case json_scope::account:
+		{
+			auto& account = target_of<mastodon_account>(frame);
+			switch (frame.key)
+			{
+			case json_key::id: account.id = val; break;
+			case json_key::acct: account.account_name = val; break;
+			case json_key::display_name: account.display_name = val; break;
+			case json_key::note: account.note = clean_up_html(val); break;
+			case json_key::url: account.url = val; break;
+			case json_key::avatar: account.avatar = val; break;
+			default: break;
+			}
+			break;
+		}
+		case json_scope::field:
+		{
+			auto& field = target_of<mastodon_account_field>(frame);
+			if (frame.key == json_key::name) field.name = val;
+			else if (frame.key == json_key::value) field.value = clean_up_html(val); // these can be HTML if they're links
+			break;
+		}
+		case json_scope::attachment:
+		{
+			auto& attachment = target_of<mastodon_attachment>(frame);
+			if (frame.key == json_key::url) attachment.url = val;
+			else if (frame.key == json_key::description) attachment.description = val;
+			break;
+		}
+		case json_scope::mention:
+		{
+			auto& mention = target_of<std::pair<std::string, std::string>>(frame);
+			if (frame.key == json_key::username) mention.first = val;
+			else if (frame.key == json_key::acct) mention.second = val;
+			break;
+		}
+		case json_scope::poll:
+		{
+			auto& poll = target_of<mastodon_poll>(frame);
+			if (frame.key == json_key::id) poll.id = val;
+			else if (frame.key == json_key::expires_at) poll.expires_at = val;
+			break;
+		}
+		case json_scope::poll_option:
+			if (frame.key == json_key::title) target_of<mastodon_poll_option>(frame).title = val;
+			break;
+		case json_scope::notification:
+		{
+			auto& notification = target_of<raw_notification>(frame).notification;
+			switch (frame.key)
+			{
+			case json_key::id: notification.id = val; break;
+			case json_key::type: notification.type = parse_notif_type(val); break;
+			case json_key::created_at: notification.created_at = val; break;
+			default: break;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+		return true;
+	}
+
+	bool key(json::string_t& val)
+	{
+		if (!skipping())
+			top().key = lookup_key(val);
+		return true;
+	}
+
+	bool start_object(std::size_t)
+	{
+		if (skipping())
+		{
+			skip_depth++;
+			return true;
+		}
+
+		auto& frame = top();
+		switch (frame.scope)
+		{
+		case json_scope::status_array:
+		case json_scope::notification_array:
+			element = raw_entity{};
+			return enter(std::is_same_v<raw_entity, raw_status> ? json_scope::status : json_scope::notification, &element);
+		case json_scope::status:
+		{
+			auto& raw = target_of<raw_status>(frame);
+			switch (frame.key)
+			{
+			case json_key::reblog:
+				raw.reblog = std::make_unique<raw_status>();
+				return enter(json_scope::status, raw.reblog.get());
+			case json_key::account:
+				return enter(json_scope::account, &raw.status.author);
+			case json_key::poll:
+				return enter(json_scope::poll, &raw.status.poll.emplace());
+			default:
+				break;
+			}
+			break;
+		}
+		case json_scope::notification:
+		{
+			auto& raw = target_of<raw_notification>(frame);
+			if (frame.key == json_key::account)
+				return enter(json_scope::account, &raw.notification.account);
+			if (frame.key == json_key::status)
+			{
+				raw.status = std::make_unique<raw_status>();
+				return enter(json_scope::status, raw.status.get());
+			}
+			break;
+		}
+		case json_scope::fields:
+			return enter(json_scope::field, &target_of<std::vector<mastodon_account_field>>(frame).emplace_back());
+		case json_scope::attachments:
+			return enter(json_scope::attachment, &target_of<std::vector<mastodon_attachment>>(frame).emplace_back());
+		case json_scope::mentions:
+			return enter(json_scope::mention, &target_of<std::vector<std::pair<std::string, std::string>>>(frame).emplace_back());
+		case json_scope::poll_options:
+			return enter(json_scope::poll_option, &target_of<std::vector<mastodon_poll_option>>(frame).emplace_back());
+		default:
+			break;
+		}
+
+		skip_depth = 1;
+		return true;
+	}
+
+	bool end_object()
+	{
+		return leave();
+	}
+
+	bool start_array(std::size_t)
+	{
+		if (scopes.empty())
+			return enter(std::is_same_v<entity, mastodon_status> ? json_scope::status_array : json_scope::notification_array, nullptr);
+
+		if (skipping())
+		{
+			skip_depth++;
+			return true;
+		}
+
+		auto& frame = top();
+		switch (frame.scope)
+		{
+		case json_scope::status:
+		{
+			auto& raw = target_of<raw_status>(frame);
+			if (frame.key == json_key::media_attachments)
+				return enter(json_scope::attachments, &raw.status.attachments);
+			if (frame.key == json_key::mentions)
+				return enter(json_scope::mentions, &raw.mentions);
+			break;
+		}
+		case json_scope::account:
+			if (frame.key == json_key::fields)
+				return enter(json_scope::fields, &target_of<mastodon_account>(frame).fields);
+			break;
+		case json_scope::poll:
+			if (frame.key == json_key::options)
+				return enter(json_scope::poll_options, &target_of<mastodon_poll>(frame).options);
+			if (frame.key == json_key::own_votes)
+				return enter(json_scope::own_votes, &target_of<mastodon_poll>(frame).voted_for);
+			break;
+		default:
+			break;
+		}
+
+		skip_depth = 1;
+		return true;
+	}
+
+	bool end_array()
+	{
+		return leave();
+	}
+
+	bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex)
+	{
+		throw msync_exception(ex.what());
+	}
+
+private:
+	std::vector<scope_frame> scopes;
+	unsigned int skip_depth = 0;
+	raw_entity element;
+
+	bool skipping()
+	{
+		if (skip_depth > 0)
+			return true;
+
+		// a value outside of the top level array means this isn't an array at all
+		if (scopes.empty())
+			throw msync_exception("Expected a JSON array from the server, but got something else.");
+
+		return false;
+	}
+
+	bool scalar_is_allowed()
+	{
+		skipping();
+		return true;
+	}
+
+	scope_frame& top()
+	{
+		return scopes.back();
+	}
+
+	bool enter(json_scope scope, void* target)
+	{
+		scopes.push_back(scope_frame{ scope, target });
+		return true;
+	}
+
+	bool leave()
+	{
+		if (skip_depth > 0)
+		{
+			skip_depth--;
+			return true;
+		}
+
+		scopes.pop_back();
+
+		// if that just finished one of the top level array's elements, it's done and can be handed off
+		if (scopes.size() == 1)
+		{
+			if constexpr (std::is_same_v<raw_entity, raw_status>)
+				entities.push_back(finish_status(std::move(element)));
+			else
+				entities.push_back(finish_notification(std::move(element)));
+		}
+
+		return true;
+	}
+
+	template <typename number_type>
+	bool number(number_type val)
+	{
+		if (skipping()) return true;
+
+		const auto& frame = top();
+		switch (frame.scope)
+		{
+		case json_scope::status:
+		{
+			auto& status = target_of<raw_status>(frame).status;
+			switch (frame.key)
+			{
+			case json_key::favourites_count: status.favorites = static_cast<unsigned int>(val); break;
+			case json_key::reblogs_count: status.boosts = static_cast<unsigned int>(val); break;
+			case json_key::replies_count: status.replies = static_cast<unsigned int>(val); break;
+			default: break;
+			}
+			break;
+		}
+		case json_scope::poll:
+			if (frame.key == json_key::votes_count) target_of<mastodon_poll>(frame).total_votes = static_cast<int>(val);
+			break;
+		case json_scope::poll_option:
+			if (frame.key == json_key::votes_count) target_of<mastodon_poll_option>(frame).votes = static_cast<int>(val);
+			break;
+		case json_scope::own_votes:
+			target_of<std::vector<int>>(frame).push_back(static_cast<int>(val));
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+};
+
+template <typename entity>
+std::vector<entity> read_array(const std::string_view array_json)
+{
+	entity_reader<entity> reader;
+	json::sax_parse(array_json, &reader);
+	return std::move(reader.entities);
+}
+
+std::vector<mastodon_status> read_statuses(const std::string_view timeline_json)
+{
+	return read_array<mastodon_status>(timeline_json);
+}
+
+std::vector<mastodon_notification> read_notifications(const std::string_view notifications_json)
+{
+	return read_array<mastodon_notification>(notifications_json);
+}
@@ -9,10 +9,15 @@
 #include "../options/user_options.hpp"
 
 #include "../postlist/post_list.hpp"
+#include "../poststore/post_store.hpp"
 #include "../util/util.hpp"
+#include "../trace/trace.hpp"
 
 #include "sync_helpers.hpp"
 #include "recv_helpers.hpp"
+#include "spill_buffer.hpp"
+#include "checkpoint.hpp"
+#include "byte_budget.hpp"
 
 #include <filesystem.hpp>
 #include <string_view>
@@ -21,6 +26,10 @@
 #include <limits>
 #include <array>
 #include <utility>
+#include <optional>
+#include <future>
+#include <sstream>
+#include <initializer_list>
 
 template <typename get_posts>
 struct recv_posts
@@ -30,9 +39,25 @@ public:
 	unsigned int max_requests = 0;
 	unsigned int per_call = 0;
 
+	// newest_first has to hold on to everything it downloads until it's done. Past this many posts,
+	// the older ones get spilled to temporary files in the account's folder so memory use stays flat no matter how far behind it is.
+	size_t max_buffered_posts = 2000;
+
+	// the notifications, home timeline, and bookmarks each write to their own file and keep track of their own last ID,
+	// so they can be downloaded at the same time. Each timeline's output gets printed all at once when that timeline is done.
+	bool concurrent_timelines = false;
+
+	// if this is set, how much each timeline downloaded gets added to it.
+	sync_stats* stats = nullptr;
+
+	// if this is set, every request has to fit in it. A timeline that runs out stops at the end of a page,
+	// and its last ID is saved as usual, so the next sync picks up from there.
+	byte_budget* budget = nullptr;
+
 	recv_posts(get_posts& post_downloader) : download(post_downloader) {};
 
-	void get(user_options& account)
+	// the timelines get downloaded in the order they're given in, but only notifications, home, and bookmarks are supported.
+	void get(user_options& account, std::initializer_list<to_get> timelines = { to_get::notifications, to_get::home, to_get::bookmarks })
 	{
 		retries = set_default(retries, 3, "Number of retries cannot be zero or less. Resetting to 3.\n", pl());
 
@@ -46,22 +71,104 @@ public:
 		// otherwise, .filename() would get nothing.
 		const std::string account_name = to_utf8(account.get_user_directory().filename());
 
-		pl() << "Downloading notifications for " << account_name << '\n';
-		update_timeline<to_get::notifications, mastodon_notification, true>(account, account.get_user_directory(), clamp_or_default(per_call, 30));
+		// the timelines only read from the account while they download. The new last IDs get set afterwards, on this thread,
+		// so that nothing writes to the account's options while another timeline might be reading them.
+		std::array<last_id_update, 3> updates;
+		const auto apply_updates = [&account, &updates]()
+		{
+			for (auto& update : updates)
+			{
+				if (!update.highest_id.empty())
+					account.set_option(update.setting, std::move(update.highest_id));
+				update.highest_id.clear();
+			}
+		};
+
+		std::vector<size_t> to_run;
+		for (const auto timeline : timelines)
+		{
+			switch (timeline)
+			{
+			case to_get::notifications: to_run.push_back(0); break;
+			case to_get::home: to_run.push_back(1); break;
+			case to_get::bookmarks: to_run.push_back(2); break;
+			default: break;
+			}
+		}
 
-		pl() << "Downloading the home timeline for " << account_name << '\n';
-		update_timeline<to_get::home, mastodon_status>(account, account.get_user_directory(), clamp_or_default(per_call, 40));
+		// with a budget, the timelines have to go in order, so the ones that come first get first dibs on it
+		const bool concurrently = concurrent_timelines && budget == nullptr;
 
-		pl() << "Downloading bookmarks for " << account_name << '\n';
-		update_timeline<to_get::bookmarks, mastodon_status>(account, account.get_user_directory(), clamp_or_default(per_call, 40));
+		const auto get_timeline = [&](size_t idx)
+		{
+			if (stop_requested)
+				return;
+
+			std::optional<log_group> timeline_log;
+			if (concurrently)
+				timeline_log.emplace();
+
+			transfer_totals transferred;
+			const char* timeline_name = "";
+			switch (idx)
+			{
+			case 0:
+				pl() << "Downloading notifications for " << account_name << '\n';
+				timeline_name = "notifications";
+				updates[0] = update_timeline<to_get::notifications, mastodon_notification, true>(account, account.get_user_directory(), clamp_or_default(per_call, 30), transferred);
+				break;
+			case 1:
+				pl() << "Downloading the home timeline for " << account_name << '\n';
+				timeline_name = "home";
+				updates[1] = update_timeline<to_get::home, mastodon_status>(account, account.get_user_directory(), clamp_or_default(per_call, 40), transferred);
+				break;
+			case 2:
+				pl() << "Downloading bookmarks for " << account_name << '\n';
+				timeline_name = "bookmarks";
+				updates[2] = update_timeline<to_get::bookmarks, mastodon_status>(account, account.get_user_directory(), clamp_or_default(per_call, 40), transferred);
+				break;
+			}
+
+			if (stats != nullptr && transferred.requests != 0)
+				stats->add_timeline(account_name, timeline_name, transferred);
+		};
+
+		if (!concurrently)
+		{
+			for (const size_t idx : to_run)
+			{
+				get_timeline(idx);
+				apply_updates();
+			}
+			return;
+		}
+
+		// if one of the timelines fails, still hang on to what the others got
+		try
+		{
+			parallel_for(to_run.size(), static_cast<unsigned int>(to_run.size()), [&](size_t i) { get_timeline(to_run[i]); });
+		}
+		catch (...)
+		{
+			apply_updates();
+			throw;
+		}
+
+		apply_updates();
 	}
 
 private:
 	get_posts& download;
 	std::vector<std::string_view> exclude_notif_types;
 
+	struct last_id_update
+	{
+		user_option setting{};
+		std::string highest_id;
+	};
+
 	template <to_get timeline, typename mastodon_entity, bool use_excludes = false>
-	void update_timeline(user_options& account, const fs::path& user_folder, unsigned int limit)
+	last_id_update update_timeline(const user_options& account, const fs::path& user_folder, unsigned int limit, transfer_totals& transferred)
 	{
 		const CONSTEXPR_IF_NOT_BOOST recv_parameters params = get_parameters<timeline>();
 
@@ -70,13 +177,24 @@ private:
 		if (sync_method == sync_settings::dont_sync)
 		{
 			pl() << "Set to don't sync. Skipping.\n";
-			return;
+			return {};
 		}
 
 		const std::string& access_token = account.get_option(user_option::access_token);
 
 		const std::string_view last_recorded_id = get_or_empty(account.try_get_option(params.last_id_setting));
 
+		const bool use_store = account.get_bool_option(user_option::post_store);
+		fs::path target = user_folder / params.filename;
+		if (use_store)
+			target.replace_extension(Post_Store_Extension);
+
+		// if the last sync got cut off, it might have gotten further than the option says
+		const fs::path checkpoint = checkpoint_file(target);
+		const std::string resume_id = resume_from(checkpoint, last_recorded_id);
+		if (resume_id != last_recorded_id)
+			pl() << "Picking up where the last sync left off, after " << resume_id << '\n';
+
 		const std::string url = make_api_url(account.get_option(user_option::instance_url), params.route);
 
 		// if last_id isn't set, we just wanna get a bunch of posts from the server, newest first
@@ -88,33 +206,51 @@ private:
 		// the other thing to keep in mind is that the newest posts are first back from the API (that is, the highest ID is at position 0)
 		// but should be written to the file so that the newest post is at the bottom of the file, and so the lowest ID should be written first
 
-		const fs::path target_file = user_folder / params.filename;
-		plverb() << "Writing to " << target_file << '\n';
+		const auto download_into = [&](auto& writer, auto after_page)
+		{
+			std::string highest_id;
 
-		post_list<mastodon_entity> writer{ target_file };
-		std::string highest_id;
+			if (resume_id.empty() || sync_method == sync_settings::newest_first)
+			{
+				highest_id = newest_first<mastodon_entity, use_excludes>(writer, user_folder / params.filename, url, access_token, resume_id, limit, transferred);
+			}
+			else if (sync_method == sync_settings::oldest_first) //else if because dont_sync is an option (not that a dont_sync should get here) and to save a comparison
+			{
+				highest_id = oldest_first<mastodon_entity, use_excludes>(writer, after_page, url, access_token, resume_id, limit, transferred);
+			}
 
-		if (last_recorded_id.empty() || sync_method == sync_settings::newest_first)
-		{
-			highest_id = newest_first<mastodon_entity, use_excludes>(writer, url, access_token, last_recorded_id, limit);
-		}
-		else if (sync_method == sync_settings::oldest_first) //else if because dont_sync is an option (not that a dont_sync should get here) and to save a comparison
+			// if there was nothing new, the option still has to catch up to the checkpoint
+			if (highest_id.empty() && resume_id != last_recorded_id)
+				highest_id = resume_id;
+
+			return highest_id;
+		};
+
+		plverb() << "Writing to " << target << '\n';
+
+		if (use_store)
 		{
-			highest_id = oldest_first<mastodon_entity, use_excludes>(writer, url, access_token, last_recorded_id, limit);
+			// rewriting the indexes after every page would cost more than it saves.
+			// a post that gets downloaded twice just replaces itself in a store, so a sync that gets cut off only costs some time.
+			post_store<mastodon_entity> writer{ target };
+			return { params.last_id_setting, download_into(writer, [](const std::string&) {}) };
 		}
 
-		if (!highest_id.empty())
+		post_list<mastodon_entity> writer{ target };
+		return { params.last_id_setting, download_into(writer, [&](const std::string& written_through)
 		{
-			account.set_option(params.last_id_setting, std::move(highest_id));
-		}
+			if (writer.flush())
+				write_checkpoint(checkpoint, last_recorded_id, written_through);
+		}) };
 	}
 
-	template <typename mastodon_entity, bool use_excludes>
-	std::string newest_first(post_list<mastodon_entity>& writer, const std::string_view url, const std::string_view access_token, const std::string_view last_recorded_id, unsigned int limit)
+	template <typename mastodon_entity, bool use_excludes, typename post_writer>
+	std::string newest_first(post_writer& writer, const fs::path& spill_base, const std::string_view url, const std::string_view access_token, const std::string_view last_recorded_id, unsigned int limit, transfer_totals& transferred)
 	{
 		std::string max_id;
 
-		std::vector<mastodon_entity> total, incoming;
+		spill_buffer<mastodon_entity> total{ spill_base, max_buffered_posts };
+		std::vector<mastodon_entity> incoming;
 
 		timeline_params query_parameters;
 		query_parameters.since_id = last_recorded_id;
@@ -132,30 +268,53 @@ private:
 		{
 			query_parameters.max_id = max_id;
 
+			// running out works just like running out of max_requests. Whatever's been downloaded gets written.
+			const auto reservation = reserve_from(budget);
+			if (!reservation.has_value())
+			{
+				pl() << "Stopping here to stay under the data limit.\n";
+				break;
+			}
+
 			print_api_call(url, limit, query_parameters, pl());
 
-			auto response = request_with_retries([&]() { return download(url, access_token, query_parameters, limit); }, retries, pl());
+			auto response = request_with_retries([&]() { return download(url, access_token, query_parameters, limit); }, retries, pl(), &pacer_for(url, access_token));
 
 			print_statistics(pl(), response.time_ms, response.tries);
+			transferred += response.transferred;
+			settle_with(budget, *reservation, response.transferred);
 
 			if (!response.success)
 			{
 				break;
 			}
 
-			incoming = deserialize<mastodon_entity>(response.message);
+			{
+				trace_scope parsing{ "parse page", "cpu", "clean_us" };
+				incoming = deserialize<mastodon_entity>(response.message);
+				parsing.args.add("posts", incoming.size()).add("bytes", response.message.size());
+			}
 
 			plverb() << "Downloaded " << incoming.size() << pluralize(incoming.size(), " post, ", " posts, ");
+			transferred.posts += incoming.size();
 
 			if (!incoming.empty())
 			{
 				// can only call lowest_id on a non-empty vector
 				max_id = lowest_id(incoming);
-				total.insert(total.end(), std::make_move_iterator(incoming.begin()), std::make_move_iterator(incoming.end()));
+				total.add(incoming);
 			}
 
 			plverb() << total.size() << pluralize(total.size(), " post", " posts") << " buffered.\n";
 
+			// nothing's been written yet, and writing only part of what's new would leave a gap, so just drop it all.
+			// the next sync will start from the same place.
+			if (stop_requested)
+			{
+				pl() << "Stopping early. Nothing new was saved.\n";
+				return "";
+			}
+
 			loop_iterations--;
 
 			// if you get less than you asked for, you're done
@@ -163,18 +322,22 @@ private:
 
 		plverb() << "Writing " << total.size() << pluralize(total.size(), " post.", " posts.") << '\n';
 
-		if (!total.empty())
+		if (total.size() != 0)
 		{
-			// we want the latest post (highest ID) to be last, but it's in position 0, so iterate backwards
-			std::for_each(total.rbegin(), total.rend(), [&writer](const auto& elem) { writer.write(elem); });
-			return total.front().id;
+			trace_scope writing{ "write posts", "cpu" };
+			writing.args.add("posts", total.size()).add("spills", total.spilled());
+
+			// we want the latest post (highest ID) to be last, but it came in first
+			total.write_oldest_first(writer);
+			return total.newest_id();
 		}
 
 		return "";
 	}
 
-	template <typename mastodon_entity, bool use_excludes>
-	std::string oldest_first(post_list<mastodon_entity>& writer, const std::string_view url, const std::string_view access_token, const std::string_view last_recorded_id, unsigned int limit)
+	// after_page gets called with the newest ID after each page is written.
+	template <typename mastodon_entity, bool use_excludes, typename post_writer, typename page_callback>
+	std::string oldest_first(post_writer& writer, page_callback& after_page, const std::string_view url, const std::string_view access_token, const std::string_view last_recorded_id, unsigned int limit, transfer_totals& transferred)
 	{
 		std::vector<mastodon_entity> incoming;
 
@@ -191,38 +354,134 @@ private:
 		if (loop_iterations == 0)
 			loop_iterations = std::numeric_limits<unsigned int>::max();
 
+		// while one page is being parsed and written, the next one is already downloading.
+		// it prints to its own log, which gets printed when its turn comes, so the output's in the same order as if it wasn't.
+		struct prefetched_page
+		{
+			std::string min_id;
+			request_response response;
+			std::string log;
+			unsigned long long reservation;
+		};
+
+		const auto fetch = [&](const timeline_params& params, auto& os)
+		{
+			print_api_call(url, limit, params, os);
+			auto response = request_with_retries([&]() { return download(url, access_token, params, limit); }, retries, os, &pacer_for(url, access_token));
+			print_statistics(os, response.time_ms, response.tries);
+			return response;
+		};
+
+		// declared after everything the download borrows, so that if something throws, this waits for the download before they go away
+		std::future<prefetched_page> next_page;
+
 		size_t total_posts_written = 0;
 		do
 		{
-			print_api_call(url, limit, query_parameters, pl());
+			request_response response;
 
-			const auto response = request_with_retries([&]() { return download(url, access_token, query_parameters, limit); }, retries, pl());
+			// the next page's min_id came from a quick look at the last page, so double check it against what actually got parsed
+			std::optional<prefetched_page> prefetched;
+			if (next_page.valid())
+				prefetched.emplace(next_page.get());
 
-			print_statistics(pl(), response.time_ms, response.tries);
+			if (prefetched.has_value() && prefetched->min_id == query_parameters.min_id)
+			{
+				pl() << prefetched->log;
+				response = std::move(prefetched->response);
+				settle_with(budget, prefetched->reservation, response.transferred);
+			}
+			else
+			{
+				// a prefetched page that didn't get used still cost something
+				if (prefetched.has_value())
+				{
+					transferred += prefetched->response.transferred;
+					settle_with(budget, prefetched->reservation, prefetched->response.transferred);
+				}
+
+				const auto reservation = reserve_from(budget);
+				if (!reservation.has_value())
+				{
+					pl() << "Stopping here to stay under the data limit.\n";
+					break;
+				}
+
+				response = fetch(query_parameters, pl());
+				settle_with(budget, *reservation, response.transferred);
+			}
+
+			transferred += response.transferred;
 
 			if (!response.success)
 			{
 				break;
 			}
 
-			incoming = deserialize<mastodon_entity>(response.message);
+			// if this page is full, there's probably another one after it, and it starts after this page's first post.
+			// both of those can be found without parsing the whole thing, so start downloading the next page now.
+			if (loop_iterations > 1)
+			{
+				auto summary = summarize_page(response.message);
+				std::optional<unsigned long long> reservation;
+				if (summary.count == limit && !summary.first_id.empty() && (reservation = reserve_from(budget)).has_value())
+				{
+					next_page = std::async(std::launch::async, [&fetch, params = query_parameters, min_id = std::move(summary.first_id), reservation = *reservation]() mutable
+					{
+						params.min_id = min_id;
+						std::ostringstream log;
+						auto page_response = fetch(params, log);
+						return prefetched_page{ std::move(min_id), std::move(page_response), log.str(), reservation };
+					});
+				}
+			}
+
+			{
+				trace_scope parsing{ "parse page", "cpu", "clean_us" };
+				incoming = deserialize<mastodon_entity>(response.message);
+				parsing.args.add("posts", incoming.size()).add("bytes", response.message.size());
+			}
 
 			plverb() << "Writing " << incoming.size() << pluralize(incoming.size(), " post.", " posts.") << '\n';
 			total_posts_written += incoming.size();
+			transferred.posts += incoming.size();
 
 			if (!incoming.empty())
 			{
 				query_parameters.min_id = highest_id_seen = highest_id(incoming);
 
+				trace_scope writing{ "write posts", "cpu" };
+				writing.args.add("posts", incoming.size());
+
 				// we want the latest post (highest ID) to be last, but it's in position 0, so iterate backwards
-				std::for_each(incoming.rbegin(), incoming.rend(), [&writer](const auto& elem) { writer.write(elem); });
+				writer.write(incoming.rbegin(), incoming.rend());
+				after_page(highest_id_seen);
 			}
 
 			--loop_iterations;
 
+			if (stop_requested)
+			{
+				pl() << "Stopping early. Everything downloaded so far was saved.\n";
+				break;
+			}
+
 			// if you get less than you asked for, you're done
 		} while (loop_iterations > 0 && (incoming.size() == limit));
 
+		// if it stopped early, there might be one more page on its way.
+		// nothing's going to use it, so if that went wrong, it doesn't matter.
+		if (next_page.valid())
+		{
+			try
+			{
+				const auto unused = next_page.get();
+				transferred += unused.response.transferred;
+				settle_with(budget, unused.reservation, unused.response.transferred);
+			}
+			catch (...) { }
+		}
+
 		plverb() << "Wrote a total of " << total_posts_written << pluralize(total_posts_written, " post.", " posts.") << '\n';
 		return highest_id_seen;
 	}
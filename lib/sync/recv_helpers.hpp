@@ -9,8 +9,7 @@
 #include "../constants/constants.hpp"
 
 #include "read_response.hpp"
-
-enum class to_get { notifications, home, dms, lists, bookmarks };
+#include "timelines.hpp"
 
 struct recv_parameters { user_option last_id_setting; user_option sync_setting; std::string_view route; const CONSTANT_PATH_TYPE& filename; };
 
@@ -0,0 +1,164 @@
+#include "response_cache.hpp"
+
+#include "../util/util.hpp"
+
+#include <print_logger.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+void append_param(std::string& key, const char* name, const std::string_view value)
+{
+	if (value.empty())
+		return;
+
+	key.append(1, '\n').append(name).append(1, '=').append(value);
+}
+
+std::string response_cache_key(const std::string_view url, const timeline_params& params, const unsigned int limit)
+{
+	std::string key{ url };
+	append_param(key, "limit", std::to_string(limit));
+	append_param(key, "min_id", params.min_id);
+	append_param(key, "max_id", params.max_id);
+	append_param(key, "since_id", params.since_id);
+	if (params.exclude_notifs != nullptr)
+	{
+		for (const auto exclude : *params.exclude_notifs)
+			append_param(key, "exclude_types", exclude);
+	}
+	return key;
+}
+
+fs::path response_cache_file(const fs::path& cache_dir, const std::string_view key)
+{
+	return cache_dir / (hash_to_hex(fnv1a(key)) + ".response");
+}
+
+// the file is the key, the etag, and the last modified date, each on their own line, and then the body.
+// none of the first three can have a newline in them, since they're all from the url or the headers.
+std::optional<cached_response> read_cached_response(const fs::path& file, const std::string_view key)
+{
+	std::ifstream cachefile{ file.c_str(), std::ios::binary };
+	if (!cachefile.is_open())
+		return std::nullopt;
+
+	std::string saved_key;
+	// the key might have newlines in it, one for each parameter, so read exactly as many lines as it has
+	const auto key_lines = std::count(key.begin(), key.end(), '\n') + 1;
+	for (int i = 0; i < key_lines; i++)
+	{
+		std::string line;
+		if (!std::getline(cachefile, line))
+			return std::nullopt;
+		if (i != 0)
+			saved_key.push_back('\n');
+		saved_key += line;
+	}
+
+	if (saved_key != key)
+	{
+		plverb() << "Ignoring cached response in " << file << " for a different request.\n";
+		return std::nullopt;
+	}
+
+	cached_response toreturn;
+	if (!std::getline(cachefile, toreturn.etag) || !std::getline(cachefile, toreturn.last_modified))
+		return std::nullopt;
+
+	toreturn.body.assign(std::istreambuf_iterator<char>{ cachefile }, std::istreambuf_iterator<char>{});
+	return toreturn;
+}
+
+void write_cached_response(const fs::path& file, const std::string_view key, const cached_response& response)
+{
+	const auto cache_dir = file.parent_path();
+	if (!fs::exists(cache_dir))
+		fs::create_directories(cache_dir);
+
+	const fs::path temp = fs::path{ file }.concat(".tmp");
+
+#if MSYNC_USE_BOOST
+	boost::system::error_code ec;
+#else
+	std::error_code ec;
+#endif
+	{
+		std::ofstream cachefile{ temp.c_str(), std::ios::binary | std::ios::trunc };
+		cachefile << key << '\n' << response.etag << '\n' << response.last_modified << '\n' << response.body;
+		cachefile.close();
+		if (!cachefile)
+		{
+			// not having it saved just means downloading the whole thing again next time
+			plverb() << "Couldn't save the response to " << file << '\n';
+			fs::remove(temp, ec);
+			return;
+		}
+	}
+
+	fs::rename(temp, file, ec);
+	if (ec)
+	{
+		// Windows sometimes won't rename over a file that's already there
+		fs::remove(file, ec);
+		fs::rename(temp, file, ec);
+		if (ec)
+			fs::remove(temp, ec);
+	}
+}
+
+void forget_cached_response(const fs::path& file)
+{
+#if MSYNC_USE_BOOST
+	boost::system::error_code ec;
+#else
+	std::error_code ec;
+#endif
+	fs::remove(file, ec);
+}
+
+void touch_cached_response(const fs::path& file)
+{
+#if MSYNC_USE_BOOST
+	boost::system::error_code ec;
+	fs::last_write_time(file, std::time(nullptr), ec);
+#else
+	std::error_code ec;
+	fs::last_write_time(file, fs::file_time_type::clock::now(), ec);
+#endif
+}
+
+size_t prune_response_cache(const fs::path& cache_dir, const std::chrono::hours max_age)
+{
+#if MSYNC_USE_BOOST
+	boost::system::error_code ec;
+	const auto cutoff = std::time(nullptr) - std::chrono::duration_cast<std::chrono::seconds>(max_age).count();
+#else
+	std::error_code ec;
+	const auto cutoff = fs::file_time_type::clock::now() - max_age;
+#endif
+
+	size_t removed = 0;
+	for (fs::directory_iterator entry{ cache_dir, ec }, end; !ec && entry != end; entry.increment(ec))
+	{
+		// leftover temporary files from a sync that died get cleaned up the same way
+		const auto extension = entry->path().extension();
+		if (extension != ".response" && extension != ".tmp")
+			continue;
+
+		const auto last_used = fs::last_write_time(entry->path(), ec);
+		if (ec)
+		{
+			ec.clear();
+			continue;
+		}
+
+		if (last_used < cutoff && fs::remove(entry->path(), ec))
+			removed++;
+		ec.clear();
+	}
+	return removed;
+}
@@ -0,0 +1,97 @@
+#ifndef MSYNC_RESPONSE_CACHE_HPP
+#define MSYNC_RESPONSE_CACHE_HPP
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <utility>
+
+#include <filesystem.hpp>
+
+#include "../netinterface/net_interface.hpp"
+
+// what's kept on disk for each request: the body the server sent, and whatever it gave us to ask about it again later.
+struct cached_response
+{
+	std::string etag;
+	std::string last_modified;
+	std::string body;
+};
+
+// everything that changes what comes back from a GET, so different pages of the same url don't get mixed up.
+std::string response_cache_key(std::string_view url, const timeline_params& params, unsigned int limit);
+
+// the file in cache_dir that the response for this key goes in.
+fs::path response_cache_file(const fs::path& cache_dir, std::string_view key);
+
+// returns nothing if there's no file, or if it's for some other key that happened to hash to the same file name.
+std::optional<cached_response> read_cached_response(const fs::path& file, std::string_view key);
+
+// writes to a temporary file and renames it over the old one, so a sync that dies halfway through can't leave half a body behind.
+void write_cached_response(const fs::path& file, std::string_view key, const cached_response& response);
+
+void forget_cached_response(const fs::path& file);
+
+// marks a saved response as just used.
+void touch_cached_response(const fs::path& file);
+
+// every time a saved response gets used, its file gets touched, so this can tell which ones nothing's asked for in a while.
+// removes the responses in cache_dir that haven't been written or used in max_age, and returns how many it removed.
+size_t prune_response_cache(const fs::path& cache_dir, std::chrono::hours max_age);
+
+// a month is long enough that threads someone's still looking at stay cached.
+constexpr std::chrono::hours Response_Cache_Lifetime{ 24 * 30 };
+
+// wraps a get_timeline-shaped function and remembers what it returns in cache_dir.
+// if there's already a response saved for a request, the request is sent with If-None-Match and If-Modified-Since,
+// and when the server answers with a 304, the saved body gets handed back like a normal 200.
+// that way, refetching something big that hasn't changed, like a long thread, only costs the headers.
+// responses without an ETag or Last-Modified header aren't saved, since there'd be no way to check if they're still good.
+template <typename get_posts>
+struct cached_get
+{
+	cached_get(get_posts& get, fs::path cache_dir) : get(get), cache_dir(std::move(cache_dir)) { }
+
+	net_response operator()(std::string_view url, std::string_view access_token, const timeline_params& params, unsigned int limit)
+	{
+		const auto key = response_cache_key(url, params, limit);
+		const auto file = response_cache_file(cache_dir, key);
+		auto cached = read_cached_response(file, key);
+
+		timeline_params conditional = params;
+		if (cached.has_value())
+		{
+			conditional.if_none_match = cached->etag;
+			conditional.if_modified_since = cached->last_modified;
+		}
+
+		net_response response = get(url, access_token, conditional, limit);
+
+		if (response.status_code == 304 && cached.has_value())
+		{
+			response.status_code = 200;
+			response.okay = true;
+			response.message = std::move(cached->body);
+			touch_cached_response(file);
+			return response;
+		}
+
+		if (response.okay && response.status_code != 304 && (!response.etag.empty() || !response.last_modified.empty()))
+			write_cached_response(file, key, cached_response{ response.etag, response.last_modified, response.message });
+
+		return response;
+	}
+
+	// for when a saved body turns out to be no good, so the next request downloads a fresh copy instead of getting a 304.
+	void forget(std::string_view url, const timeline_params& params, unsigned int limit)
+	{
+		forget_cached_response(response_cache_file(cache_dir, response_cache_key(url, params, limit)));
+	}
+
+private:
+	get_posts& get;
+	const fs::path cache_dir;
+};
+
+#endif
@@ -5,9 +5,15 @@
 
 #include <string>
 #include <string_view>
+#include <sstream>
 #include <algorithm>
 #include <utility>
 #include <deque>
+#include <vector>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <atomic>
 
 #include "../netinterface/net_interface.hpp"
 #include "../queue/queues.hpp"
@@ -18,6 +24,8 @@
 #include "sync_helpers.hpp"
 #include "send_helpers.hpp"
 #include "deferred_url_builder.hpp"
+#include "byte_budget.hpp"
+#include "media_cache.hpp"
 
 template <typename post_request, typename delete_request, typename post_new_status, typename upload_attachments, typename get_posts>
 struct send_posts
@@ -25,13 +33,42 @@ struct send_posts
 public:
 	unsigned int retries = 3;
 
+	// how many requests to have in flight at once. One means send everything in order, one at a time.
+	// a post's attachments get uploaded up to this many at a time, too.
+	unsigned int concurrency = 1;
+
+	// if this is set, how much each kind of queued call sent and received gets added to it.
+	sync_stats* stats = nullptr;
+
+	// if this is set, every queued call has to fit in it. The ones that don't stay in the queue for next time.
+	byte_budget* budget = nullptr;
+
+	// send every queued call just the way it was queued, even the ones a later call undoes or repeats,
+	// for when a boost, an unboost, and a reboost are supposed to bump a post back up people's timelines.
+	bool literal_queue = false;
+
 	send_posts(post_request& post, delete_request& del, post_new_status& new_status, upload_attachments& upload, get_posts& get_method) : post(post), del(del), new_status(new_status), upload(upload), get_method(get_method) { }
 
 	void send(const fs::path& user_account_dir, const std::string_view instance_url, const std::string_view access_token)
 	{
 		retries = set_default(retries, 3, "Number of retries cannot be zero or less. Resetting to 3.\n", pl());
 
-		process_queue(user_account_dir, instance_url, access_token);
+		route_totals by_route{};
+		process_queue(user_account_dir, instance_url, access_token, by_route);
+
+		const auto pruned = prune_response_cache(user_account_dir / Response_Cache_Directory, Response_Cache_Lifetime);
+		if (pruned != 0)
+			plverb() << "Removed " << pruned << pluralize(pruned, " saved response", " saved responses") << " that hadn't been used in a while.\n";
+
+		if (stats == nullptr)
+			return;
+
+		const std::string account_name = to_utf8(user_account_dir.filename());
+		for (size_t route = 0; route < by_route.size(); route++)
+		{
+			if (by_route[route].posts != 0)
+				stats->add_send(account_name, print_route(static_cast<api_route>(route)), by_route[route]);
+		}
 	}
 
 
@@ -42,8 +79,28 @@ private:
 	upload_attachments& upload;
 	get_posts& get_method;
 
-	bool make_api_call(const api_call& to_make, deferred_url_builder& urls, const fs::path& user_account_dir, std::string_view access_token)
+	using route_totals = std::array<transfer_totals, static_cast<size_t>(api_route::unknown)>;
+
+	static void add_call(route_totals& by_route, const api_call& call, const transfer_totals& transferred)
+	{
+		const auto route = static_cast<size_t>(call.queued_call);
+		if (route >= by_route.size())
+			return;
+
+		by_route[route] += transferred;
+		by_route[route].posts++;
+	}
+
+	// call_error::none if it worked.
+	call_error make_api_call(const api_call& to_make, deferred_url_builder& urls, const fs::path& user_account_dir, std::string_view access_token, transfer_totals& transferred)
 	{
+		const auto simple = [&](auto& method, const char* method_name, rate_limit_group group)
+		{
+			const auto response = simple_call(method, method_name, retries, paramaterize_url(urls.status_url(), to_make.argument, ROUTE_LOOKUP[static_cast<uint8_t>(to_make.queued_call)]), access_token, group);
+			transferred += response.transferred;
+			return response.success ? call_error::none : classify_failure(response.status_code);
+		};
+
 		switch (to_make.queued_call)
 		{
 		case api_route::fav:
@@ -52,90 +109,353 @@ private:
 		case api_route::unboost:
 		case api_route::bookmark:
 		case api_route::unbookmark:
-			return simple_call(post, "POST", retries, paramaterize_url(urls.status_url(), to_make.argument, ROUTE_LOOKUP[static_cast<uint8_t>(to_make.queued_call)]), access_token).success;
+			return simple(post, "POST", rate_limit_group::general);
 		case api_route::post:
 			// posts are a little trickier
-			return send_post(user_account_dir, access_token, urls.status_url(), urls.media_url(), to_make.argument);
+			return send_post(user_account_dir, access_token, urls.status_url(), urls.media_url(), to_make.argument, transferred);
 		case api_route::unpost:
-			return simple_call(del, "DELETE", retries, paramaterize_url(urls.status_url(), to_make.argument, ROUTE_LOOKUP[static_cast<uint8_t>(to_make.queued_call)]), access_token).success;
+			return simple(del, "DELETE", rate_limit_group::status_delete);
 		case api_route::context:
-			return get_and_write(get_method, user_account_dir, retries, urls.status_url(), to_make.argument, access_token);
+			return get_and_write(get_method, user_account_dir, retries, urls.status_url(), to_make.argument, access_token, transferred);
 		default:
-			return false;
+			return call_error::other;
 		}
 	}
 
-	void process_queue(const fs::path& user_account_dir, const std::string_view instance_url, const std::string_view access_token)
+	void process_queue(const fs::path& user_account_dir, const std::string_view instance_url, const std::string_view access_token, route_totals& by_route)
 	{
 		auto queuelist = get(user_account_dir);
 
-		std::deque<api_call> failed;
+		if (!literal_queue)
+		{
+			const auto dropped = collapse_queue(queuelist.parsed);
+			if (dropped != 0)
+				pl() << "Saved " << dropped << pluralize(dropped, " request", " requests") << " by skipping queued calls that a later call undoes or repeats.\n";
+		}
 
 		deferred_url_builder urls(instance_url);
 
+		if (concurrency > 1)
+		{
+			queuelist.parsed = process_concurrently(std::move(queuelist.parsed), urls, user_account_dir, access_token, by_route);
+			return;
+		}
+
+		const long long now = seconds_since_epoch();
+		backoff_hold hold{ now, user_account_dir / File_Queue_Directory };
+		size_t waiting = 0;
+
+		std::deque<api_call> failed;
+		std::vector<api_call> rejected;
+
 		while (!queuelist.parsed.empty())
 		{
-			if (!make_api_call(queuelist.parsed.front(), urls, user_account_dir, access_token))
-				failed.push_back(std::move(queuelist.parsed.front()));
+			// everything that hasn't been sent yet stays queued, in the same order, for next time
+			if (stop_requested)
+			{
+				print_stopped(queuelist.parsed.size());
+				break;
+			}
+
+			auto& call = queuelist.parsed.front();
+			if (hold.should_wait(call))
+			{
+				waiting++;
+				failed.push_back(std::move(call));
+				queuelist.parsed.pop_front();
+				continue;
+			}
+
+			const auto reservation = reserve_from(budget);
+			if (!reservation.has_value())
+			{
+				print_out_of_budget(queuelist.parsed.size());
+				break;
+			}
+
+			transfer_totals transferred;
+			const auto error = make_api_call(call, urls, user_account_dir, access_token, transferred);
+			settle_with(budget, *reservation, transferred);
+			add_call(by_route, call, transferred);
+			if (error == call_error::unauthorized)
+			{
+				// this one stays right where it is, along with everything after it
+				print_unauthorized(queuelist.parsed.size());
+				break;
+			}
+
+			if (error != call_error::none)
+			{
+				record_failure(call, error, now);
+				if (error == call_error::rejected)
+				{
+					rejected.push_back(std::move(call));
+				}
+				else
+				{
+					hold.hold_replies_to(call);
+					failed.push_back(std::move(call));
+				}
+			}
 			queuelist.parsed.pop_front();
 		}
 
+		// anything that didn't get a chance goes after the failures, so everything stays in the same order
+		std::move(queuelist.parsed.begin(), queuelist.parsed.end(), std::back_inserter(failed));
 		queuelist.parsed = std::move(failed);
+
+		finish_failures(user_account_dir, waiting, std::move(rejected));
 	}
 
-	bool send_attachments(file_status_params& params, const std::string& mediaurl, std::string_view access_token)
+	// the calls the server turned down for good go in their own file, and don't get tried again.
+	void finish_failures(const fs::path& user_account_dir, size_t waiting, std::vector<api_call> rejected)
+	{
+		if (waiting != 0)
+			pl() << "Skipped " << waiting << pluralize(waiting, " call that failed recently and is", " calls that failed recently and are") << " waiting to be tried again.\n";
+
+		if (rejected.empty())
+			return;
+
+		const auto count = rejected.size();
+		move_to_failed(user_account_dir, std::move(rejected));
+		pl() << "Moved " << count << pluralize(count, " call", " calls") << " the server won't accept to " << Failed_Queue_Filename << ". They won't be sent again. See them with msync queue print.\n";
+	}
+
+	std::deque<api_call> process_concurrently(std::deque<api_call>&& queue, deferred_url_builder& urls, const fs::path& user_account_dir, const std::string_view access_token, route_totals& by_route)
+	{
+		// the url builder fills these in lazily, which isn't safe to do from several threads at once, so do it now.
+		urls.status_url();
+		urls.media_url();
+
+		const auto chains = make_chains(queue);
+		const long long now = seconds_since_epoch();
+
+		// not vector<bool>s, because different threads will be writing to neighboring elements at the same time
+		std::vector<call_error> errors(queue.size(), call_error::none);
+		std::vector<transfer_totals> transferred(queue.size());
+		std::vector<char> attempted(queue.size(), false);
+		std::vector<char> waiting(queue.size(), false);
+		std::atomic<bool> unauthorized{ false };
+
+		parallel_for(chains.size(), concurrency, [&](const size_t chain_idx)
+		{
+			// print each chain's output all in one go when it's done, so the log still makes sense
+			const log_group group;
+			backoff_hold hold{ now, user_account_dir / File_Queue_Directory };
+			for (const size_t call_idx : chains[chain_idx])
+			{
+				if (hold.should_wait(queue[call_idx]))
+				{
+					waiting[call_idx] = true;
+					continue;
+				}
+
+				// the server isn't going to take anything else from this account, so don't bother asking
+				if (unauthorized || stop_requested)
+					break;
+
+				// the rest of this chain depends on this call, so it all has to wait
+				const auto reservation = reserve_from(budget);
+				if (!reservation.has_value())
+					break;
+
+				attempted[call_idx] = true;
+				errors[call_idx] = make_api_call(queue[call_idx], urls, user_account_dir, access_token, transferred[call_idx]);
+				settle_with(budget, *reservation, transferred[call_idx]);
+
+				if (errors[call_idx] == call_error::unauthorized)
+				{
+					unauthorized = true;
+					break;
+				}
+
+				if (errors[call_idx] != call_error::none && errors[call_idx] != call_error::rejected)
+					hold.hold_replies_to(queue[call_idx]);
+			}
+		});
+
+		// put the failures back in the same order they were in before
+		const auto waiting_count = static_cast<size_t>(std::count(waiting.begin(), waiting.end(), true));
+		const auto unauthorized_count = static_cast<size_t>(std::count(errors.begin(), errors.end(), call_error::unauthorized));
+		const auto skipped = static_cast<size_t>(std::count(attempted.begin(), attempted.end(), false)) - waiting_count;
+		if (unauthorized)
+			print_unauthorized(skipped + unauthorized_count);
+		else if (skipped != 0 && stop_requested)
+			print_stopped(skipped);
+		else if (skipped != 0)
+			print_out_of_budget(skipped);
+
+		std::deque<api_call> failed;
+		std::vector<api_call> rejected;
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			if (!attempted[i])
+			{
+				failed.push_back(std::move(queue[i]));
+				continue;
+			}
+
+			add_call(by_route, queue[i], transferred[i]);
+			if (errors[i] == call_error::none)
+				continue;
+
+			// it's the account that has a problem, not the call, so it goes back the way it was
+			if (errors[i] == call_error::unauthorized)
+			{
+				failed.push_back(std::move(queue[i]));
+				continue;
+			}
+
+			record_failure(queue[i], errors[i], now);
+			if (errors[i] == call_error::rejected)
+				rejected.push_back(std::move(queue[i]));
+			else
+				failed.push_back(std::move(queue[i]));
+		}
+
+		finish_failures(user_account_dir, waiting_count, std::move(rejected));
+		return failed;
+	}
+
+	void print_out_of_budget(size_t left)
+	{
+		pl() << "Stopping here to stay under the data limit. " << left << pluralize(left, " call is", " calls are") << " still queued.\n";
+	}
+
+	void print_stopped(size_t left)
+	{
+		pl() << "Stopping early. " << left << pluralize(left, " call is", " calls are") << " still queued.\n";
+	}
+
+	void print_unauthorized(size_t left)
+	{
+		pl() << "The server won't accept anything from this account. Its access token might have been revoked, or the account might be suspended. "
+			<< left << pluralize(left, " call is", " calls are") << " still queued, and will be sent the next time the account is working.\n";
+	}
+
+	// uploads that already went through on an earlier try are reused instead of being sent again.
+	// the rest are uploaded at the same time, up to the concurrency limit, since that makes much better use of a slow connection than going one by one.
+	// the keys of everything attached end up in media_keys, so they can be forgotten once the post is made.
+	call_error send_attachments(file_status_params& params, const fs::path& user_account_dir, const std::string& mediaurl, std::string_view access_token, transfer_totals& transferred, std::vector<std::string>& media_keys)
 	{
-		bool succeeded;
-		std::string response;
 		for (const auto& attachment : params.attachments)
 		{
 			if (!fs::exists(attachment.file))
 			{
 				pl() << "Could not find file: " << attachment.file << " skipping this post.\n";
-				return false;
+				return call_error::other;
 			}
+		}
 
-			pl() << "Uploading " << attachment.file << ' ';
+		// the IDs have to go out in the same order as the attachments, so each one has a spot saved for it
+		const size_t count = params.attachments.size();
+		std::vector<std::string> keys(count);
+		std::vector<std::string> ids(count);
+		std::vector<size_t> to_upload;
 
-			auto request_response = request_with_retries([&]() { return upload(mediaurl, access_token, attachment.file, attachment.description); }, retries, pl());
-			response = std::move(request_response.message);
-			succeeded = request_response.success;
+		const long long now = seconds_since_epoch();
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& attachment = params.attachments[i];
+			keys[i] = media_cache_key(attachment.file, attachment.description);
+			const auto uploaded = find_upload(user_account_dir, keys[i], now);
 
-			print_statistics(pl(), request_response.time_ms, request_response.tries);
-			if (succeeded)
+			// the same file with the same description twice in one post still needs two uploads
+			if (uploaded.has_value() && std::find(ids.begin(), ids.end(), *uploaded) == ids.end())
 			{
-				params.attachment_ids.push_back(read_upload_id(response));
+				pl() << "Reusing upload of " << attachment.file << '\n';
+				ids[i] = *uploaded;
 			}
 			else
 			{
-				pl() << "Could not upload file. Skipping this post.";
-				return false;
+				to_upload.push_back(i);
 			}
 		}
 
-		return true;
+		// the ones that don't get started because another one already failed stay empty
+		std::vector<std::optional<request_response>> responses(to_upload.size());
+		std::atomic<bool> upload_failed{ false };
+
+		// the uploads run on their own threads, outside of this call's log group, so each one writes down what it did
+		// and that gets printed here, in order, once they're all done.
+		std::vector<std::string> logs(to_upload.size());
+
+		parallel_for(to_upload.size(), concurrency, [&](const size_t upload_idx)
+		{
+			// no sense spending the bandwidth on a post that's going to be skipped anyway
+			if (upload_failed)
+				return;
+
+			std::ostringstream log;
+			const auto& attachment = params.attachments[to_upload[upload_idx]];
+			log << "Uploading " << attachment.file << ' ';
+
+			auto& response = responses[upload_idx];
+			response = request_with_retries([&]() { return upload(mediaurl, access_token, attachment.file, attachment.description); }, retries, log, &pacer_for(mediaurl, access_token, rate_limit_group::media));
+			print_statistics(log, response->time_ms, response->tries);
+			logs[upload_idx] = log.str();
+
+			if (!response->success)
+				upload_failed = true;
+		});
+
+		for (const auto& log : logs)
+			pl() << log;
+
+		// even if the post gets skipped, the uploads that worked get remembered so the next try doesn't have to send them again
+		call_error error = call_error::none;
+		for (size_t upload_idx = 0; upload_idx < to_upload.size(); upload_idx++)
+		{
+			auto& response = responses[upload_idx];
+			if (!response.has_value())
+				continue;
+
+			transferred += response->transferred;
+
+			const size_t i = to_upload[upload_idx];
+			if (response->success)
+			{
+				ids[i] = read_upload_id(response->message);
+				remember_upload(user_account_dir, keys[i], ids[i], seconds_since_epoch());
+			}
+			else if (error == call_error::none)
+			{
+				error = classify_failure(response->status_code);
+			}
+		}
+
+		if (error != call_error::none)
+		{
+			pl() << "Could not upload file. Skipping this post.";
+			return error;
+		}
+
+		params.attachment_ids = std::move(ids);
+		media_keys = std::move(keys);
+		return call_error::none;
 	}
 
-	bool send_post(const fs::path& user_account_dir, const std::string_view access_token, const std::string& statusurl, const std::string& mediaurl, const std::string& post_filename)
+	call_error send_post(const fs::path& user_account_dir, const std::string_view access_token, const std::string& statusurl, const std::string& mediaurl, const std::string& post_filename, transfer_totals& transferred)
 	{
 		const fs::path file_to_send = user_account_dir / File_Queue_Directory / post_filename;
 
 		file_status_params params = read_params(file_to_send);
 
-		bool succeeded = true;
+		call_error error = call_error::none;
 		if (!params.okay)
 		{
 			pl() << post_filename << ": This post is a reply to a post that failed to send. Skipping.\n";
-			succeeded = false;
+			error = params.parent_rejected ? call_error::rejected : call_error::other;
 		}
 
-		if (succeeded)
+		std::vector<std::string> media_keys;
+		if (error == call_error::none)
 		{
-			succeeded = send_attachments(params, mediaurl, access_token);
+			error = send_attachments(params, user_account_dir, mediaurl, access_token, transferred, media_keys);
 		}
 
 		std::string parsed_status_id;
-		if (succeeded)
+		if (error == call_error::none)
 		{
 			pl() << "Sending post: ";
 			if (!params.content_warning.empty())
@@ -143,29 +463,38 @@ private:
 			print_truncated_string(params.body, pl());
 			pl() << '\n';
 
-			auto request_response = request_with_retries([&]() { return new_status(statusurl, access_token, params); }, retries, pl());
+			auto request_response = request_with_retries([&]() { return new_status(statusurl, access_token, params); }, retries, pl(), &pacer_for(statusurl, access_token));
 
 			std::string response = std::move(request_response.message);
-			succeeded = request_response.success;
+			transferred += request_response.transferred;
 
-			if (succeeded)
+			if (request_response.success)
 			{
 				fs::remove(file_to_send);
 				auto parsed_status = read_status(response);
 				pl() << "Created post at " << parsed_status.url;
 				parsed_status_id = std::move(parsed_status.id);
 			}
+			else
+			{
+				error = classify_failure(request_response.status_code);
+			}
 			print_statistics(pl(), request_response.time_ms, request_response.tries);
+
+			// a post that went through has its media now, and one the server won't take might have been turned down because of it.
+			// either way, the next try should start fresh. Anything else, like a timeout, can use the same uploads again.
+			if (!media_keys.empty() && (error == call_error::none || error == call_error::rejected))
+				forget_uploads(user_account_dir, media_keys, seconds_since_epoch());
 		}
 
 		if (!params.reply_id.empty())
 		{
 			// store the parsed status ID regardless- the empty string if this failed
 			// or a real ID if it succeeded.
-			store_thread_id(std::move(params.reply_id), std::move(parsed_status_id));
+			store_thread_id(std::move(params.reply_id), std::move(parsed_status_id), error == call_error::rejected);
 		}
 
-		if (!succeeded && !params.reply_to.empty())
+		if (error != call_error::none && !params.reply_to.empty())
 		{
 			// if this one is a reply to another post in this queue
 			// and that one succeeded but this one failed, then
@@ -183,7 +512,7 @@ private:
 			}
 		}
 
-		return succeeded;
+		return error;
 	}
 };
 
@@ -3,6 +3,10 @@
 #include <random>
 #include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <limits>
+#include <mutex>
+#include <chrono>
 
 #include "../postfile/outgoing_post.hpp"
 #include "../postlist/post_list.hpp"
@@ -33,7 +37,10 @@ std::mt19937_64 make_random_engine()
 
 uint_fast64_t random_number()
 {
+	// several accounts can be sending posts at the same time
+	static std::mutex twister_lock;
 	static auto twister = make_random_engine();
+	const std::lock_guard<std::mutex> lock{ twister_lock };
 	return twister();
 }
 
@@ -52,18 +59,25 @@ std::vector<attachment> make_attachments(std::vector<std::string>&& attachments,
 }
 
 static std::unordered_map<std::string, std::string> threaded_ids;
+static std::unordered_set<std::string> rejected_thread_ids;
+static std::mutex threaded_ids_lock;
 
 // the idea here is that posts can optionally have some local ID. 
 // if another post's reply_to_id is set to one of those, then fix it up so that 
 // that post is a reply to the first one.
 
-void store_thread_id(std::string msync_id, std::string remote_server_id)
+void store_thread_id(std::string msync_id, std::string remote_server_id, bool rejected)
 {
 	// if another post uses the same key ID, replace it
 	// this is mostly to make the tests work, though it is also closer to what you might expect
 
 	// I considered scoping the threaded_ids to the process_posts functions, but it's probably good to
 	// let people thread across accounts, even though we currently can't really guarantee an order, so hm
+	const std::lock_guard<std::mutex> lock{ threaded_ids_lock };
+	if (rejected)
+		rejected_thread_ids.insert(msync_id);
+	else
+		rejected_thread_ids.erase(msync_id);
 	threaded_ids.insert_or_assign(std::move(msync_id), std::move(remote_server_id));
 }
 
@@ -81,11 +95,13 @@ file_status_params read_params(const fs::path& path)
 
 	if (!toreturn.reply_to.empty())
 	{
+		const std::lock_guard<std::mutex> lock{ threaded_ids_lock };
 		const auto val = threaded_ids.find(toreturn.reply_to);
 		if (val != threaded_ids.end()) 
 		{
+			toreturn.okay = !val->second.empty();
+			toreturn.parent_rejected = !toreturn.okay && rejected_thread_ids.count(toreturn.reply_to) != 0;
 			toreturn.reply_to = val->second;
-			toreturn.okay = !toreturn.reply_to.empty();
 		}
 	}
 
@@ -119,3 +135,148 @@ void write_posts(const mastodon_context& context, const mastodon_status& status,
 	writer.write(status);
 	std::for_each(context.descendants.begin(), context.descendants.end(), write);
 }
+
+// a call and its undo both set the same thing, so they count as the same kind of call.
+api_route toggle_kind(api_route route)
+{
+	switch (route)
+	{
+	case api_route::unfav:
+		return api_route::fav;
+	case api_route::unboost:
+		return api_route::boost;
+	case api_route::unbookmark:
+		return api_route::bookmark;
+	default:
+		return route;
+	}
+}
+
+size_t collapse_queue(std::deque<api_call>& queue)
+{
+	// going backwards, the first call of each kind on each post is the one that decides how it ends up
+	std::unordered_set<api_call, api_call_hash> seen;
+	std::vector<char> keep(queue.size(), true);
+	for (size_t i = queue.size(); i > 0; i--)
+	{
+		const auto& call = queue[i - 1];
+		if (call.queued_call == api_route::post || call.queued_call == api_route::unpost || call.queued_call == api_route::unknown)
+			continue;
+
+		keep[i - 1] = seen.insert(api_call{ toggle_kind(call.queued_call), call.argument }).second;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		if (!keep[i])
+			continue;
+
+		if (kept != i)
+			queue[kept] = std::move(queue[i]);
+		kept++;
+	}
+
+	const size_t dropped = queue.size() - kept;
+	queue.resize(kept);
+	return dropped;
+}
+
+call_error classify_failure(int status_code)
+{
+	// 408 is the server saying it got tired of waiting for the request, which is really a network problem
+	if (status_code == 0 || status_code == 408)
+		return call_error::network;
+	if (status_code == 429)
+		return call_error::rate_limited;
+	// these are about the account, not the call, so every other call would get the same answer
+	if (status_code == 401 || status_code == 403)
+		return call_error::unauthorized;
+	if (status_code >= 400 && status_code < 500)
+		return call_error::rejected;
+	if (status_code >= 500)
+		return call_error::server;
+	return call_error::other;
+}
+
+void record_failure(api_call& call, call_error error, long long now)
+{
+	constexpr long long first_wait = 5 * 60;
+	constexpr long long longest_wait = 24 * 60 * 60;
+
+	call.attempts++;
+	call.last_error = error;
+
+	// 5 minutes doubled 9 times is already past a day, and shifting by too much is undefined
+	const unsigned int doublings = std::min(call.attempts - 1, 9U);
+	call.not_before = now + std::min(first_wait << doublings, longest_wait);
+}
+
+long long seconds_since_epoch()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool backoff_hold::should_wait(const api_call& call)
+{
+	if (call.queued_call == api_route::post)
+	{
+		const readonly_outgoing_post post{ queue_dir / call.argument };
+		if (call.not_before <= now && (post.parsed.reply_to_id.empty() || pending_posts.count(post.parsed.reply_to_id) == 0))
+			return false;
+
+		// and anything replying to this one waits, too
+		if (!post.parsed.reply_id.empty())
+			pending_posts.insert(post.parsed.reply_id);
+		return true;
+	}
+
+	if (call.not_before > now)
+	{
+		held.insert(call.argument);
+		return true;
+	}
+
+	return held.count(call.argument) != 0;
+}
+
+void backoff_hold::hold_replies_to(const api_call& call)
+{
+	if (call.queued_call != api_route::post)
+		return;
+
+	readonly_outgoing_post post{ queue_dir / call.argument };
+	if (!post.parsed.reply_id.empty())
+		pending_posts.insert(std::move(post.parsed.reply_id));
+}
+
+std::vector<std::vector<size_t>> make_chains(const std::deque<api_call>& queue)
+{
+	std::vector<std::vector<size_t>> chains;
+
+	// posts can be replies to other posts in the queue, and the remote ID of a post only gets
+	// filled in for its replies once it's sent, so all the posts stay in one chain, in order.
+	// everything else only cares about the order of other calls on the same post,
+	// so that, for example, a boost and then an unboost of the same post still happen in that order.
+	constexpr size_t no_chain = std::numeric_limits<size_t>::max();
+	size_t post_chain = no_chain;
+	std::unordered_map<std::string_view, size_t> chain_for_id;
+
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		const auto& call = queue[i];
+
+		size_t& chain = call.queued_call == api_route::post ? post_chain :
+			chain_for_id.try_emplace(call.argument, no_chain).first->second;
+
+		if (chain == no_chain)
+		{
+			chain = chains.size();
+			chains.emplace_back();
+		}
+
+		chains[chain].push_back(i);
+	}
+
+	return chains;
+}
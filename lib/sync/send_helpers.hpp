@@ -6,18 +6,23 @@
 #include <filesystem.hpp>
 
 #include "../util/util.hpp"
+#include "../trace/trace.hpp"
 
 #include "../constants/constants.hpp"
 
 #include <array>
+#include <deque>
+#include <vector>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <string>
 
 #include "read_response.hpp"
 
 #include "sync_helpers.hpp"
+#include "response_cache.hpp"
 
 #include "../netinterface/net_interface.hpp"
 
@@ -35,10 +40,10 @@ constexpr std::array<std::string_view, static_cast<uint8_t>(api_route::unknown)>
 
 
 template <typename make_request>
-request_response simple_call(make_request& method, const char* method_name, unsigned int retries, const std::string& url, std::string_view access_token)
+request_response simple_call(make_request& method, const char* method_name, unsigned int retries, const std::string& url, std::string_view access_token, rate_limit_group group = rate_limit_group::general)
 {
 	pl() << method_name << ' ' << url;
-	const auto response = request_with_retries([&]() { return method(url, access_token); }, retries, pl());
+	const auto response = request_with_retries([&]() { return method(url, access_token); }, retries, pl(), &pacer_for(url, access_token, group));
 	if (response.success)
 		pl() << " OK";
 	print_statistics(pl(), response.time_ms, response.tries);
@@ -47,7 +52,51 @@ request_response simple_call(make_request& method, const char* method_name, unsi
 
 std::string paramaterize_url(std::string_view before, std::string_view middle, std::string_view after);
 
-void store_thread_id(std::string msync_id, std::string remote_server_id);
+// remote_server_id is empty if the post didn't go through. If the server turned it down for good, replies to it get turned down with it.
+void store_thread_id(std::string msync_id, std::string remote_server_id, bool rejected = false);
+
+// splits the queue into chains of calls (indices into the queue) that have to be made in order.
+// calls in different chains don't depend on each other, so different chains can be sent at the same time.
+std::vector<std::vector<size_t>> make_chains(const std::deque<api_call>& queue);
+
+// takes out calls that a later call in the queue makes pointless, without changing the order of the rest.
+// a post can only be faved or not, so a fav, an unfav, and a fav of the same post only need the last fav,
+// and fetching the same thread twice only needs the last fetch. Posts and deletes are always kept.
+// returns how many calls were taken out.
+size_t collapse_queue(std::deque<api_call>& queue);
+
+// what kind of failure a status code means. 0 means there wasn't a response at all.
+call_error classify_failure(int status_code);
+
+// counts a failure, and puts off trying the call again: five minutes after the first failure,
+// twice as long after each one after that, up to a day. now is in seconds since the epoch.
+void record_failure(api_call& call, call_error error, long long now);
+
+long long seconds_since_epoch();
+
+// decides which calls are still waiting to be tried again.
+// calls on the same post have to happen in order, so once one of them is waiting, the rest of them wait with it.
+// posts mostly wait by themselves, except for replies to posts that haven't been sent yet.
+// those would go out with msync's local ID for the post they're replying to, which the server doesn't know about, so they wait for it.
+// queue_dir is where the queued posts are, since the IDs they reply to are in the files.
+class backoff_hold
+{
+public:
+	backoff_hold(long long now, fs::path queue_dir) : now(now), queue_dir(std::move(queue_dir)) { }
+
+	bool should_wait(const api_call& call);
+
+	// for a post that failed in a way that's worth trying again, so that replies to it wait too.
+	void hold_replies_to(const api_call& call);
+
+private:
+	long long now;
+	fs::path queue_dir;
+	std::unordered_set<std::string> held;
+
+	// the local IDs of posts that are waiting or failed, so replies to them can wait with them.
+	std::unordered_set<std::string> pending_posts;
+};
 
 struct attachment
 {
@@ -60,6 +109,9 @@ struct file_status_params : public status_params
 	std::vector<attachment> attachments;
 	std::string reply_id;
 	bool okay = true;
+
+	// if this is a reply to a post the server won't take, this won't ever go through either.
+	bool parent_rejected = false;
 };
 
 file_status_params read_params(const fs::path& path);
@@ -67,13 +119,16 @@ file_status_params read_params(const fs::path& path);
 void write_posts(const mastodon_context& context, const mastodon_status& status, const fs::path& path);
 
 template <typename make_request>
-bool get_and_write(make_request& method, const fs::path& user_account_dir, unsigned int retries, const std::string& status_url, const std::string& post_id, std::string_view access_token)
+call_error get_and_write(make_request& method, const fs::path& user_account_dir, unsigned int retries, const std::string& status_url, const std::string& post_id, std::string_view access_token, transfer_totals& transferred)
 {
-	auto adapted_get = [&method](const auto& request_url, const auto& access_token) { return method(request_url, access_token, timeline_params{}, 0); };
+	// threads get refetched over and over, but usually haven't changed, so ask the server if they have first.
+	cached_get<make_request> cached_method{ method, user_account_dir / Response_Cache_Directory };
+	auto adapted_get = [&cached_method](const auto& request_url, const auto& access_token) { return cached_method(request_url, access_token, timeline_params{}, 0); };
 	// GET https://instance.url/api/v1/statuses/post_id
 	auto request_url = status_url + post_id;
 	const auto status_response = simple_call(adapted_get, "GET", retries, request_url, access_token);
-	if (!status_response.success) { return false; }
+	transferred += status_response.transferred;
+	if (!status_response.success) { return classify_failure(status_response.status_code); }
 
 	// this might have to become more general, like what's done in recv.hpp, but it's fine for now.
 	// basically, we get the message they want context for, then we get the context around it
@@ -82,16 +137,29 @@ bool get_and_write(make_request& method, const fs::path& user_account_dir, unsig
 	// GET https://instance.url/api/v1/statuses/post_id/context
 	request_url += "/context";
 	const auto context_response = simple_call(adapted_get, "GET", retries, request_url, access_token);
-	if (!context_response.success) { return false; }
+	transferred += context_response.transferred;
+	if (!context_response.success) { return classify_failure(context_response.status_code); }
 
 	// build up the target file location to minimize the number of intermediate strings that get thrown away
 	auto post_file = user_account_dir / Thread_Directory;
 	post_file /= post_id;
 	post_file += ".list";
 
-	write_posts(read_context(context_response.message), read_status(status_response.message), post_file);
-
-	return true;
+	trace_scope parse_and_write{ "parse and write thread", "cpu", "clean_us" };
+	parse_and_write.args.add("bytes", status_response.message.size() + context_response.message.size());
+	try
+	{
+		write_posts(read_context(context_response.message), read_status(status_response.message), post_file);
+	}
+	catch (...)
+	{
+		// if a saved body is what's broken, the server would keep saying it hasn't changed, and this would fail the same way every sync.
+		cached_method.forget(status_url + post_id, timeline_params{}, 0);
+		cached_method.forget(request_url, timeline_params{}, 0);
+		throw;
+	}
+
+	return call_error::none;
 }
 
 #endif
@@ -0,0 +1,93 @@
+#include "show.hpp"
+
+#include "../postlist/post_list.hpp"
+#include "../postlist/reverse_post_reader.hpp"
+#include "../poststore/post_store.hpp"
+#include "../constants/constants.hpp"
+
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// no count means every post.
+template <typename post_type>
+void show_store(fs::path store_directory, std::optional<size_t> count, std::ostream& out)
+{
+	post_store_view<post_type> store{ std::move(store_directory) };
+	if (!count.has_value())
+	{
+		store.render(out);
+		return;
+	}
+
+	const auto posts = store.newest(*count);
+
+	// these come back newest first, but they go out oldest first
+	for (auto post = posts.rbegin(); post != posts.rend(); ++post)
+		out << *post << post_separator;
+}
+
+template <typename post_type>
+void show_timeline(const user_options& account, const fs::path& filename, std::optional<size_t> count, std::ostream& out)
+{
+	if (account.get_bool_option(user_option::post_store))
+	{
+		fs::path store_directory = account.get_user_directory() / filename;
+		store_directory.replace_extension(Post_Store_Extension);
+		show_store<post_type>(std::move(store_directory), count, out);
+		return;
+	}
+
+	const fs::path list_file = account.get_user_directory() / filename;
+	if (!count.has_value())
+	{
+		// the whole file is already exactly what should be printed
+		std::ifstream list{ list_file.c_str(), std::ios::binary };
+		if (list.peek() != std::ifstream::traits_type::eof())
+			out << list.rdbuf();
+		return;
+	}
+
+	// the text is already formatted, so there's no need to parse anything
+	reverse_post_reader reader{ list_file };
+	std::vector<std::string> posts;
+	while (posts.size() < *count)
+	{
+		auto post = reader.next();
+		if (!post.has_value())
+			break;
+		posts.push_back(std::move(*post));
+	}
+
+	for (auto post = posts.rbegin(); post != posts.rend(); ++post)
+		out << *post << post_separator;
+}
+
+void show_timeline(const user_options& account, to_get timeline, std::optional<size_t> count, std::ostream& out)
+{
+	switch (timeline)
+	{
+	case to_get::notifications:
+		show_timeline<mastodon_notification>(account, Notifications_Filename, count, out);
+		break;
+	case to_get::bookmarks:
+		show_timeline<mastodon_status>(account, Bookmarks_Filename, count, out);
+		break;
+	case to_get::home:
+	default:
+		show_timeline<mastodon_status>(account, Home_Timeline_Filename, count, out);
+		break;
+	}
+}
+
+void show_posts(const user_options& account, to_get timeline, size_t count, std::ostream& out)
+{
+	show_timeline(account, timeline, count, out);
+}
+
+void show_all_posts(const user_options& account, to_get timeline, std::ostream& out)
+{
+	show_timeline(account, timeline, std::nullopt, out);
+}
@@ -0,0 +1,21 @@
+#ifndef MSYNC_SHOW_HPP
+#define MSYNC_SHOW_HPP
+
+#include <cstddef>
+#include <ostream>
+
+#include "../options/user_options.hpp"
+
+#include "timelines.hpp"
+
+// writes the newest count posts from one of the account's timelines to out, the same way they look in the .list file.
+// the newest post is at the bottom, like tail would do it.
+// if the account saves posts to a post store, they come from there instead.
+// this only reads the end of the file, so it's quick even on a huge timeline.
+void show_posts(const user_options& account, to_get timeline, size_t count, std::ostream& out);
+
+// writes every post in one of the account's timelines to out, oldest first, exactly like the .list file.
+// for an account that saves posts to a post store, this is the way to get the .list view back.
+void show_all_posts(const user_options& account, to_get timeline, std::ostream& out);
+
+#endif
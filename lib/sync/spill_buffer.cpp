@@ -0,0 +1,75 @@
+#include "spill_buffer.hpp"
+
+#include "../exception/msync_exception.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <system_error>
+
+fs::path spill_file(const fs::path& spill_base, size_t number)
+{
+	fs::path file = spill_base;
+	file += ".spill";
+	file += std::to_string(number);
+	return file;
+}
+
+void append_spilled_record(std::string& spill, const std::string_view record)
+{
+	const auto length = static_cast<uint32_t>(record.size());
+	for (int shift = 0; shift < 32; shift += 8)
+		spill.push_back(static_cast<char>((length >> shift) & 0xff));
+	spill.append(record);
+}
+
+void remove_spills(const fs::path& spill_base, size_t count) noexcept
+{
+#if MSYNC_USE_BOOST
+	boost::system::error_code err;
+#else
+	std::error_code err;
+#endif
+	for (size_t i = 0; i < count; i++)
+		fs::remove(spill_file(spill_base, i), err);
+}
+
+void write_spill(const fs::path& file, const std::string& spill)
+{
+	std::ofstream out{ file.c_str(), std::ios::binary | std::ios::trunc };
+	out.write(spill.data(), spill.size());
+	if (!out)
+		throw msync_exception(std::string{ "Couldn't write downloaded posts to " }.append(file.string()).append(". Is the disk full?"));
+}
+
+std::string read_spill_file(const fs::path& file)
+{
+	std::ifstream in{ file.c_str(), std::ios::binary | std::ios::ate };
+	if (!in.is_open())
+		throw msync_exception(std::string{ "Couldn't read downloaded posts back from " }.append(file.string()));
+
+	std::string spill(static_cast<size_t>(in.tellg()), '\0');
+	in.seekg(0);
+	in.read(spill.data(), spill.size());
+	if (static_cast<size_t>(in.gcount()) != spill.size())
+		throw msync_exception(std::string{ "Couldn't read downloaded posts back from " }.append(file.string()));
+
+	return spill;
+}
+
+std::string_view next_spilled_record(std::string_view& spill)
+{
+	if (spill.size() < 4)
+		throw msync_exception("A temporary file of downloaded posts is cut off.");
+
+	uint32_t length = 0;
+	for (int i = 0; i < 4; i++)
+		length |= static_cast<uint32_t>(static_cast<unsigned char>(spill[i])) << (i * 8);
+	spill.remove_prefix(4);
+
+	if (spill.size() < length)
+		throw msync_exception("A temporary file of downloaded posts is cut off.");
+
+	const auto record = spill.substr(0, length);
+	spill.remove_prefix(length);
+	return record;
+}
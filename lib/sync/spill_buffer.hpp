@@ -0,0 +1,140 @@
+#ifndef MSYNC_SPILL_BUFFER_HPP
+#define MSYNC_SPILL_BUFFER_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <filesystem.hpp>
+
+#include "../poststore/post_record.hpp"
+#include "../trace/trace.hpp"
+
+// where spill number `number` for this timeline goes.
+fs::path spill_file(const fs::path& spill_base, size_t number);
+
+// adds one post's record to a spill, with its length in front so they can be split up again.
+void append_spilled_record(std::string& spill, std::string_view record);
+
+// deletes spills 0 through count - 1, ignoring any that are already gone.
+void remove_spills(const fs::path& spill_base, size_t count) noexcept;
+
+// writes a whole spill out at once. Throws an msync_exception if it can't.
+void write_spill(const fs::path& file, const std::string& spill);
+
+// reads a spill back in and hands each record to on_record, in the order they were added.
+template <typename on_record_callback>
+void read_spill(const fs::path& file, on_record_callback on_record);
+
+// the part of read_spill that doesn't depend on the callback.
+std::string read_spill_file(const fs::path& file);
+std::string_view next_spilled_record(std::string_view& spill);
+
+// newest_first gets pages newest first, but has to write them oldest first, so it can't write anything until it's done downloading.
+// this holds on to up to max_posts of them and, past that, spills them out to temporary files next to the timeline,
+// so that catching up after a month away doesn't take a ton of memory.
+// the spills are in the same binary format the post store uses, and they get deleted when the buffer goes away.
+template <typename post_type>
+class spill_buffer
+{
+public:
+	spill_buffer(fs::path spill_base, size_t max_posts) : base(std::move(spill_base)), max_posts(max_posts) { }
+
+	~spill_buffer() { remove_spills(base, spills); }
+
+	spill_buffer(const spill_buffer&) = delete;
+	spill_buffer& operator=(const spill_buffer&) = delete;
+
+	// page has to be newest first, and each page has to be older than the one before it.
+	// the posts are moved out of page, but page keeps its size.
+	void add(std::vector<post_type>& page)
+	{
+		if (page.empty())
+			return;
+
+		if (total == 0)
+			newest = page.front().id;
+
+		total += page.size();
+		buffered.insert(buffered.end(), std::make_move_iterator(page.begin()), std::make_move_iterator(page.end()));
+
+		if (buffered.size() >= max_posts)
+			spill();
+	}
+
+	size_t size() const noexcept { return total; }
+	size_t spilled() const noexcept { return spills; }
+
+	// the ID of the first post that was added, which is the newest one.
+	const std::string& newest_id() const noexcept { return newest; }
+
+	// hands every post to writer.write, oldest first, a batch at a time.
+	template <typename post_writer>
+	void write_oldest_first(post_writer& writer)
+	{
+		// the ones still in memory are the oldest, so they go first
+		write_backwards(writer);
+
+		post_type post;
+		for (size_t i = spills; i > 0; i--)
+		{
+			buffered.clear();
+			read_spill(spill_file(base, i - 1), [this, &post](std::string_view record)
+			{
+				read_record(record, post);
+				buffered.push_back(std::move(post));
+			});
+			write_backwards(writer);
+		}
+
+		buffered.clear();
+	}
+
+private:
+	void spill()
+	{
+		trace_scope spilling{ "spill posts", "cpu" };
+		spilling.args.add("posts", buffered.size());
+
+		std::string spill, record;
+		for (const auto& post : buffered)
+		{
+			record.clear();
+			append_record(record, post);
+			append_spilled_record(spill, record);
+		}
+
+		write_spill(spill_file(base, spills), spill);
+		spills++;
+
+		// the capacity is still there for the next batch, but everything the posts pointed to is gone
+		buffered.clear();
+	}
+
+	template <typename post_writer>
+	void write_backwards(post_writer& writer)
+	{
+		writer.write(buffered.rbegin(), buffered.rend());
+	}
+
+	const fs::path base;
+	const size_t max_posts;
+	std::vector<post_type> buffered;
+	std::string newest;
+	size_t total = 0;
+	size_t spills = 0;
+};
+
+template <typename on_record_callback>
+void read_spill(const fs::path& file, on_record_callback on_record)
+{
+	const std::string spill = read_spill_file(file);
+	std::string_view remaining = spill;
+	while (!remaining.empty())
+		on_record(next_spilled_record(remaining));
+}
+
+#endif
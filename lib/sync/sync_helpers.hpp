@@ -12,6 +12,8 @@
 #include "../util/util.hpp"
 
 #include "read_response.hpp"
+#include "rate_pacer.hpp"
+#include "transfer_stats.hpp"
 
 template <typename message_type, typename stream_output>
 unsigned int set_default(unsigned int value, unsigned int default_value, const message_type& message, stream_output& out)
@@ -69,19 +71,45 @@ struct request_response
 	std::string message;
 	unsigned int tries;
 	long long time_ms;
+
+	// every try, not just the last one
+	transfer_totals transferred;
+
+	// what the server said the last time, or 0 if it didn't say anything
+	int status_code = 0;
 };
 
 
+// if there's a pacer, each try waits its turn with it first, and tells it what the server said about the rate limit afterwards.
 template <typename make_request, typename Stream>
-request_response request_with_retries(make_request req, unsigned int retries, Stream& os)
+request_response request_with_retries(make_request req, unsigned int retries, Stream& os, rate_pacer* pacer = nullptr)
 {
 	// Basically, before this is called, a URL is printed, and console IO buffers until it sees a newline.
 	// I want people to see the URL for the request that's happening, while it's happening.
 	os.flush();
 	const auto start_time = std::chrono::steady_clock::now();
+	transfer_totals transferred;
+	int status_code = 0;
 	for (unsigned int i = 0; i < retries; i++)
 	{
+		if (pacer != nullptr)
+		{
+			const auto send_at = pacer->reserve();
+			const auto wait = std::chrono::duration_cast<std::chrono::seconds>(send_at - std::chrono::steady_clock::now());
+			if (wait.count() > 0)
+			{
+				os << " (waiting " << wait.count() << pluralize(wait.count(), " second", " seconds") << " to stay under the rate limit)";
+				os.flush();
+			}
+			std::this_thread::sleep_until(send_at);
+		}
+
 		net_response response = req();
+		transferred.add(response.timing);
+		status_code = response.status_code;
+
+		if (pacer != nullptr)
+			pacer->update(response.rate_limit);
 
 		const auto end_time = std::chrono::steady_clock::now();
 
@@ -118,12 +146,12 @@ request_response request_with_retries(make_request req, unsigned int retries, St
 		}
 
 		// must be 200, OK response
-		return request_response{ response.okay, std::move(response.message), i + 1, std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() };
+		return request_response{ response.okay, std::move(response.message), i + 1, std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(), transferred, status_code };
 	}
 
 	const auto end_time = std::chrono::steady_clock::now();
 
 	os << " Error: Maximum retries reached.";
-	return request_response{ false,  "Maximum retries reached.", retries, std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() };
+	return request_response{ false,  "Maximum retries reached.", retries, std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(), transferred, status_code };
 }
 #endif
@@ -0,0 +1,8 @@
+#ifndef MSYNC_TIMELINES_HPP
+#define MSYNC_TIMELINES_HPP
+
+// which timeline to download or look at.
+// this is on its own so that things that just need to name a timeline don't have to include all of recv_helpers.hpp
+enum class to_get { notifications, home, dms, lists, bookmarks };
+
+#endif
@@ -0,0 +1,179 @@
+#include "transfer_stats.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+using json = nlohmann::json;
+
+unsigned long long nonnegative(long long count)
+{
+	return count > 0 ? static_cast<unsigned long long>(count) : 0;
+}
+
+void transfer_totals::add(const transfer_timing& timing)
+{
+	requests++;
+
+	// curl counts a small body that goes out along with the headers in both of these, so take the bigger one instead of counting it twice.
+	// for big uploads, that leaves out the headers, but those are tiny next to the file.
+	sent_bytes += std::max(nonnegative(timing.request_bytes), nonnegative(timing.sent_bytes));
+	received_bytes += nonnegative(timing.header_bytes) + nonnegative(timing.wire_bytes);
+	decoded_bytes += nonnegative(timing.body_bytes);
+}
+
+transfer_totals& transfer_totals::operator+=(const transfer_totals& other)
+{
+	requests += other.requests;
+	sent_bytes += other.sent_bytes;
+	received_bytes += other.received_bytes;
+	decoded_bytes += other.decoded_bytes;
+	posts += other.posts;
+	return *this;
+}
+
+std::string format_bytes(unsigned long long bytes)
+{
+	if (bytes < 1024)
+		return std::to_string(bytes) + (bytes == 1 ? " byte" : " bytes");
+
+	static constexpr std::array<const char*, 4> units = { "KB", "MB", "GB", "TB" };
+	double size = static_cast<double>(bytes) / 1024;
+	size_t unit = 0;
+	while (size >= 1024 && unit + 1 < units.size())
+	{
+		size /= 1024;
+		unit++;
+	}
+
+	char formatted[32];
+	std::snprintf(formatted, sizeof(formatted), "%.1f %s", size, units[unit]);
+	return formatted;
+}
+
+sync_stats::account_stats& sync_stats::account_for(std::string_view account)
+{
+	auto found = accounts.find(account);
+	if (found == accounts.end())
+		found = accounts.emplace(std::string{ account }, account_stats{}).first;
+	return found->second;
+}
+
+void add_to(std::map<std::string, transfer_totals, std::less<>>& totals, std::string_view name, const transfer_totals& to_add)
+{
+	auto found = totals.find(name);
+	if (found == totals.end())
+		found = totals.emplace(std::string{ name }, transfer_totals{}).first;
+	found->second += to_add;
+}
+
+void sync_stats::add_timeline(std::string_view account, std::string_view timeline, const transfer_totals& totals)
+{
+	const std::lock_guard<std::mutex> guard{ stats_lock };
+	add_to(account_for(account).timelines, timeline, totals);
+}
+
+void sync_stats::add_send(std::string_view account, std::string_view route, const transfer_totals& totals)
+{
+	const std::lock_guard<std::mutex> guard{ stats_lock };
+	add_to(account_for(account).sends, route, totals);
+}
+
+bool sync_stats::empty() const
+{
+	const std::lock_guard<std::mutex> guard{ stats_lock };
+	return accounts.empty();
+}
+
+transfer_totals sum_totals(const std::map<std::string, transfer_totals, std::less<>>& totals)
+{
+	transfer_totals total;
+	for (const auto& entry : totals)
+		total += entry.second;
+	return total;
+}
+
+void print_totals(std::ostream& out, const transfer_totals& totals, const char* posts_name)
+{
+	out << totals.requests << (totals.requests == 1 ? " request, " : " requests, ")
+		<< format_bytes(totals.sent_bytes) << " sent, "
+		<< format_bytes(totals.received_bytes) << " received (" << format_bytes(totals.decoded_bytes) << " decoded)";
+
+	if (totals.posts != 0)
+		out << ", " << totals.posts << ' ' << posts_name;
+
+	out << '\n';
+}
+
+void sync_stats::print(std::ostream& out) const
+{
+	const std::lock_guard<std::mutex> guard{ stats_lock };
+
+	transfer_totals everything;
+	for (const auto& [account, stats] : accounts)
+	{
+		transfer_totals account_total = sum_totals(stats.timelines);
+		account_total += sum_totals(stats.sends);
+		everything += account_total;
+
+		out << account << ": ";
+		print_totals(out, account_total, "posts and calls");
+
+		for (const auto& [timeline, totals] : stats.timelines)
+		{
+			out << "    " << timeline << ": ";
+			print_totals(out, totals, totals.posts == 1 ? "post" : "posts");
+		}
+
+		for (const auto& [route, totals] : stats.sends)
+		{
+			out << "    sent " << route << ": ";
+			print_totals(out, totals, totals.posts == 1 ? "call" : "calls");
+		}
+	}
+
+	if (accounts.size() > 1)
+	{
+		out << "Total: ";
+		print_totals(out, everything, "posts and calls");
+	}
+}
+
+json totals_json(const transfer_totals& totals)
+{
+	return json{
+		{ "requests", totals.requests },
+		{ "sent_bytes", totals.sent_bytes },
+		{ "received_bytes", totals.received_bytes },
+		{ "decoded_bytes", totals.decoded_bytes },
+		{ "posts", totals.posts }
+	};
+}
+
+std::string sync_stats::to_json(long long finished_at) const
+{
+	const std::lock_guard<std::mutex> guard{ stats_lock };
+
+	json accounts_json = json::object();
+	transfer_totals everything;
+	for (const auto& [account, stats] : accounts)
+	{
+		json timelines = json::object();
+		for (const auto& [timeline, totals] : stats.timelines)
+			timelines[timeline] = totals_json(totals);
+
+		json sends = json::object();
+		for (const auto& [route, totals] : stats.sends)
+			sends[route] = totals_json(totals);
+
+		transfer_totals account_total = sum_totals(stats.timelines);
+		account_total += sum_totals(stats.sends);
+		everything += account_total;
+
+		accounts_json[account] = json{ { "total", totals_json(account_total) }, { "timelines", std::move(timelines) }, { "send", std::move(sends) } };
+	}
+
+	return json{ { "finished_at", finished_at }, { "total", totals_json(everything) }, { "accounts", std::move(accounts_json) } }.dump();
+}
@@ -0,0 +1,60 @@
+#ifndef MSYNC_TRANSFER_STATS_HPP
+#define MSYNC_TRANSFER_STATS_HPP
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <functional>
+
+#include "../netinterface/net_interface.hpp"
+
+// how much a bunch of requests moved over the network. Retries count too, since they cost just as much.
+struct transfer_totals
+{
+	unsigned long long requests = 0;
+	unsigned long long sent_bytes = 0; // request headers and bodies
+	unsigned long long received_bytes = 0; // response headers and bodies as they came over the network, so compressed if the server compressed them
+	unsigned long long decoded_bytes = 0; // response bodies after curl decompressed them
+	unsigned long long posts = 0; // posts downloaded, or queued calls sent
+
+	// counts one request. Anything curl didn't report counts as zero.
+	void add(const transfer_timing& timing);
+
+	transfer_totals& operator+=(const transfer_totals& other);
+};
+
+// "12.3 KB", with 1 KB being 1024 bytes.
+std::string format_bytes(unsigned long long bytes);
+
+// everything one sync moved, by account, and then by timeline or by the kind of queued call.
+// recv_posts and send_posts add to it as they go, from as many threads as they like.
+class sync_stats
+{
+public:
+	void add_timeline(std::string_view account, std::string_view timeline, const transfer_totals& totals);
+	void add_send(std::string_view account, std::string_view route, const transfer_totals& totals);
+
+	bool empty() const;
+
+	// a few lines for people.
+	void print(std::ostream& out) const;
+
+	// one line of JSON for programs. finished_at is seconds since the epoch, so that lines from different syncs can be charted.
+	std::string to_json(long long finished_at) const;
+
+private:
+	struct account_stats
+	{
+		std::map<std::string, transfer_totals, std::less<>> timelines;
+		std::map<std::string, transfer_totals, std::less<>> sends;
+	};
+
+	account_stats& account_for(std::string_view account);
+
+	mutable std::mutex stats_lock;
+	std::map<std::string, account_stats, std::less<>> accounts;
+};
+
+#endif
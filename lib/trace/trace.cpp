@@ -0,0 +1,199 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <mutex>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+std::atomic<bool> trace_on{ false };
+
+struct trace_recorder
+{
+	std::mutex lock;
+	fs::path file;
+	std::chrono::steady_clock::time_point started;
+	std::vector<std::string> events;
+};
+
+trace_recorder& recorder()
+{
+	static trace_recorder rec;
+	return rec;
+}
+
+void start_trace(const fs::path& file)
+{
+	auto& rec = recorder();
+	{
+		const std::lock_guard<std::mutex> guard{ rec.lock };
+		rec.file = file;
+		rec.started = std::chrono::steady_clock::now();
+		rec.events.clear();
+	}
+	trace_on = true;
+}
+
+void finish_trace()
+{
+	if (!trace_enabled())
+		return;
+
+	trace_on = false;
+
+	auto& rec = recorder();
+	const std::lock_guard<std::mutex> guard{ rec.lock };
+
+	std::ofstream out{ rec.file.c_str(), std::ios::binary | std::ios::trunc };
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (size_t i = 0; i < rec.events.size(); i++)
+	{
+		if (i != 0) { out << ",\n"; }
+		out << rec.events[i];
+	}
+	out << "]}\n";
+
+	rec.events.clear();
+}
+
+std::chrono::microseconds thread_cpu_time()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+		return {};
+
+	// FILETIMEs count 100 nanosecond ticks
+	const auto ticks = [](const FILETIME& ft) { return (static_cast<unsigned long long>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+	return std::chrono::microseconds((ticks(kernel) + ticks(user)) / 10);
+#else
+	timespec now{};
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+		return {};
+
+	return std::chrono::seconds(now.tv_sec) + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(now.tv_nsec));
+#endif
+}
+
+// the viewer wants small numbers for thread IDs, so just hand them out in the order threads first record something.
+int trace_thread_id()
+{
+	static std::atomic<int> next_id{ 1 };
+	thread_local const int id = next_id++;
+	return id;
+}
+
+void append_json_string(std::string& out, const std::string_view str)
+{
+	constexpr std::string_view hex_digits = "0123456789abcdef";
+
+	out.push_back('"');
+	for (const char c : str)
+	{
+		switch (c)
+		{
+		case '"': out.append("\\\""); break;
+		case '\\': out.append("\\\\"); break;
+		case '\n': out.append("\\n"); break;
+		case '\r': out.append("\\r"); break;
+		case '\t': out.append("\\t"); break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				out.append("\\u00").append(1, hex_digits[(c >> 4) & 0xf]).append(1, hex_digits[c & 0xf]);
+			else
+				out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+void append_arg_name(std::string& json, const std::string_view name)
+{
+	if (!json.empty())
+		json.push_back(',');
+	append_json_string(json, name);
+	json.push_back(':');
+}
+
+trace_args& trace_args::add(const std::string_view name, const long long value)
+{
+	append_arg_name(json, name);
+	json.append(std::to_string(value));
+	return *this;
+}
+
+trace_args& trace_args::add(const std::string_view name, const std::string_view value)
+{
+	append_arg_name(json, name);
+	append_json_string(json, value);
+	return *this;
+}
+
+void trace_event(const std::string_view name, const std::string_view category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::duration duration, const trace_args& args)
+{
+	if (!trace_enabled())
+		return;
+
+	auto& rec = recorder();
+
+	// do the formatting outside the lock, it's only needed to put the event on the list
+	const auto to_us = [](auto duration) { return std::chrono::duration_cast<std::chrono::microseconds>(duration).count(); };
+
+	std::string event{ "{\"name\":" };
+	append_json_string(event, name);
+	event.append(",\"cat\":");
+	append_json_string(event, category);
+	event.append(",\"ph\":\"X\",\"pid\":1,\"tid\":").append(std::to_string(trace_thread_id()));
+	event.append(",\"ts\":").append(std::to_string(to_us(start - rec.started)));
+	event.append(",\"dur\":").append(std::to_string(to_us(duration)));
+	if (!args.json.empty())
+		event.append(",\"args\":{").append(args.json).push_back('}');
+	event.push_back('}');
+
+	const std::lock_guard<std::mutex> guard{ rec.lock };
+	rec.events.push_back(std::move(event));
+}
+
+thread_local std::chrono::steady_clock::duration tally_total{};
+
+trace_tally::trace_tally() noexcept
+{
+	if (trace_enabled())
+		start = std::chrono::steady_clock::now();
+}
+
+trace_tally::~trace_tally()
+{
+	// if tracing got turned on while this was alive, start is zero, so skip it rather than count the whole uptime
+	if (trace_enabled() && start != std::chrono::steady_clock::time_point{})
+		tally_total += std::chrono::steady_clock::now() - start;
+}
+
+trace_scope::trace_scope(const std::string_view name, const std::string_view category, const char* tally_name) :
+	enabled(trace_enabled()), name(name), category(category), tally_name(tally_name)
+{
+	if (!enabled)
+		return;
+
+	cpu_start = thread_cpu_time();
+	tally_start = tally_total;
+	start = std::chrono::steady_clock::now();
+}
+
+trace_scope::~trace_scope()
+{
+	if (!enabled)
+		return;
+
+	const auto duration = std::chrono::steady_clock::now() - start;
+	args.add("cpu_us", (thread_cpu_time() - cpu_start).count());
+	if (tally_name != nullptr)
+		args.add(tally_name, std::chrono::duration_cast<std::chrono::microseconds>(tally_total - tally_start).count());
+
+	trace_event(name, category, start, duration, args);
+}
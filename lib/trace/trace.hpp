@@ -0,0 +1,82 @@
+#ifndef MSYNC_TRACE_HPP
+#define MSYNC_TRACE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+#include <filesystem.hpp>
+
+// records where a sync spends its time as Chrome trace events, which you can open in chrome://tracing or https://ui.perfetto.dev
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h7I1nZMl2Ga9m2Q/edit
+// everything in here does nothing unless start_trace has been called, so it's fine to leave trace calls in hot code.
+
+// start collecting events. They're all kept in memory and written to the file when finish_trace is called.
+void start_trace(const fs::path& file);
+
+// write out everything that's been collected. Does nothing if start_trace wasn't called.
+void finish_trace();
+
+extern std::atomic<bool> trace_on;
+inline bool trace_enabled() noexcept
+{
+	return trace_on.load(std::memory_order_acquire);
+}
+
+// how much CPU time the calling thread has used so far.
+std::chrono::microseconds thread_cpu_time();
+
+// an event's arguments show up in the viewer when you click on it.
+// the values are kept as JSON, so they can be either numbers or strings.
+struct trace_args
+{
+	trace_args& add(std::string_view name, long long value);
+	trace_args& add(std::string_view name, std::string_view value);
+
+	std::string json;
+};
+
+// record something that took from start to start + duration on this thread.
+void trace_event(std::string_view name, std::string_view category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration duration, const trace_args& args = {});
+
+// some things, like cleaning up HTML, happen way too often to give each one its own event.
+// a trace_tally adds how long it was alive to the calling thread's running total instead,
+// and a trace_scope made with a tally name reports how much of that total piled up while it was open.
+class trace_tally
+{
+public:
+	trace_tally() noexcept;
+	~trace_tally();
+
+	trace_tally(const trace_tally&) = delete;
+	trace_tally& operator=(const trace_tally&) = delete;
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+// records an event for how long it was alive, with how much CPU time the thread used in that time as the cpu_us argument.
+class trace_scope
+{
+public:
+	trace_scope(std::string_view name, std::string_view category, const char* tally_name = nullptr);
+	~trace_scope();
+
+	trace_scope(const trace_scope&) = delete;
+	trace_scope& operator=(const trace_scope&) = delete;
+
+	trace_args args;
+
+private:
+	const bool enabled;
+	const std::string_view name;
+	const std::string_view category;
+	const char* const tally_name;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::microseconds cpu_start{};
+	std::chrono::steady_clock::duration tally_start{};
+};
+
+#endif
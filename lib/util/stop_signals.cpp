@@ -0,0 +1,22 @@
+#include "util.hpp"
+
+#include <csignal>
+
+std::atomic<bool> stop_requested = false;
+
+// only lock free atomics are safe to touch from a signal handler
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+extern "C" void request_stop(int signal)
+{
+	stop_requested.store(true);
+
+	// if it's stuck somewhere, hitting ctrl-C again should still work
+	std::signal(signal, SIG_DFL);
+}
+
+void catch_stop_signals()
+{
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+}
@@ -1,8 +1,13 @@
 #include "util.hpp"
+#include "../trace/trace.hpp"
 
 #include <regex>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <limits>
 
 std::string make_api_url(const std::string_view instance_url, const std::string_view api_route)
 {
@@ -12,6 +17,40 @@ std::string make_api_url(const std::string_view instance_url, const std::string_
 	return to_return;
 }
 
+std::string_view instance_of(const std::string_view url)
+{
+	const auto scheme_end = url.find("://");
+	if (scheme_end == std::string_view::npos)
+		return url;
+
+	return url.substr(0, url.find('/', scheme_end + 3));
+}
+
+// std::hash can be different between standard libraries (or even versions of the same one),
+// and hashes that get saved to disk have to stay the same between runs, so just use FNV-1a.
+uint_fast64_t fnv1a(const std::string_view str, uint_fast64_t hash)
+{
+	for (const unsigned char c : str)
+	{
+		hash ^= c;
+		hash = (hash * 0x100000001b3) & 0xffffffffffffffff;
+	}
+	return hash;
+}
+
+std::string hash_to_hex(uint_fast64_t hash)
+{
+	constexpr std::string_view hex_digits = "0123456789abcdef";
+
+	std::string hex(16, '0');
+	for (auto digit = hex.rbegin(); digit != hex.rend(); ++digit)
+	{
+		*digit = hex_digits[hash & 0xf];
+		hash >>= 4;
+	}
+	return hex;
+}
+
 std::optional<parsed_account> parse_account_name(const std::string& name)
 {
 	const static std::regex account_name{ R"(@?([-_~a-z0-9]+)@(?:https?://)?([-_~a-z0-9-]+\.[-_~a-z0-9-]+(?:\.[-_~a-z0-9-]+)?)[, =/\\?]*$)", std::regex::ECMAScript | std::regex::icase };
@@ -25,6 +64,60 @@ std::optional<parsed_account> parse_account_name(const std::string& name)
 	return {};
 }
 
+std::optional<unsigned long long> parse_byte_size(std::string_view size)
+{
+	unsigned long long count = 0;
+	const auto [number_end, err] = std::from_chars(size.data(), size.data() + size.size(), count);
+	if (err != std::errc{} || number_end == size.data())
+		return {};
+
+	std::string_view unit = size.substr(number_end - size.data());
+
+	const auto strip_suffix = [&unit](std::string_view suffix)
+	{
+		if (unit.size() < suffix.size())
+			return false;
+		const auto tail = unit.substr(unit.size() - suffix.size());
+		if (!std::equal(tail.begin(), tail.end(), suffix.begin(), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; }))
+			return false;
+		unit.remove_suffix(suffix.size());
+		return true;
+	};
+
+	// "MiB", "MB", and "M" all mean the same thing here, but "iB" on its own doesn't mean anything
+	if (strip_suffix("ib"))
+	{
+		if (unit.empty())
+			return {};
+	}
+	else
+	{
+		strip_suffix("b");
+	}
+
+	int shift = 0;
+	if (unit.size() == 1)
+	{
+		switch (std::tolower(static_cast<unsigned char>(unit[0])))
+		{
+		case 'k': shift = 10; break;
+		case 'm': shift = 20; break;
+		case 'g': shift = 30; break;
+		case 't': shift = 40; break;
+		default: return {};
+		}
+	}
+	else if (!unit.empty())
+	{
+		return {};
+	}
+
+	if (count > (std::numeric_limits<unsigned long long>::max() >> shift))
+		return {};
+
+	return count << shift;
+}
+
 std::time_t timegm_const(std::tm const* t);
 
 std::chrono::system_clock::time_point parse_ISO8601_timestamp(const std::string& timestamp)
@@ -51,38 +144,196 @@ std::chrono::system_clock::time_point parse_ISO8601_timestamp(const std::string&
 // if src is null, modifies dest in place
 extern "C" size_t decode_html_entities_utf8(char* dest, const char* src);
 
-std::string clean_up_html(const std::string_view to_strip)
+// SSE2 is always there on x86-64, so there's no need to check for it at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MSYNC_USE_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef MSYNC_USE_SSE2
+unsigned int lowest_set_bit(const unsigned int mask)
 {
-	if (to_strip.empty()) { return {}; }
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return idx;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// returns the index of the first < or & at or after start, or size if there aren't any.
+// most of a post is plain text, so this checks sixteen characters at a time when it can.
+size_t find_tag_or_entity(const char* str, size_t start, const size_t size)
+{
+#ifdef MSYNC_USE_SSE2
+	const __m128i open_angle = _mm_set1_epi8('<');
+	const __m128i ampersand = _mm_set1_epi8('&');
+	for (; start + 16 <= size; start += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + start));
+		const int found = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, open_angle), _mm_cmpeq_epi8(chunk, ampersand)));
+		if (found != 0)
+			return start + lowest_set_bit(static_cast<unsigned int>(found));
+	}
+#endif
 
-	const static std::regex remove_tags{ "<[^<]*?>" };
-	const static std::regex replace_line_breaks{ "<br *?/?>" };
-	const static std::regex replace_paragraph_breaks{ "</p>\\s*?<p>" };
+	for (; start < size; start++)
+	{
+		if (str[start] == '<' || str[start] == '&')
+			return start;
+	}
 
-	// regex_replace will always keep the string the same length or make it shorter, so it won't cause an overflow
-	// the author of decode_html_entities says the same thing
-	// I think the +1 here is necessary because .size() doesn't account for the null terminator that decode_html_entities will want.
-	// either way, one extra byte won't hurt
+	return size;
+}
 
-	// this is kind of a rat's nest both to avoid allocations (each regex replace requires a buffer, which can be reused, but decode_html_entities is in-place)
-	// and because we have to jump through some hoops in order to read from a string_view, because std::regex doesn't know about string views
-	// (we take a string_view to avoid an allocation on the way in, at least)
+// the same characters \s matches in a regex
+bool is_html_space(const char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
 
+// everything below takes the index of a < and returns how many characters the thing starting there is, or zero if it isn't one.
+
+// <br>, <br/>, <br />, <br    />, and so on.
+size_t match_line_break(const std::string_view html, const size_t start)
+{
+	if (html.compare(start, 3, "<br") != 0)
+		return 0;
+
+	size_t idx = start + 3;
+	while (idx < html.size() && html[idx] == ' ')
+		idx++;
+	if (idx < html.size() && html[idx] == '/')
+		idx++;
+	if (idx < html.size() && html[idx] == '>')
+		return idx + 1 - start;
+
+	return 0;
+}
+
+// a </p> and a <p> with nothing but whitespace and line breaks between them.
+size_t match_paragraph_break(const std::string_view html, const size_t start)
+{
+	if (html.compare(start, 4, "</p>") != 0)
+		return 0;
+
+	size_t idx = start + 4;
+	while (idx < html.size())
+	{
+		if (is_html_space(html[idx]))
+		{
+			idx++;
+			continue;
+		}
+
+		const size_t line_break = match_line_break(html, idx);
+		if (line_break == 0)
+			break;
+		idx += line_break;
+	}
+
+	if (html.compare(idx, 3, "<p>") == 0)
+		return idx + 3 - start;
+
+	return 0;
+}
+
+// anything from a < to the next >, as long as there isn't another < in between that doesn't start a line or paragraph break.
+// (those would have turned into newlines before the old regexes looked for tags, so they can be inside a tag.)
+size_t match_tag(const std::string_view html, const size_t start)
+{
+	size_t idx = start + 1;
+	while (idx < html.size())
+	{
+		if (html[idx] == '>')
+			return idx + 1 - start;
+
+		if (html[idx] == '<')
+		{
+			size_t skip = match_line_break(html, idx);
+			if (skip == 0)
+				skip = match_paragraph_break(html, idx);
+			if (skip == 0)
+				return 0;
+			idx += skip;
+			continue;
+		}
+
+		idx++;
+	}
+
+	return 0;
+}
+
+// this used to be three regex_replace calls (line breaks, then paragraph breaks, then all other tags), and std::regex was most of
+// the time it took to sync. Now it's one pass: plain text gets copied over in bulk, and the only places it stops to look
+// are at a < (which might be a tag) or an & (which might be an entity).
+// entities get decoded afterwards, in place, only if there was an & at all.
+// they're decoded after the tags are gone, same as before, so that what an entity decodes to (like &lt;p&gt;) is never mistaken for a tag.
+std::string clean_up_html(const std::string_view to_strip)
+{
+	if (to_strip.empty()) { return {}; }
+
+	const trace_tally cleaning;
+
+	// stripping tags never makes the string longer, and decode_html_entities wants one extra byte for a null terminator
 	std::string output_buffer(to_strip.size() + 1, '\0');
+	char* output = &output_buffer[0];
 
-	auto end_of_output = std::regex_replace(&output_buffer[0], to_strip.begin(), to_strip.end(), replace_line_breaks, "\n");
+	bool has_entities = false;
+	size_t idx = 0;
+	while (idx < to_strip.size())
+	{
+		const size_t next_special = find_tag_or_entity(to_strip.data(), idx, to_strip.size());
+		output = std::copy(to_strip.data() + idx, to_strip.data() + next_special, output);
+		idx = next_special;
 
-	// one more than the number of characters written to output_buffer.
-	// The + 1 shouldn't be necessary, since the output of this replace should always be the same length or shorter
-	// but it's better than overflowing a buffer on accident with some oddball case I didn't expect.
-	std::string par_break_temp_buffer(end_of_output - &output_buffer[0] + 1, '\0');
+		if (idx == to_strip.size())
+			break;
 
-	end_of_output = std::regex_replace(&par_break_temp_buffer[0], &output_buffer[0], end_of_output, replace_paragraph_breaks, "\n\n");
-	par_break_temp_buffer.resize(end_of_output - &par_break_temp_buffer[0]);
+		if (to_strip[idx] == '&')
+		{
+			has_entities = true;
+			*output++ = '&';
+			idx++;
+			continue;
+		}
 
-	const auto end_of_tag_output = std::regex_replace(&output_buffer[0], par_break_temp_buffer.begin(), par_break_temp_buffer.end(), remove_tags, "");
-	*end_of_tag_output = '\0';
+		if (const size_t line_break = match_line_break(to_strip, idx))
+		{
+			*output++ = '\n';
+			idx += line_break;
+		}
+		else if (const size_t paragraph_break = match_paragraph_break(to_strip, idx))
+		{
+			*output++ = '\n';
+			*output++ = '\n';
+			idx += paragraph_break;
+		}
+		else if (const size_t tag = match_tag(to_strip, idx))
+		{
+			idx += tag;
+		}
+		else
+		{
+			// just a regular <, like in a <3
+			*output++ = '<';
+			idx++;
+		}
+	}
+
+	if (!has_entities)
+	{
+		output_buffer.resize(output - &output_buffer[0]);
+		return output_buffer;
+	}
 
+	*output = '\0';
 	const size_t decoded_length = decode_html_entities_utf8(&output_buffer[0], nullptr);
 
 	output_buffer.resize(decoded_length);
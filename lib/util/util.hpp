@@ -1,15 +1,27 @@
 #ifndef MSYNC_UTIL_HPP
 #define MSYNC_UTIL_HPP
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <optional>
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <exception>
+#include <algorithm>
 
 std::string make_api_url(std::string_view instance_url, std::string_view api_route);
 
+// https://instance.url/api/v1/whatever -> https://instance.url
+// urls that aren't shaped like that come back unchanged.
+std::string_view instance_of(std::string_view url);
+
 struct parsed_account
 {
 	std::string username;
@@ -18,10 +30,26 @@ struct parsed_account
 
 std::optional<parsed_account> parse_account_name(const std::string& name);
 
+// "2M" -> 2097152. Takes a whole number with an optional K, M, G, or T after it, with or without a B or iB, in any case.
+// the units go up by 1024. Returns nothing if it's not shaped like that or it's too big.
+std::optional<unsigned long long> parse_byte_size(std::string_view size);
+
+// 64 bit FNV-1a. To hash something that comes in pieces, hand each piece the hash of the ones before it.
+uint_fast64_t fnv1a(std::string_view str, uint_fast64_t hash = 0xcbf29ce484222325);
+
+// all 16 hex digits, leading zeroes included.
+std::string hash_to_hex(uint_fast64_t hash);
+
 std::string clean_up_html(std::string_view to_strip);
 std::string& bulk_replace_mentions(std::string& str, const std::vector<std::pair<std::string_view, std::string_view>>& to_replace);
 std::chrono::system_clock::time_point parse_ISO8601_timestamp(const std::string& timestamp);
 
+// set when msync gets a SIGINT or SIGTERM after catch_stop_signals has been called.
+// the download loops check it after each page, so they can finish writing that page and save their place before stopping.
+// a second signal kills msync the usual way.
+extern std::atomic<bool> stop_requested;
+void catch_stop_signals();
+
 template <typename Number>
 const char* pluralize(Number val, const char* singular, const char* plural)
 {
@@ -72,6 +100,126 @@ void join_iterable(Iterator begin, Iterator end, const Sep& sep, Stream& stream)
 	}
 }
 
+// calls func(i) for every i in [0, count), spread across at most max_threads threads (this one included).
+// returns once every call is done. If any of them throw, the first exception is rethrown here after all the threads finish.
+template <typename Callable>
+void parallel_for(const size_t count, const unsigned int max_threads, Callable func)
+{
+	std::atomic<size_t> next_index{ 0 };
+	std::exception_ptr first_error;
+	std::mutex error_lock;
+
+	const auto worker = [&]()
+	{
+		for (size_t i = next_index++; i < count; i = next_index++)
+		{
+			try
+			{
+				func(i);
+			}
+			catch (...)
+			{
+				const std::lock_guard<std::mutex> lock{ error_lock };
+				if (!first_error)
+					first_error = std::current_exception();
+			}
+		}
+	};
+
+	const size_t thread_count = std::min<size_t>(max_threads, count);
+
+	std::vector<std::thread> threads;
+	if (thread_count > 1)
+		threads.reserve(thread_count - 1);
+
+	// this thread pitches in, too
+	for (size_t i = 1; i < thread_count; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (first_error)
+		std::rethrow_exception(first_error);
+}
+
+// like parallel_for, except there's one key per call, and at most max_per_key calls with equal keys run at the same time.
+// calls are started in order, skipping over any whose key is at its limit for the time being.
+template <typename Key, typename Callable>
+void parallel_for_limited(const std::vector<Key>& keys, const unsigned int max_threads, const unsigned int max_per_key, Callable func)
+{
+	std::mutex lock;
+	std::condition_variable call_finished;
+	std::vector<char> started(keys.size(), false);
+	std::map<Key, unsigned int, std::less<>> running;
+	std::exception_ptr first_error;
+
+	const auto worker = [&]()
+	{
+		std::unique_lock<std::mutex> guard{ lock };
+		while (true)
+		{
+			bool any_left = false;
+			size_t to_run = keys.size();
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				if (started[i]) continue;
+				any_left = true;
+				if (running[keys[i]] < std::max(max_per_key, 1u))
+				{
+					to_run = i;
+					break;
+				}
+			}
+
+			if (!any_left)
+				return;
 
+			if (to_run == keys.size())
+			{
+				call_finished.wait(guard);
+				continue;
+			}
+
+			started[to_run] = true;
+			running[keys[to_run]]++;
+			guard.unlock();
+
+			try
+			{
+				func(to_run);
+			}
+			catch (...)
+			{
+				const std::lock_guard<std::mutex> error_guard{ lock };
+				if (!first_error)
+					first_error = std::current_exception();
+			}
+
+			guard.lock();
+			running[keys[to_run]]--;
+			call_finished.notify_all();
+		}
+	};
+
+	const size_t thread_count = std::min<size_t>(max_threads, keys.size());
+
+	std::vector<std::thread> threads;
+	if (thread_count > 1)
+		threads.reserve(thread_count - 1);
+
+	for (size_t i = 1; i < thread_count; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (first_error)
+		std::rethrow_exception(first_error);
+}
 
 #endif
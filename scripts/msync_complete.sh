@@ -20,11 +20,11 @@ function _msync() {
 	# look at the last word to see what to propose next. This usually works, but not if the last thing was a command line option.
 	case "$prev" in
 		$cmd)
-			COMPREPLY=($( compgen -W 'new config sync gen generate queue yeehaw location license version help' -- $word ))
+			COMPREPLY=($( compgen -W 'new config sync show gen generate queue yeehaw location license version help' -- $word ))
 			return 0;
 			;;
 		'config')
-			COMPREPLY=($( compgen -W 'showall default sync access_token auth_code account_name instance_url client_id client_secret exclude_boosts exclude_favs exclude_follows exclude_mentions exclude_polls' -- $word ))
+			COMPREPLY=($( compgen -W 'showall default sync access_token auth_code account_name instance_url client_id client_secret exclude_boosts exclude_favs exclude_follows exclude_mentions exclude_polls post_store max_bytes' -- $word ))
 			return 0;
 			;;
 		'sync')
@@ -32,12 +32,21 @@ function _msync() {
 			if [[ "$line" == *"config"* ]]; then
 				COMPREPLY=($( compgen -W 'home notifications bookmarks' -- $word ));
 			else
-				COMPREPLY=($( compgen -W "-r --retries -p --posts -m --max-requests -s --send-only -g --get-only --recv-only $accountverbose" -- $word ));
+				COMPREPLY=($( compgen -W "-r --retries -p --posts -m --max-requests -c --concurrency -j --jobs --per-instance --trace --max-bytes --literal-queue --stats-json -s --send-only -g --get-only --recv-only $accountverbose" -- $word ));
 			fi
 			return 0;
 			;;
-		'home' | 'notifications')
-			COMPREPLY=($( compgen -W 'newest oldest off' -- $word ));
+		'show')
+			COMPREPLY=($( compgen -W 'home notifications bookmarks' -- $word ));
+			return 0;
+			;;
+		'home' | 'notifications' | 'bookmarks')
+			# same deal as sync- these could be the timeline for a config sync or for a show
+			if [[ "$subcmd" == 'show' ]]; then
+				COMPREPLY=($( compgen -W "-n --count $accountverbose" -- $word ));
+			else
+				COMPREPLY=($( compgen -W 'newest oldest off' -- $word ));
+			fi
 			return 0;
 			;;
 		'gen' | 'generate')
@@ -77,7 +86,7 @@ function _msync() {
 			return 0;
 			;;
 		'sync')
-			COMPREPLY=($( compgen -W "-r --retries -p --posts -m --max-requests -s --send-only -g --get-only --recv-only $accountverbose" -- $word ));
+			COMPREPLY=($( compgen -W "-r --retries -p --posts -m --max-requests -c --concurrency -j --jobs --per-instance --trace --max-bytes --literal-queue --stats-json -s --send-only -g --get-only --recv-only $accountverbose" -- $word ));
 			return 0;
 			;;
 	esac
@@ -0,0 +1,157 @@
+#include <catch2/catch.hpp>
+
+#include "../lib/sync/byte_budget.hpp"
+
+#include <optional>
+
+transfer_totals make_request_cost(unsigned long long sent, unsigned long long received)
+{
+	transfer_totals totals;
+	totals.requests = 1;
+	totals.sent_bytes = sent;
+	totals.received_bytes = received;
+	return totals;
+}
+
+SCENARIO("byte_budget stops handing out room before its limit is passed.")
+{
+	GIVEN("A budget of 10000 bytes.")
+	{
+		byte_budget budget{ 10000 };
+
+		WHEN("the first request reserves room.")
+		{
+			const auto first = budget.reserve();
+
+			THEN("it's allowed, with the smallest guess, since there's nothing to go on yet.")
+			{
+				REQUIRE(first == 1024ULL);
+			}
+
+			THEN("a second request at the same time is guessed to be that big too.")
+			{
+				REQUIRE(budget.reserve() == 1024ULL);
+			}
+
+			AND_WHEN("it turns out to cost 3000 bytes.")
+			{
+				budget.settle(*first, make_request_cost(1000, 2000));
+
+				THEN("that's what was spent.")
+				{
+					REQUIRE(budget.spent() == 3000);
+				}
+
+				THEN("the next two requests are guessed to be that big too, and the third one doesn't fit.")
+				{
+					const auto second = budget.reserve();
+					const auto third = budget.reserve();
+					const auto fourth = budget.reserve();
+					REQUIRE(second == 3000ULL);
+					REQUIRE(third == 3000ULL);
+					REQUIRE_FALSE(fourth.has_value());
+				}
+
+				THEN("settling a reservation for less than it guessed makes room again.")
+				{
+					const auto second = budget.reserve();
+					const auto third = budget.reserve();
+					REQUIRE_FALSE(budget.reserve().has_value());
+
+					budget.settle(*second, make_request_cost(500, 500));
+					budget.settle(*third, make_request_cost(500, 500));
+
+					REQUIRE(budget.spent() == 5000);
+					REQUIRE(budget.reserve().has_value());
+				}
+			}
+
+			AND_WHEN("it goes over the whole limit by itself.")
+			{
+				budget.settle(*first, make_request_cost(5000, 15000));
+
+				THEN("nothing else fits.")
+				{
+					REQUIRE(budget.spent() == 20000);
+					REQUIRE_FALSE(budget.reserve().has_value());
+				}
+			}
+		}
+	}
+
+	GIVEN("A budget smaller than any request.")
+	{
+		byte_budget budget{ 1 };
+
+		THEN("the first request still gets to go, but nothing after it does.")
+		{
+			const auto first = budget.reserve();
+			REQUIRE(first.has_value());
+			REQUIRE_FALSE(budget.reserve().has_value());
+
+			budget.settle(*first, make_request_cost(100, 100));
+			REQUIRE_FALSE(budget.reserve().has_value());
+		}
+	}
+
+	GIVEN("A budget with no limit.")
+	{
+		byte_budget budget{ 0 };
+
+		THEN("there's always room, and it still counts what was spent.")
+		{
+			for (int i = 0; i < 100; i++)
+			{
+				const auto reserved = budget.reserve();
+				REQUIRE(reserved.has_value());
+				budget.settle(*reserved, make_request_cost(1000, 1000000));
+			}
+			REQUIRE(budget.spent() == 100 * 1001000ULL);
+		}
+	}
+
+	GIVEN("Two account budgets inside a sync budget.")
+	{
+		byte_budget sync_budget{ 10000 };
+		byte_budget first_account{ 0, &sync_budget };
+		byte_budget second_account{ 6000, &sync_budget };
+
+		WHEN("the first account spends most of the sync's budget.")
+		{
+			for (int i = 0; i < 3; i++)
+				first_account.settle(*first_account.reserve(), make_request_cost(1000, 1600));
+
+			THEN("the sync budget counts it.")
+			{
+				REQUIRE(first_account.spent() == 7800);
+				REQUIRE(sync_budget.spent() == 7800);
+			}
+
+			THEN("the second account's guess comes from the sync's requests, and it doesn't fit in what's left.")
+			{
+				REQUIRE_FALSE(second_account.reserve().has_value());
+			}
+		}
+
+		WHEN("the second account spends up to its own limit.")
+		{
+			second_account.settle(*second_account.reserve(), make_request_cost(1000, 2000));
+			second_account.settle(*second_account.reserve(), make_request_cost(1000, 2000));
+
+			THEN("it's out of room, but the first account isn't.")
+			{
+				REQUIRE_FALSE(second_account.reserve().has_value());
+				REQUIRE(first_account.reserve() == 3000ULL);
+			}
+		}
+	}
+
+	GIVEN("No budget at all.")
+	{
+		THEN("reserve_from always has room.")
+		{
+			REQUIRE(reserve_from(nullptr) == 0ULL);
+			settle_with(nullptr, 0, make_request_cost(1, 1));
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+
+#include "test_helpers.hpp"
+
+#include "../lib/sync/checkpoint.hpp"
+
+#include <fstream>
+
+SCENARIO("Checkpoints say where to pick up a timeline from.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path checkpoint = checkpoint_file(testdir.dirname / "home.list");
+
+	GIVEN("A timeline with no checkpoint.")
+	{
+		THEN("it picks up from the last ID it's given.")
+		{
+			REQUIRE(resume_from(checkpoint, "12345") == "12345");
+			REQUIRE(resume_from(checkpoint, "").empty());
+		}
+	}
+
+	GIVEN("A checkpoint made starting from some ID.")
+	{
+		write_checkpoint(checkpoint, "100", "250");
+
+		THEN("it goes next to the timeline's file.")
+		{
+			REQUIRE(checkpoint.filename() == "home.list.checkpoint");
+			REQUIRE(fs::exists(checkpoint));
+		}
+
+		WHEN("the last ID is still the one it started from.")
+		{
+			THEN("it picks up from the checkpoint.")
+			{
+				REQUIRE(resume_from(checkpoint, "100") == "250");
+			}
+		}
+
+		WHEN("the last ID is something else.")
+		{
+			const auto last_id = GENERATE(as<std::string>{}, "250", "300", "99", "");
+
+			THEN("the checkpoint is ignored.")
+			{
+				REQUIRE(resume_from(checkpoint, last_id) == last_id);
+			}
+		}
+
+		WHEN("it's written again.")
+		{
+			write_checkpoint(checkpoint, "100", "300");
+
+			THEN("the new one replaces the old one.")
+			{
+				REQUIRE(resume_from(checkpoint, "100") == "300");
+				REQUIRE_FALSE(fs::exists(testdir.dirname / "home.list.checkpoint.tmp"));
+			}
+		}
+	}
+
+	GIVEN("A checkpoint that got cut off.")
+	{
+		{
+			std::ofstream out{ checkpoint.c_str() };
+			out << "100\n";
+		}
+
+		THEN("it's ignored.")
+		{
+			REQUIRE(resume_from(checkpoint, "100") == "100");
+		}
+	}
+}
@@ -78,8 +78,9 @@ SCENARIO("sync_settings stringify properly.")
 
 CATCH_REGISTER_ENUM(user_option, user_option::file_version, user_option::account_name, user_option::instance_url, user_option::auth_code,
 					user_option::access_token, user_option::client_secret, user_option::client_id, 
-					user_option::last_home_id, user_option::last_dm_id, user_option::last_bookmark_id, user_option::last_notification_id,
+					user_option::last_home_id, user_option::last_dm_id, user_option::last_bookmark_id, user_option::last_notification_id, user_option::max_bytes,
 					user_option::exclude_follows, user_option::exclude_favs, user_option::exclude_boosts, user_option::exclude_mentions, user_option::exclude_polls,
+					user_option::post_store,
 					user_option::pull_home, user_option::pull_dms, user_option::pull_bookmarks, user_option::pull_notifications)
 
 SCENARIO("user_option values stringify properly.")
@@ -89,8 +90,9 @@ SCENARIO("user_option values stringify properly.")
 	{
 		const auto val = GENERATE(user_option::file_version, user_option::account_name, user_option::instance_url, user_option::auth_code,
 					user_option::access_token, user_option::client_secret, user_option::client_id, 
-					user_option::last_home_id, user_option::last_dm_id, user_option::last_bookmark_id, user_option::last_notification_id,
+					user_option::last_home_id, user_option::last_dm_id, user_option::last_bookmark_id, user_option::last_notification_id, user_option::max_bytes,
 					user_option::exclude_follows, user_option::exclude_favs, user_option::exclude_boosts, user_option::exclude_mentions, user_option::exclude_polls,
+					user_option::post_store,
 					user_option::pull_home, user_option::pull_dms, user_option::pull_bookmarks, user_option::pull_notifications);
 
 		WHEN("that user_option is looked up in its array")
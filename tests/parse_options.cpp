@@ -835,6 +835,210 @@ SCENARIO("The command line parser recognizes when the user wants to sync.")
 		}
 	}
 
+	GIVEN("A command line that says 'sync' and specifies a concurrency.")
+	{
+		const char* concurrency = GENERATE(as<const char*>{}, "-c", "--concurrency");
+		std::array<char const*, 4> argv{ "msync", subcommand, concurrency, "8" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the concurrency is set")
+			{
+				REQUIRE(parsed.sync_opts.concurrency == 8);
+			}
+
+			THEN("the defaults are set correctly")
+			{
+				REQUIRE(parsed.sync_opts.retries == 3);
+				REQUIRE(parsed.sync_opts.max_requests == 0);
+				REQUIRE(parsed.sync_opts.per_call == 0);
+			}
+
+			THEN("the correct options are set")
+			{
+				REQUIRE(parsed.sync_opts.get);
+				REQUIRE(parsed.sync_opts.send);
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'sync' and specifies a number of jobs and a per instance limit.")
+	{
+		const char* jobs = GENERATE(as<const char*>{}, "-j", "--jobs");
+		std::array<char const*, 6> argv{ "msync", subcommand, jobs, "6", "--per-instance", "2" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the jobs and per instance limit are set")
+			{
+				REQUIRE(parsed.sync_opts.jobs == 6);
+				REQUIRE(parsed.sync_opts.per_instance == 2);
+			}
+
+			THEN("the defaults are set correctly")
+			{
+				REQUIRE(parsed.sync_opts.retries == 3);
+				REQUIRE(parsed.sync_opts.concurrency == 1);
+				REQUIRE(parsed.sync_opts.max_requests == 0);
+				REQUIRE(parsed.sync_opts.per_call == 0);
+			}
+
+			THEN("the correct options are set")
+			{
+				REQUIRE(parsed.sync_opts.get);
+				REQUIRE(parsed.sync_opts.send);
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'sync' and asks for a trace file.")
+	{
+		std::array<char const*, 4> argv{ "msync", subcommand, "--trace", "sync_trace.json" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the trace file is set")
+			{
+				REQUIRE(parsed.sync_opts.trace_file == "sync_trace.json");
+			}
+
+			THEN("the defaults are set correctly")
+			{
+				REQUIRE(parsed.sync_opts.retries == 3);
+				REQUIRE(parsed.sync_opts.jobs == 1);
+				REQUIRE(parsed.sync_opts.get);
+				REQUIRE(parsed.sync_opts.send);
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'sync' and asks for statistics in JSON.")
+	{
+		std::array<char const*, 4> argv{ "msync", subcommand, "--stats-json", "sync_stats.jsonl" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the statistics file is set")
+			{
+				REQUIRE(parsed.sync_opts.stats_file == "sync_stats.jsonl");
+				REQUIRE(parsed.sync_opts.trace_file.empty());
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'sync' and sets a data limit.")
+	{
+		std::array<char const*, 4> argv{ "msync", subcommand, "--max-bytes", "2M" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the limit is kept as written, to be read when the sync starts")
+			{
+				REQUIRE(parsed.sync_opts.max_bytes == "2M");
+				REQUIRE(parsed.sync_opts.max_requests == 0);
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'sync' and asks for the queue to be sent literally.")
+	{
+		std::array<char const*, 3> argv{ "msync", subcommand, "--literal-queue" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the selected mode is sync")
+			{
+				REQUIRE(parsed.selected == mode::sync);
+			}
+
+			THEN("the queue is sent literally")
+			{
+				REQUIRE(parsed.sync_opts.literal_queue);
+				REQUIRE(parsed.sync_opts.send);
+				REQUIRE(parsed.sync_opts.get);
+			}
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+		}
+	}
+
 	GIVEN("A command line that says 'sync' and specifies a number of posts per call and maximum requests.")
 	{
 		const char* posts = GENERATE(as<const char*>{}, "-p", "--posts");
@@ -1090,6 +1294,103 @@ SCENARIO("The command line parser correctly parses when the user wants to intera
 
 }
 
+SCENARIO("The command line parser recognizes when the user wants to show the newest posts.")
+{
+	GIVEN("A command line that says 'show' and a timeline.")
+	{
+		const auto timeline = GENERATE(std::make_pair("home", to_get::home), std::make_pair("notifications", to_get::notifications), std::make_pair("bookmarks", to_get::bookmarks));
+		std::array<char const*, 3> argv{ "msync", "show", timeline.first };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+
+			THEN("the selected mode is show")
+			{
+				REQUIRE(parsed.selected == mode::show);
+			}
+
+			THEN("the right timeline is selected with the default count")
+			{
+				REQUIRE(parsed.show_opt.timeline == timeline.second);
+				REQUIRE(parsed.show_opt.count == 10);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'show', a timeline, a count, and an account.")
+	{
+		const auto count_flag = GENERATE("-n", "--count");
+		std::array<char const*, 7> argv{ "msync", "show", "home", count_flag, "50", "-a", "someone@website.egg" };
+
+		CAPTURE(argv);
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+
+			THEN("everything is set")
+			{
+				REQUIRE(parsed.selected == mode::show);
+				REQUIRE(parsed.show_opt.timeline == to_get::home);
+				REQUIRE(parsed.show_opt.count == 50);
+				REQUIRE(parsed.account == "someone@website.egg");
+				REQUIRE_FALSE(parsed.show_opt.all);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'show', a timeline, and --all.")
+	{
+		std::array<char const*, 4> argv{ "msync", "show", "notifications", "--all" };
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the parse is good")
+			{
+				REQUIRE(parsed.okay);
+			}
+
+			THEN("the whole timeline is asked for")
+			{
+				REQUIRE(parsed.selected == mode::show);
+				REQUIRE(parsed.show_opt.timeline == to_get::notifications);
+				REQUIRE(parsed.show_opt.all);
+			}
+		}
+	}
+
+	GIVEN("A command line that says 'show' without a timeline.")
+	{
+		std::array<char const*, 2> argv{ "msync", "show" };
+
+		WHEN("the command line is parsed")
+		{
+			const auto& parsed = parse((int)argv.size(), argv.data());
+
+			THEN("the parse fails")
+			{
+				REQUIRE_FALSE(parsed.okay);
+				REQUIRE(parsed.selected == mode::help);
+			}
+		}
+	}
+}
+
 SCENARIO("The command line parser recognizes when the user requests yeehaw.")
 {
 	GIVEN("A command line requesting yeehaw.")
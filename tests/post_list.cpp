@@ -9,6 +9,10 @@
 #include <array>
 #include <filesystem.hpp>
 #include <string_view>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
 
 constexpr std::string_view expected_content_nocw = R"(status id: contentnocw
 url: https://website.egg/contentnocw
@@ -368,6 +372,55 @@ SCENARIO("post_list correctly serializes lists of statuses.")
 				REQUIRE(idx == actual.size());
 			}
 		}
+
+		WHEN("all of the statuses are written to a post_list as one page.")
+		{
+			std::vector<mastodon_status> page;
+			for (const auto& test_post : statuses)
+				page.push_back(test_post.status);
+
+			{
+				post_list<mastodon_status> list{ fi.filename() };
+				list.write(page.begin(), page.end());
+			}
+
+			THEN("the generated file is the same as writing them one at a time.")
+			{
+				const auto actual = read_file(fi.filename());
+
+				size_t idx = 0;
+				for (const auto& test_post : statuses)
+					idx = compare_window(test_post.expected, actual, idx);
+				REQUIRE(idx == actual.size());
+			}
+		}
+	}
+}
+
+SCENARIO("Poll percentages are written the same way an ostream would write them.")
+{
+	GIVEN("A poll with an option that got an awkward share of the votes.")
+	{
+		const auto votes = GENERATE(table<int, int>({ { 1, 3 }, { 2, 3 }, { 1, 7 }, { 5, 8 }, { 123, 1000 }, { 1, 100000 }, { 1, 3000000 }, { 999999, 1000000 }, { 7, 7 }, { 0, 9 } }));
+
+		mastodon_poll poll;
+		poll.id = "poll";
+		poll.total_votes = std::get<1>(votes);
+		poll.options = { { "option", std::get<0>(votes) } };
+
+		WHEN("it's formatted.")
+		{
+			std::string formatted;
+			append_post(formatted, poll);
+
+			THEN("the percentage matches what operator<< on a double gives.")
+			{
+				std::ostringstream expected;
+				expected << "poll id: poll\n - option " << std::get<0>(votes) << '/' << std::get<1>(votes) << " votes ("
+					<< ((double)std::get<0>(votes) / std::get<1>(votes)) * 100 << "%)\n";
+				REQUIRE(formatted == expected.str());
+			}
+		}
 	}
 }
 
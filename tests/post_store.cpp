@@ -0,0 +1,323 @@
+#include <catch2/catch.hpp>
+
+#include "test_helpers.hpp"
+
+#include "../lib/poststore/post_store.hpp"
+#include "../lib/postlist/post_list.hpp"
+#include "../lib/entities/entities.hpp"
+
+#include <msync_exception.hpp>
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+mastodon_status make_stored_status(int id)
+{
+	mastodon_status status;
+	status.id = std::to_string(id);
+	status.url = "https://website.egg/" + status.id;
+	status.content = "this is post number " + status.id + "\nit has a newline.";
+	status.visibility = "public";
+
+	// make the times go backwards from the IDs every so often, so the two indexes don't come out in the same order
+	const int minutes = id % 2 == 0 ? id : 1000 - id;
+	status.created_at = "2020-01-01T" + std::to_string(10 + minutes / 60) + ':' + std::to_string(10 + minutes % 60 % 50) + ":00.000Z";
+
+	status.author.account_name = "someone@website.egg";
+	status.author.display_name = "Some One";
+	status.favorites = static_cast<unsigned int>(id);
+	status.boosts = static_cast<unsigned int>(id * 2);
+	status.replies = 1;
+	return status;
+}
+
+void require_same_stored_status(const mastodon_status& first, const mastodon_status& second)
+{
+	std::ostringstream first_text, second_text;
+	first_text << first;
+	second_text << second;
+	REQUIRE(first_text.str() == second_text.str());
+	REQUIRE(first.created_at == second.created_at);
+	REQUIRE(first.author.id == second.author.id);
+	REQUIRE(first.author.note == second.author.note);
+	REQUIRE(first.author.url == second.author.url);
+	REQUIRE(first.author.avatar == second.author.avatar);
+	REQUIRE(first.author.fields.size() == second.author.fields.size());
+	for (size_t i = 0; i < first.author.fields.size(); i++)
+	{
+		REQUIRE(first.author.fields[i].name == second.author.fields[i].name);
+		REQUIRE(first.author.fields[i].value == second.author.fields[i].value);
+	}
+	REQUIRE(first.poll.has_value() == second.poll.has_value());
+	if (first.poll.has_value())
+	{
+		REQUIRE(first.poll->you_voted == second.poll->you_voted);
+		REQUIRE(first.poll->voted_for == second.poll->voted_for);
+	}
+}
+
+SCENARIO("Posts survive being turned into records and back.")
+{
+	GIVEN("A status with everything filled in.")
+	{
+		mastodon_status status = make_stored_status(1234);
+		status.content_warning = "cw";
+		status.reply_to_post_id = "1000";
+		status.original_post_url = "https://another.egg/1";
+		status.boosted_by = "booster@another.egg";
+		status.boosted_by_display_name = "Booster";
+		status.boosted_by_bot = true;
+		status.attachments = { { "https://website.egg/image.png", "an image" }, { "https://website.egg/sound.mp3", "" } };
+		status.author.id = "55";
+		status.author.note = "a note";
+		status.author.avatar = "https://website.egg/avatar.png";
+		status.author.is_bot = true;
+		status.author.fields = { { "website", "https://website.egg" }, { "pronouns", "they/them" } };
+		status.poll = mastodon_poll{ "poll", "2020-01-02T00:00:00.000Z", false, 10, true, { 0, 2 }, { { "yes", 5 }, { "no", 3 }, { "maybe", 2 } } };
+
+		WHEN("it's turned into a record and read back.")
+		{
+			std::string record;
+			append_record(record, status);
+
+			mastodon_status read;
+			read_record(record, read);
+
+			THEN("it's the same.")
+			{
+				require_same_stored_status(status, read);
+			}
+		}
+
+		WHEN("its record is cut off.")
+		{
+			std::string record;
+			append_record(record, status);
+			record.resize(record.size() / 2);
+
+			mastodon_status read;
+
+			THEN("reading it throws.")
+			{
+				REQUIRE_THROWS_AS(read_record(record, read), msync_exception);
+			}
+		}
+	}
+
+	GIVEN("Notifications with and without a status.")
+	{
+		mastodon_notification follow;
+		follow.id = "77";
+		follow.type = notif_type::follow;
+		follow.created_at = "2020-01-01T00:00:00.000Z";
+		follow.account.account_name = "follower@website.egg";
+		follow.account.display_name = "Follower";
+
+		mastodon_notification favorite = follow;
+		favorite.id = "78";
+		favorite.type = notif_type::favorite;
+		favorite.status = make_stored_status(12);
+
+		WHEN("they're turned into records and read back into the same notification.")
+		{
+			std::string follow_record, favorite_record;
+			append_record(follow_record, follow);
+			append_record(favorite_record, favorite);
+
+			mastodon_notification read;
+			read_record(favorite_record, read);
+			std::ostringstream favorite_text, read_favorite_text;
+			favorite_text << favorite;
+			read_favorite_text << read;
+
+			read_record(follow_record, read);
+			std::ostringstream follow_text, read_follow_text;
+			follow_text << follow;
+			read_follow_text << read;
+
+			THEN("they're the same, and nothing is left over from the first one.")
+			{
+				REQUIRE(favorite_text.str() == read_favorite_text.str());
+				REQUIRE(follow_text.str() == read_follow_text.str());
+				REQUIRE_FALSE(read.status.has_value());
+				REQUIRE(read.type == notif_type::follow);
+			}
+		}
+	}
+}
+
+SCENARIO("post_store saves posts that can be found by ID and by time.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path store_dir = testdir.dirname / "home.store";
+
+	GIVEN("A bunch of statuses written to a store out of order.")
+	{
+		std::vector<int> ids(300);
+		for (size_t i = 0; i < ids.size(); i++)
+			ids[i] = static_cast<int>(i) + 1;
+		std::shuffle(ids.begin(), ids.end(), std::mt19937{ 12345 });
+
+		{
+			post_store<mastodon_status> store{ store_dir };
+			for (const int id : ids)
+				store.write(make_stored_status(id));
+		}
+
+		post_store_view<mastodon_status> view{ store_dir };
+
+		THEN("every post is in it.")
+		{
+			REQUIRE(view.size() == ids.size());
+		}
+
+		WHEN("a post is looked up by ID.")
+		{
+			const int id = GENERATE(1, 9, 10, 99, 100, 150, 300);
+			const auto found = view.find(std::to_string(id));
+
+			THEN("it's found, and it's the same post.")
+			{
+				REQUIRE(found.has_value());
+				require_same_stored_status(*found, make_stored_status(id));
+			}
+		}
+
+		WHEN("an ID that isn't there is looked up.")
+		{
+			const auto id = GENERATE(as<std::string>{}, "0", "301", "1000", "abc", "", "123456789012345678901234567890123456789");
+
+			THEN("nothing is found.")
+			{
+				REQUIRE_FALSE(view.find(id).has_value());
+			}
+		}
+
+		WHEN("a range of IDs is read.")
+		{
+			const auto posts = view.ids_between("95", "105");
+
+			THEN("the posts come back in ID order, with both ends included.")
+			{
+				REQUIRE(posts.size() == 11);
+				for (size_t i = 0; i < posts.size(); i++)
+					REQUIRE(posts[i].id == std::to_string(95 + i));
+			}
+		}
+
+		WHEN("a range of IDs with no upper limit is read.")
+		{
+			const auto posts = view.ids_between("290", "");
+
+			THEN("everything from there on comes back.")
+			{
+				REQUIRE(posts.size() == 11);
+				REQUIRE(posts.front().id == "290");
+				REQUIRE(posts.back().id == "300");
+			}
+		}
+
+		WHEN("a range of times is read.")
+		{
+			const auto from = make_stored_status(100).created_at;
+			const auto to = make_stored_status(200).created_at;
+			const auto posts = view.posted_between(from, to);
+
+			THEN("every post from then comes back, oldest first.")
+			{
+				size_t expected = 0;
+				for (int id = 1; id <= 300; id++)
+				{
+					const auto created_at = make_stored_status(id).created_at;
+					if (created_at >= from && created_at <= to)
+						expected++;
+				}
+
+				REQUIRE(posts.size() == expected);
+				for (const auto& post : posts)
+				{
+					REQUIRE(post.created_at >= from);
+					REQUIRE(post.created_at <= to);
+				}
+				REQUIRE(std::is_sorted(posts.begin(), posts.end(), [](const auto& first, const auto& second) { return first.created_at < second.created_at; }));
+			}
+		}
+
+		WHEN("the store is rendered as text.")
+		{
+			std::ostringstream rendered;
+			view.render(rendered);
+
+			THEN("it's the same as a .list file with the posts in ID order.")
+			{
+				const fs::path list_file = testdir.dirname / "home.list";
+				{
+					post_list<mastodon_status> list{ list_file };
+					for (int id = 1; id <= 300; id++)
+						list.write(make_stored_status(id));
+				}
+
+				REQUIRE(rendered.str() == read_file(list_file));
+			}
+		}
+
+		WHEN("some of the posts are written again with changes, along with some new ones, by another writer.")
+		{
+			{
+				post_store<mastodon_status> store{ store_dir };
+				for (const int id : { 5, 301, 150, 302 })
+				{
+					auto status = make_stored_status(id);
+					status.favorites = 9999;
+					store.write(status);
+				}
+			}
+
+			post_store_view<mastodon_status> updated{ store_dir };
+
+			THEN("the new posts are added, and the rewritten ones aren't doubled up.")
+			{
+				REQUIRE(updated.size() == 302);
+				REQUIRE(updated.posted_between("", "").size() == 302);
+			}
+
+			THEN("looking up the rewritten posts finds the new version.")
+			{
+				for (const auto id : { "5", "150", "301", "302" })
+				{
+					const auto found = updated.find(id);
+					REQUIRE(found.has_value());
+					REQUIRE(found->favorites == 9999);
+				}
+				REQUIRE(updated.find("6")->favorites == 6);
+			}
+
+			THEN("the time index only has the new version too.")
+			{
+				const auto created_at = make_stored_status(150).created_at;
+				const auto posts = updated.posted_between(created_at, created_at);
+				REQUIRE(std::count_if(posts.begin(), posts.end(), [](const auto& post) { return post.id == "150"; }) == 1);
+				for (const auto& post : posts)
+				{
+					if (post.id == "150")
+						REQUIRE(post.favorites == 9999);
+				}
+			}
+		}
+	}
+
+	GIVEN("A folder that isn't a store.")
+	{
+		post_store_view<mastodon_notification> view{ store_dir };
+
+		THEN("it's just empty.")
+		{
+			REQUIRE(view.size() == 0);
+			REQUIRE_FALSE(view.find("1").has_value());
+			REQUIRE(view.ids_between("", "").empty());
+		}
+	}
+}
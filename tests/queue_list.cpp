@@ -9,6 +9,7 @@
 #include <fstream>
 #include <string>
 #include <array>
+#include <vector>
 #include <algorithm>
 
 SCENARIO("queue_lists save their data when destroyed.")
@@ -102,6 +103,27 @@ SCENARIO("queue_lists save their data when destroyed.")
 	}
 }
 
+SCENARIO("queue_lists don't make a file for an empty queue.")
+{
+	GIVEN("A path with no file on disk.")
+	{
+		const test_file tf = temporary_file();
+
+		WHEN("A queue_list is opened and nothing is added to it.")
+		{
+			{
+				queue_list testfi(tf.filename());
+				REQUIRE(testfi.parsed.empty());
+			}
+
+			THEN("no file is created.")
+			{
+				REQUIRE_FALSE(fs::exists(tf.filename()));
+			}
+		}
+	}
+}
+
 SCENARIO("queue_lists read data when created.")
 {
 	GIVEN("A queue_list on disk with some data.")
@@ -162,6 +184,93 @@ SCENARIO("queue_lists read data when created.")
 					REQUIRE(linesbak[1] == "UNPOST secondthing");
 					REQUIRE(linesbak[2] == "UNPOST thirdthing");
 				}
+
+				AND_THEN("The temporary file it was written to is gone.")
+				{
+					REQUIRE_FALSE(fs::exists(fs::path{ tf.filename() }.concat(".tmp")));
+				}
+			}
+		}
+
+		WHEN("A queue_list is opened and not changed, or changed and then changed back")
+		{
+			const auto original_write_time = fs::last_write_time(tf.filename());
+			const bool change_back = GENERATE(false, true);
+
+			{
+				queue_list testfi(tf.filename());
+				if (change_back)
+				{
+					auto first = std::move(testfi.parsed.front());
+					testfi.parsed.pop_front();
+					testfi.parsed.push_front(std::move(first));
+				}
+			}
+
+			THEN("the file isn't written to, and there's no backup.")
+			{
+				REQUIRE(original_write_time == fs::last_write_time(tf.filename()));
+				REQUIRE_FALSE(fs::exists(tf.filenamebak()));
+				REQUIRE(read_lines(tf.filename()) == std::vector<std::string>{ "POST firsthing", "UNPOST secondthing", "UNPOST thirdthing" });
+			}
+		}
+	}
+
+	GIVEN("A queue_list on disk with some calls that failed before.")
+	{
+		const test_file tf = temporary_file();
+
+		{
+			std::ofstream fout(tf);
+			fout << "FAILED 2 server 1700000000 FAV 12345\n";
+			fout << "BOOST 67890\n";
+			fout << "FAILED 1 rejected 1700000300 POST a post with spaces\n";
+			fout << "ADD FAV 12345\n";
+		}
+
+		WHEN("A queue_list is created")
+		{
+			queue_list testfi(tf.filename());
+
+			THEN("it knows how each call failed, and adding a call again doesn't forget that.")
+			{
+				REQUIRE(testfi.parsed.size() == 3);
+
+				const auto& fav = testfi.parsed[0];
+				REQUIRE(fav == api_call{ api_route::fav, "12345" });
+				REQUIRE(fav.attempts == 2);
+				REQUIRE(fav.last_error == call_error::server);
+				REQUIRE(fav.not_before == 1700000000);
+
+				const auto& boost = testfi.parsed[1];
+				REQUIRE(boost == api_call{ api_route::boost, "67890" });
+				REQUIRE(boost.attempts == 0);
+				REQUIRE(boost.last_error == call_error::none);
+				REQUIRE(boost.not_before == 0);
+
+				const auto& post = testfi.parsed[2];
+				REQUIRE(post == api_call{ api_route::post, "a post with spaces" });
+				REQUIRE(post.attempts == 1);
+				REQUIRE(post.last_error == call_error::rejected);
+				REQUIRE(post.not_before == 1700000300);
+			}
+
+			AND_WHEN("it's saved")
+			{
+				testfi.parsed[1].attempts = 1;
+				testfi.parsed[1].last_error = call_error::network;
+				testfi.parsed[1].not_before = 1700000600;
+				{
+					queue_list moved = std::move(testfi);
+				}
+
+				THEN("the failures are written back, in front of each call.")
+				{
+					REQUIRE(read_lines(tf.filename()) == std::vector<std::string>{
+						"FAILED 2 server 1700000000 FAV 12345",
+						"FAILED 1 network 1700000600 BOOST 67890",
+						"FAILED 1 rejected 1700000300 POST a post with spaces" });
+				}
 			}
 		}
 	}
@@ -149,7 +149,6 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 	const fs::path accountdir = allaccounts.dirname / "queueboy@website.egg";
 
 	const fs::path file_queue_dir = accountdir / File_Queue_Directory;
-	const fs::path post_queue_file = accountdir/ Queue_Filename;
 
 	GIVEN("Some posts to enqueue")
 	{
@@ -204,7 +203,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue post file is emptied.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 0);
 				}
 			}
@@ -215,7 +214,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue file is empty.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 0);
 				}
 
@@ -303,7 +302,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 			THEN("the queue file is correct.")
 			{
-				const auto lines = read_lines(post_queue_file);
+				const auto lines = print(accountdir);
 				REQUIRE(lines.size() == 2);
 				REQUIRE(lines[0] == "POST thisisapost.hi");
 				REQUIRE(lines[1] == "POST thisisapost.hi.1");
@@ -338,7 +337,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue file is updated correctly.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 1);
 					REQUIRE(lines[0] == otherfile.insert(0, "POST "));
 				}
@@ -356,7 +355,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue file is empty.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 0);
 				}
 
@@ -403,7 +402,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 			THEN("the queue file is correct.")
 			{
-				const auto lines = read_lines(post_queue_file);
+				const auto lines = print(accountdir);
 				REQUIRE(lines.size() == 2);
 				REQUIRE(lines[0] == "POST thisisapost");
 				REQUIRE(lines[1] == "POST thisisapost.1");
@@ -438,7 +437,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue file is updated correctly.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 1);
 					REQUIRE(lines[0] == otherfile.insert(0, "POST "));
 				}
@@ -456,7 +455,7 @@ SCENARIO("Queues correctly enqueue and dequeue posts.")
 
 				THEN("the queue file is empty.")
 				{
-					const auto lines = read_lines(post_queue_file);
+					const auto lines = print(accountdir);
 					REQUIRE(lines.size() == 0);
 				}
 
@@ -495,24 +494,24 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 			dequeue(api_route::post, accountdir, { "69420", "somepost", "a real lousy one" });
 
-			REQUIRE(read_lines(queue_file) == std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one"});
+			REQUIRE(print(accountdir) == std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one"});
 
 			enqueue(api_route::boost, accountdir, { "boosty", "cool guy", "friend!", "someone else" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST cool guy", "BOOST friend!", "BOOST someone else" });
 
 			enqueue(api_route::fav, accountdir, { "favvy", "cool guy", "friend!" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST cool guy", "BOOST friend!", "BOOST someone else",
 					"FAV favvy", "FAV cool guy", "FAV friend!" });
 
 			dequeue(api_route::boost, accountdir, { "someone else", "cool guy", "whoopsie" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST friend!",
 					"FAV favvy", "FAV cool guy", "FAV friend!",
@@ -520,7 +519,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 			enqueue(api_route::post, accountdir, { "one post" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST friend!",
 					"FAV favvy", "FAV cool guy", "FAV friend!",
@@ -531,7 +530,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 			dequeue(api_route::fav, accountdir, { "friend!", "whoopsie", "sorry about that" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST friend!",
 					"FAV favvy", "FAV cool guy",
@@ -541,7 +540,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 			enqueue(api_route::fav, accountdir, { "sorry about that" });
 
-			REQUIRE(read_lines(queue_file) == 
+			REQUIRE(print(accountdir) == 
 				std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 					"BOOST boosty", "BOOST friend!",
 					"FAV favvy", "FAV cool guy",
@@ -556,7 +555,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 				THEN("The file is as expected.")
 				{
-					REQUIRE(read_lines(queue_file) == std::vector<std::string>{
+					REQUIRE(print(accountdir) == std::vector<std::string>{
 						"BOOST boosty", "BOOST friend!",
 						"FAV favvy", "FAV cool guy",
 						"UNBOOST whoopsie",
@@ -576,7 +575,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 				THEN("The file is as expected.")
 				{
-					REQUIRE(read_lines(queue_file) ==
+					REQUIRE(print(accountdir) ==
 						std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 						"BOOST boosty", "BOOST friend!",
 						"UNBOOST whoopsie",
@@ -590,7 +589,7 @@ SCENARIO("Queues can handle a mix of different queued calls.")
 
 				THEN("The file is as expected.")
 				{
-					REQUIRE(read_lines(queue_file) ==
+					REQUIRE(print(accountdir) ==
 						std::vector<std::string>{"UNPOST 69420", "UNPOST somepost", "UNPOST a real lousy one",
 						"FAV favvy", "FAV cool guy",
 						"POST one post",
@@ -630,7 +629,6 @@ SCENARIO("Can enqueue and dequeue files with non-ASCII paths.", "[locale]")
 			const auto allaccounts = temporary_directory();
 			const fs::path accountdir = allaccounts.dirname / "anonymous@crime.egg";
 			const fs::path file_queue_dir = accountdir / File_Queue_Directory;
-			const fs::path queue_file = accountdir / Queue_Filename;
 
 			enqueue(api_route::post, accountdir, std::vector<std::string> {
 				u8"a friend.txt", u8"your 🤠 friend.txt",
@@ -639,7 +637,7 @@ SCENARIO("Can enqueue and dequeue files with non-ASCII paths.", "[locale]")
 
 			THEN("The queue file has the correct filenames in the correct order.")
 			{
-				REQUIRE(read_lines(queue_file) == std::vector<std::string> {
+				REQUIRE(print(accountdir) == std::vector<std::string> {
 					u8"POST a friend.txt",
 					u8"POST your 🤠 friend.txt",
 					u8"POST a friend.txt.1",
@@ -663,7 +661,7 @@ SCENARIO("Can enqueue and dequeue files with non-ASCII paths.", "[locale]")
 
 				THEN("The queue file has the correct filenames in the correct order.")
 				{
-					REQUIRE(read_lines(queue_file) == std::vector<std::string> {
+					REQUIRE(print(accountdir) == std::vector<std::string> {
 						u8"POST a friend.txt", u8"POST your 🤠 friend.txt.1"
 					});
 				}
@@ -689,7 +687,6 @@ SCENARIO("Queues refuse to enqueue empty posts and posts that aren't files.")
 	fs::create_directory(accountdir);
 
 	const fs::path file_queue_dir = accountdir / File_Queue_Directory;
-	const fs::path queue_file = accountdir / Queue_Filename;
 	GIVEN("Some post files that have neither text nor attachments.")
 	{
 		const auto blankfile = temporary_file();
@@ -706,9 +703,148 @@ SCENARIO("Queues refuse to enqueue empty posts and posts that aren't files.")
 
 			THEN("All those files got skipped.")
 			{
-				REQUIRE(read_lines(queue_file).empty());
+				REQUIRE(print(accountdir).empty());
 				REQUIRE(count_files_in_directory(file_queue_dir) == 0);
 			}
 		}
 	}
 }
+
+SCENARIO("Queueing things adds to the end of the queue file instead of rewriting it.")
+{
+	logs_off = true;
+
+	const test_dir allaccounts = temporary_directory();
+	const fs::path accountdir = allaccounts.dirname / "scripted@robot.egg";
+	fs::create_directory(accountdir);
+	const fs::path queue_file = accountdir / Queue_Filename;
+
+	GIVEN("A queue file that was written by an older msync, without a newline at the end.")
+	{
+		{
+			std::ofstream of{ queue_file.c_str() };
+			of << "FAV first\nBOOST second";
+		}
+
+		WHEN("some things are queued and unqueued, including some duplicates.")
+		{
+			enqueue(api_route::fav, accountdir, { "third", "first" });
+			dequeue(api_route::boost, accountdir, { "second", "fourth" });
+			enqueue(api_route::fav, accountdir, { "third" });
+
+			THEN("the old lines are untouched, and the changes are written after them.")
+			{
+				REQUIRE(read_lines(queue_file) == std::vector<std::string>{
+					"FAV first", "BOOST second",
+					"ADD FAV third", "ADD FAV first",
+					"REMOVE BOOST second",
+					"ADD UNBOOST fourth",
+					"ADD FAV third" });
+			}
+
+			THEN("reading the queue replays the changes, and duplicates are only kept once.")
+			{
+				REQUIRE(print(accountdir) == std::vector<std::string>{ "FAV first", "FAV third", "UNBOOST fourth" });
+			}
+
+			AND_WHEN("the queue is opened to be changed and closed again.")
+			{
+				{
+					queue_list compact = get(accountdir);
+				}
+
+				THEN("it's rewritten without the log.")
+				{
+					REQUIRE(read_lines(queue_file) == std::vector<std::string>{ "FAV first", "FAV third", "UNBOOST fourth" });
+				}
+			}
+		}
+	}
+
+	GIVEN("A queue file with copies of the same call before and after it was removed, and some lines to skip.")
+	{
+		{
+			std::ofstream of{ queue_file.c_str() };
+			of << "FAV again\nFAV kept\nFAV again\n\n# a comment\nADD FAV again\nREMOVE FAV again\n  \nADD BOOST new\nADD FAV again\nADD FAV again\nREMOVE BOOST never queued\nADD FAV kept\n";
+		}
+
+		WHEN("the queue is read.")
+		{
+			const auto queued = print(accountdir);
+
+			THEN("the remove takes out every copy before it, and the call is only queued once after that, at the end.")
+			{
+				REQUIRE(queued == std::vector<std::string>{ "FAV kept", "BOOST new", "FAV again" });
+			}
+		}
+	}
+
+	GIVEN("An empty queue.")
+	{
+		WHEN("a lot of boosts are queued one at a time.")
+		{
+			constexpr int boosts = 5000;
+			for (int i = 0; i < boosts; i++)
+				enqueue(api_route::boost, accountdir, { "a status with a long ID, number " + std::to_string(i) });
+
+			const auto queued = print(accountdir);
+
+			THEN("they're all queued in order.")
+			{
+				REQUIRE(queued.size() == boosts);
+				for (int i = 0; i < boosts; i += 499)
+					REQUIRE(queued[i] == "BOOST a status with a long ID, number " + std::to_string(i));
+			}
+
+			THEN("the log was compacted along the way.")
+			{
+				const auto lines = read_lines(queue_file);
+				REQUIRE(lines.size() == boosts);
+				REQUIRE(lines.front() == "BOOST a status with a long ID, number 0");
+				REQUIRE(std::count_if(lines.begin(), lines.end(), [](const std::string& line) { return line.compare(0, 4, "ADD ") == 0; }) < boosts / 2);
+			}
+		}
+	}
+}
+
+// this is a benchmark and takes a while to set up, so it's hidden. Run it with [benchmark]
+SCENARIO("Reading and changing a queue takes time in proportion to how big it is.", "[.][benchmark]")
+{
+	logs_off = true;
+
+	const test_dir allaccounts = temporary_directory();
+	const fs::path accountdir = allaccounts.dirname / "bulkmoderation@robot.egg";
+	fs::create_directory(accountdir);
+	const fs::path queue_file = accountdir / Queue_Filename;
+
+	const int queue_size = GENERATE(1000, 10000, 100000, 1000000);
+	constexpr int batch_size = 5000;
+
+	GIVEN("A queue with " + std::to_string(queue_size) + " calls, and a log of " + std::to_string(batch_size) + " more, half of which were already queued.")
+	{
+		{
+			std::ofstream of{ queue_file.c_str() };
+			for (int i = 0; i < queue_size; i++)
+				of << "BOOST " << i << '\n';
+			for (int i = 0; i < batch_size; i++)
+				of << "ADD BOOST " << (i % 2 == 0 ? i % queue_size : queue_size + i) << '\n';
+		}
+
+		REQUIRE(print(accountdir).size() == static_cast<size_t>(queue_size + batch_size / 2));
+
+		std::vector<std::string> not_queued;
+		for (int i = 0; i < batch_size; i++)
+			not_queued.push_back(std::to_string(i));
+
+		BENCHMARK("reading the queue")
+		{
+			return print(accountdir);
+		};
+
+		// context doesn't have an undo, so dequeueing contexts that aren't in the queue looks through all of it without changing the file
+		BENCHMARK("dequeueing a batch")
+		{
+			dequeue(api_route::context, accountdir, not_queued);
+		};
+	}
+}
@@ -0,0 +1,228 @@
+#include <catch2/catch.hpp>
+
+#include "../lib/sync/rate_pacer.hpp"
+#include "../lib/sync/sync_helpers.hpp"
+
+#include <print_logger.hpp>
+
+#include "test_helpers.hpp"
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace std::chrono_literals;
+
+std::string make_reset_timestamp(std::chrono::system_clock::time_point when)
+{
+	const auto reset_at = std::chrono::system_clock::to_time_t(when);
+	struct tm reset_at_struct {};
+	wrap_gmtime(&reset_at_struct, &reset_at);
+
+	std::ostringstream timestamp;
+	timestamp << std::put_time(&reset_at_struct, "%FT%T.000Z");
+	return timestamp.str();
+}
+
+SCENARIO("pacing_interval spreads the remaining requests out once half of them are used.")
+{
+	const auto now = std::chrono::system_clock::now();
+
+	GIVEN("A response that doesn't say anything about rate limits.")
+	{
+		const rate_limit_info limits;
+
+		THEN("there's no need to wait.")
+		{
+			REQUIRE(pacing_interval(limits, now) == 0ms);
+		}
+	}
+
+	GIVEN("A response that says more than half the requests are left.")
+	{
+		const rate_limit_info limits{ 300, GENERATE(151, 200, 299), make_reset_timestamp(now + 200s) };
+
+		THEN("there's no need to wait.")
+		{
+			REQUIRE(pacing_interval(limits, now) == 0ms);
+		}
+	}
+
+	GIVEN("A response that says half or fewer of the requests are left.")
+	{
+		const int remaining = GENERATE(150, 100, 10, 1);
+		const rate_limit_info limits{ 300, remaining, make_reset_timestamp(now + 200s) };
+
+		THEN("the rest of the window is divided evenly between them.")
+		{
+			// timestamps only have whole seconds, and parsing rounds up a second to be safe
+			const auto interval = pacing_interval(limits, now);
+			CAPTURE(interval.count(), remaining);
+			REQUIRE(interval >= std::chrono::milliseconds(199000 / remaining));
+			REQUIRE(interval <= std::chrono::milliseconds(201000 / remaining));
+		}
+	}
+
+	GIVEN("A response that says there are no requests left.")
+	{
+		const rate_limit_info limits{ 300, 0, make_reset_timestamp(now + 60s) };
+
+		THEN("the interval is the time until the reset.")
+		{
+			const auto interval = pacing_interval(limits, now);
+			REQUIRE(interval >= 59s);
+			REQUIRE(interval <= 61s);
+		}
+	}
+
+	GIVEN("A response with a reset time that's already passed.")
+	{
+		const rate_limit_info limits{ 300, GENERATE(0, 10), make_reset_timestamp(now - 60s) };
+
+		THEN("there's no need to wait.")
+		{
+			REQUIRE(pacing_interval(limits, now) == 0ms);
+		}
+	}
+}
+
+SCENARIO("rate_pacer hands out request times spaced by what the server last said.")
+{
+	GIVEN("A fresh pacer.")
+	{
+		rate_pacer pacer;
+
+		WHEN("a few requests are reserved.")
+		{
+			const auto before = std::chrono::steady_clock::now();
+			const auto first = pacer.reserve();
+			const auto second = pacer.reserve();
+
+			THEN("they can all go out right away.")
+			{
+				REQUIRE(first - before < 50ms);
+				REQUIRE(second - before < 50ms);
+			}
+		}
+
+		WHEN("the server says there are no requests left.")
+		{
+			pacer.update(rate_limit_info{ 300, 0, make_reset_timestamp(std::chrono::system_clock::now() + 30s) });
+			const auto next = pacer.reserve();
+
+			THEN("the next request has to wait until the window resets.")
+			{
+				REQUIRE(next - std::chrono::steady_clock::now() > 25s);
+			}
+
+			AND_WHEN("a response comes back without rate limit headers.")
+			{
+				pacer.update(rate_limit_info{});
+
+				THEN("it's ignored, and the request after that still waits.")
+				{
+					REQUIRE(pacer.reserve() - std::chrono::steady_clock::now() > 25s);
+				}
+			}
+
+			AND_WHEN("the window resets and the server says there are plenty of requests left.")
+			{
+				pacer.update(rate_limit_info{ 300, 299, make_reset_timestamp(std::chrono::system_clock::now() + 300s) });
+
+				THEN("the next request can go out right away.")
+				{
+					REQUIRE(pacer.reserve() - std::chrono::steady_clock::now() < 50ms);
+				}
+			}
+		}
+
+		WHEN("the server says there are few requests left.")
+		{
+			pacer.update(rate_limit_info{ 300, 10, make_reset_timestamp(std::chrono::system_clock::now() + 100s) });
+			const auto first = pacer.reserve();
+			const auto second = pacer.reserve();
+
+			THEN("the requests are spaced out.")
+			{
+				REQUIRE(second - first >= 9s);
+				REQUIRE(second - first <= 11s);
+			}
+		}
+	}
+}
+
+SCENARIO("request_with_retries waits its turn with a pacer.")
+{
+	logs_off = true;
+
+	GIVEN("A request that says only a few requests are left in the next second or two.")
+	{
+		rate_pacer pacer;
+		unsigned int calls = 0;
+		const auto request = [&calls]() {
+			calls++;
+			net_response response;
+			response.message = "hi";
+			response.rate_limit = rate_limit_info{ 300, 20, make_reset_timestamp(std::chrono::system_clock::now() + 1s) };
+			return response;
+		};
+
+		WHEN("it's made a few times with the pacer.")
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < 4; i++)
+			{
+				const auto response = request_with_retries(request, 3, pl(), &pacer);
+				REQUIRE(response.success);
+			}
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+
+			THEN("every request went through, but spaced out.")
+			{
+				REQUIRE(calls == 4);
+
+				// each response says there's between one and two seconds left for 20 requests, so they should be at least 50 ms apart.
+				REQUIRE(elapsed >= 150ms);
+			}
+		}
+	}
+}
+
+SCENARIO("pacer_for keeps separately limited requests from slowing down the rest.")
+{
+	GIVEN("A media upload response that says only a few uploads are left.")
+	{
+		const std::string url = "https://pacer.test/api/v1/statuses";
+		const std::string media_url = "https://pacer.test/api/v2/media";
+
+		auto& general = pacer_for(url, "token");
+		auto& media = pacer_for(media_url, "token", rate_limit_group::media);
+		media.update(rate_limit_info{ 30, 2, make_reset_timestamp(std::chrono::system_clock::now() + 1800s) });
+
+		THEN("the media pacer is separate from the general one.")
+		{
+			REQUIRE(&general != &media);
+			REQUIRE(&general == &pacer_for("https://pacer.test/api/v1/timelines/home", "token"));
+		}
+
+		THEN("uploads are spaced out.")
+		{
+			REQUIRE(media.reserve() - std::chrono::steady_clock::now() > 10min);
+		}
+
+		THEN("GETs to the same instance aren't.")
+		{
+			const auto first = general.reserve();
+			const auto second = general.reserve();
+			REQUIRE(second - first < 1s);
+		}
+
+		THEN("other accounts on the same instance get their own pacers.")
+		{
+			REQUIRE(&general != &pacer_for(url, "other token"));
+			REQUIRE(&media != &pacer_for(media_url, "other token", rate_limit_group::media));
+		}
+	}
+}
@@ -4,10 +4,18 @@
 #include "../lib/entities/entities.hpp"
 #include "../util/util.hpp"
 
+#include <nlohmann/json.hpp>
+
 #include "read_response_json.hpp"
+#include "test_helpers.hpp"
 
 #include <utility>
 #include <string_view>
+#include <string>
+#include <vector>
+#include <array>
+
+using namespace std::string_view_literals;
 
 bool operator==(const mastodon_account_field& lhs, const mastodon_account_field& rhs)
 {
@@ -366,6 +374,32 @@ SCENARIO("read_statuses correctly reads and cleans the relevant fields from an a
 		}
 	}
 
+	GIVEN("An empty array.")
+	{
+		WHEN("the string is parsed")
+		{
+			const auto statuses = read_statuses("[]");
+
+			THEN("nothing comes back.")
+			{
+				REQUIRE(statuses.empty());
+			}
+		}
+	}
+
+	GIVEN("Something that isn't an array.")
+	{
+		const std::string_view not_an_array = GENERATE(R"({ "error": "some problem" })"sv, "12"sv, R"("hello")"sv);
+
+		WHEN("the string is parsed")
+		{
+			THEN("it throws.")
+			{
+				REQUIRE_THROWS(read_statuses(not_an_array));
+				REQUIRE_THROWS(read_notifications(not_an_array));
+			}
+		}
+	}
 }
 
 void assert_context_author(const mastodon_account& author)
@@ -452,6 +486,33 @@ SCENARIO("read_context correctly deserializes a context object.")
 			}
 		}
 	}
+
+	GIVEN("A context with nothing before or after the post.")
+	{
+		WHEN("it's deserialized.")
+		{
+			const auto result = read_context(R"({ "ancestors": [], "descendants": [] })");
+
+			THEN("nothing comes back.")
+			{
+				REQUIRE(result.ancestors.empty());
+				REQUIRE(result.descendants.empty());
+			}
+		}
+	}
+
+	GIVEN("Something that isn't a context.")
+	{
+		const std::string_view not_a_context = GENERATE(R"({ "error": "some problem" })"sv, R"({ "ancestors": [] })"sv, R"({ "ancestors": {}, "descendants": [] })"sv, "[]"sv, "12"sv);
+
+		WHEN("it's deserialized.")
+		{
+			THEN("it throws.")
+			{
+				REQUIRE_THROWS(read_context(not_a_context));
+			}
+		}
+	}
 }
 
 SCENARIO("read_upload_id correctly reads the ID from a JSON status.")
@@ -481,3 +542,213 @@ SCENARIO("read_upload_id correctly reads the ID from a JSON status.")
 	}
 }
 
+
+void require_same_account(const mastodon_account& sax, const mastodon_account& dom)
+{
+	REQUIRE(sax.id == dom.id);
+	REQUIRE(sax.account_name == dom.account_name);
+	REQUIRE(sax.display_name == dom.display_name);
+	REQUIRE(sax.note == dom.note);
+	REQUIRE(sax.url == dom.url);
+	REQUIRE(sax.avatar == dom.avatar);
+	REQUIRE(sax.fields == dom.fields);
+	REQUIRE(sax.is_bot == dom.is_bot);
+}
+
+void require_same_status(const mastodon_status& sax, const mastodon_status& dom)
+{
+	REQUIRE(sax.id == dom.id);
+	REQUIRE(sax.url == dom.url);
+	REQUIRE(sax.content_warning == dom.content_warning);
+	REQUIRE(sax.content == dom.content);
+	REQUIRE(sax.visibility == dom.visibility);
+	REQUIRE(sax.created_at == dom.created_at);
+	REQUIRE(sax.reply_to_post_id == dom.reply_to_post_id);
+	REQUIRE(sax.original_post_url == dom.original_post_url);
+	REQUIRE(sax.boosted_by == dom.boosted_by);
+	REQUIRE(sax.boosted_by_display_name == dom.boosted_by_display_name);
+	REQUIRE(sax.boosted_by_bot == dom.boosted_by_bot);
+	REQUIRE(sax.favorites == dom.favorites);
+	REQUIRE(sax.boosts == dom.boosts);
+	REQUIRE(sax.replies == dom.replies);
+
+	REQUIRE(sax.attachments.size() == dom.attachments.size());
+	for (size_t i = 0; i < sax.attachments.size(); i++)
+	{
+		REQUIRE(sax.attachments[i].url == dom.attachments[i].url);
+		REQUIRE(sax.attachments[i].description == dom.attachments[i].description);
+	}
+
+	require_same_account(sax.author, dom.author);
+
+	REQUIRE(sax.poll.has_value() == dom.poll.has_value());
+	if (sax.poll.has_value())
+	{
+		REQUIRE(sax.poll->id == dom.poll->id);
+		REQUIRE(sax.poll->expires_at == dom.poll->expires_at);
+		REQUIRE(sax.poll->expired == dom.poll->expired);
+		REQUIRE(sax.poll->total_votes == dom.poll->total_votes);
+		REQUIRE(sax.poll->you_voted == dom.poll->you_voted);
+		REQUIRE(sax.poll->voted_for == dom.poll->voted_for);
+		REQUIRE(sax.poll->options == dom.poll->options);
+	}
+}
+
+constexpr std::array<std::string_view, 6> all_status_jsons{ no_attach_status_json, boosted_status_attachment_json, anonymous_poll_json, poll_null_expiry_json, logged_in_poll_json, mentions_json };
+
+std::string make_array(const std::vector<std::string_view>& elements)
+{
+	std::string array(1, '[');
+	for (const auto element : elements)
+	{
+		array.append(element).push_back(',');
+	}
+
+	if (array.size() > 1)
+		array.back() = ']';
+	else
+		array.push_back(']');
+
+	return array;
+}
+
+SCENARIO("read_statuses and read_notifications read the same thing as the single status and notification readers.")
+{
+	GIVEN("A status json object in an array.")
+	{
+		const auto status_json = GENERATE(from_range(all_status_jsons));
+
+		WHEN("it's read by itself and as part of an array.")
+		{
+			const auto by_itself = read_status(status_json);
+			const auto in_array = read_statuses(make_array({ status_json, status_json }));
+
+			THEN("both statuses in the array match the one read by itself.")
+			{
+				REQUIRE(in_array.size() == 2);
+				require_same_status(in_array[0], by_itself);
+				require_same_status(in_array[1], by_itself);
+			}
+		}
+	}
+
+	GIVEN("An array of notifications, some with statuses and some without.")
+	{
+		std::vector<std::string> notifications(20);
+		for (size_t i = 0; i < notifications.size(); i++)
+			make_notification_json(std::to_string(1000 + i), notifications[i]);
+
+		WHEN("they're read one at a time and as an array.")
+		{
+			const auto in_array = read_notifications(make_array({ notifications.begin(), notifications.end() }));
+
+			THEN("each notification in the array matches the one read by itself.")
+			{
+				REQUIRE(in_array.size() == notifications.size());
+				for (size_t i = 0; i < notifications.size(); i++)
+				{
+					const auto by_itself = read_notification(notifications[i]);
+					REQUIRE(in_array[i].id == by_itself.id);
+					REQUIRE(in_array[i].type == by_itself.type);
+					REQUIRE(in_array[i].created_at == by_itself.created_at);
+					require_same_account(in_array[i].account, by_itself.account);
+					REQUIRE(in_array[i].status.has_value() == by_itself.status.has_value());
+					if (by_itself.status.has_value())
+						require_same_status(*in_array[i].status, *by_itself.status);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("summarize_page counts a page and finds its first ID without parsing it.")
+{
+	GIVEN("A page of real statuses.")
+	{
+		const auto status_json = GENERATE(from_range(all_status_jsons));
+		const auto page = make_array({ status_json, status_json, status_json });
+
+		WHEN("it's summarized.")
+		{
+			const auto summary = summarize_page(page);
+
+			THEN("the count and first ID match what read_statuses finds.")
+			{
+				const auto statuses = read_statuses(page);
+				REQUIRE(summary.count == statuses.size());
+				REQUIRE(summary.first_id == statuses.front().id);
+			}
+		}
+	}
+
+	GIVEN("A page of notifications, some with statuses.")
+	{
+		std::vector<std::string> notifications(30);
+		for (size_t i = 0; i < notifications.size(); i++)
+			make_notification_json(std::to_string(5000 - i), notifications[i]);
+		const auto page = make_array({ notifications.begin(), notifications.end() });
+
+		WHEN("it's summarized.")
+		{
+			const auto summary = summarize_page(page);
+
+			THEN("the count and first ID are the notification's, not the status or account inside it.")
+			{
+				REQUIRE(summary.count == 30);
+				REQUIRE(summary.first_id == "5000");
+				REQUIRE(summary.first_id == read_notifications(page).front().id);
+			}
+		}
+	}
+
+	GIVEN("A page where the ID isn't the first key, and the strings before it have brackets and escaped quotes in them.")
+	{
+		constexpr std::string_view page = R"([ { "content": "<p>look: {\"id\": \"wrong\"} [ ]</p>", "account": { "id": "also wrong" }, "id" : "12345" }, { "id": "12344" } ])";
+
+		THEN("the right ID is found and both are counted.")
+		{
+			const auto summary = summarize_page(page);
+			REQUIRE(summary.count == 2);
+			REQUIRE(summary.first_id == "12345");
+		}
+	}
+
+	GIVEN("An empty page.")
+	{
+		THEN("there's nothing in it.")
+		{
+			const auto summary = summarize_page("[]");
+			REQUIRE(summary.count == 0);
+			REQUIRE(summary.first_id.empty());
+		}
+	}
+}
+
+// the DOM deserializer that read_statuses replaced for timeline pages. read_status still uses it.
+void from_json(const nlohmann::json& j, mastodon_status& status);
+
+// run this with ./tests [!benchmark]
+SCENARIO("read_statuses is faster than parsing the whole page into a DOM first.", "[!benchmark]")
+{
+	GIVEN("A page of 40 statuses.")
+	{
+		std::vector<std::string_view> page_statuses;
+		for (size_t i = 0; i < 40; i++)
+			page_statuses.push_back(all_status_jsons[i % all_status_jsons.size()]);
+
+		const std::string page = make_array(page_statuses);
+
+		REQUIRE(read_statuses(page).size() == 40);
+		REQUIRE(nlohmann::json::parse(page).get<std::vector<mastodon_status>>().size() == 40);
+
+		BENCHMARK("SAX read_statuses")
+		{
+			return read_statuses(page);
+		};
+
+		BENCHMARK("DOM json::parse and get")
+		{
+			return nlohmann::json::parse(page).get<std::vector<mastodon_status>>();
+		};
+	}
+}
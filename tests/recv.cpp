@@ -11,6 +11,8 @@
 
 #include "../lib/constants/constants.hpp"
 
+#include <nlohmann/json.hpp>
+
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -19,12 +21,16 @@
 #include <iomanip>
 #include <chrono>
 #include <sstream>
+#include <mutex>
+#include <fstream>
 
 using namespace std::string_view_literals;
 
 constexpr unsigned int lowest_post_id = 1000000;
 constexpr unsigned int lowest_notif_id = 10000;
 constexpr unsigned int lowest_bookmark_id = 2000000;
+constexpr long long mock_request_bytes = 200;
+constexpr long long mock_header_bytes = 100;
 
 struct mock_network_get : public mock_network
 {
@@ -120,18 +126,50 @@ struct mock_network_get : public mock_network
 		}
 
 		if (lower_bound >= upper_bound)
-		{
 			toreturn.message = "[]";
-			return toreturn;
+		else
+		{
+			REQUIRE((upper_bound - lower_bound) <= limit);
+			toreturn.message = make_json_array(json_func, lower_bound, upper_bound);
 		}
 
-		REQUIRE((upper_bound - lower_bound) <= limit);
-		toreturn.message = make_json_array(json_func, lower_bound, upper_bound);
-
+		// pretend the headers each way are always the same size, and that nothing was compressed
+		toreturn.timing.request_bytes = mock_request_bytes;
+		toreturn.timing.header_bytes = mock_header_bytes;
+		toreturn.timing.wire_bytes = toreturn.timing.body_bytes = static_cast<long long>(toreturn.message.size());
 		return toreturn;
 	}
 };
 
+// the regular mock isn't thread safe, so only let one timeline at a time in
+struct locked_mock_network_get
+{
+	locked_mock_network_get(mock_network_get& wrapped) : inner(wrapped) {}
+
+	mock_network_get& inner;
+	std::mutex lock;
+
+	net_response operator()(std::string_view url, std::string_view access_token, const timeline_params& params, unsigned int limit)
+	{
+		const std::lock_guard<std::mutex> guard{ lock };
+		return inner(url, access_token, params, limit);
+	}
+};
+
+// pretends someone hit ctrl-C while a request was out
+struct interrupting_mock_network_get
+{
+	interrupting_mock_network_get(mock_network_get& wrapped) : inner(wrapped) {}
+
+	mock_network_get& inner;
+
+	net_response operator()(std::string_view url, std::string_view access_token, const timeline_params& params, unsigned int limit)
+	{
+		stop_requested = true;
+		return inner(url, access_token, params, limit);
+	}
+};
+
 SCENARIO("Recv downloads and writes the correct number of posts.")
 {
 	logs_off = true;
@@ -245,6 +283,192 @@ SCENARIO("Recv downloads and writes the correct number of posts.")
 				}
 			}
 
+			AND_WHEN("Several pages' worth of posts and notifications are added and get is called again.")
+			{
+				mock_get.arguments.clear();
+				mock_get.total_post_count += 200;
+				mock_get.total_notif_count += 100;
+				mock_get.total_bookmark_count += 5;
+
+				post_getter.get(account.second);
+
+				THEN("The same calls are made as if the pages were downloaded one at a time, each starting after the last one's newest post.")
+				{
+					const auto& args = mock_get.arguments;
+					REQUIRE(args.size() == 4 + 5 + 1);
+					REQUIRE(std::all_of(args.begin(), args.begin() + 4, [&](const get_mock_args& arg) { return arg.url == expected_notification_endpoint; }));
+					REQUIRE(std::all_of(args.begin() + 4, args.begin() + 9, [&](const get_mock_args& arg) { return arg.url == expected_home_endpoint; }));
+					REQUIRE(args[9].url == expected_bookmark_endpoint);
+
+					// the mock never returns the post right after min_id, so each page's newest post is one past a whole page from the last one's
+					std::array<char, 10> id_char_buf;
+					for (int page = 0; page < 5; page++)
+						REQUIRE(args[4 + page].min_id == sv_to_chars(lowest_post_id + 310 + page * 41, id_char_buf));
+					for (int page = 0; page < 4; page++)
+						REQUIRE(args[page].min_id == sv_to_chars(lowest_notif_id + 240 + page * 31, id_char_buf));
+				}
+
+				THEN("All three files have the expected number of posts, and the IDs are strictly increasing.")
+				{
+					// same deal- one post per page gets skipped by the mock
+					verify_file(home_timeline_file, 40 * 5 + 200 - 5, "status id: ");
+					verify_file(notifications_file, 30 * 5 + 100 - 4, "notification id: ");
+					verify_file(bookmarks_file, 40 * 5 + 5 - 1, "status id: ");
+				}
+
+				THEN("The correct last IDs are saved back to the account.")
+				{
+					std::array<char, 10> id_char_buf;
+
+					REQUIRE(account.second.get_option(user_option::last_home_id) == sv_to_chars(lowest_post_id + mock_get.total_post_count, id_char_buf));
+					REQUIRE(account.second.get_option(user_option::last_notification_id) == sv_to_chars(lowest_notif_id + mock_get.total_notif_count, id_char_buf));
+				}
+			}
+
+			AND_WHEN("Several pages' worth of posts and notifications are added, and msync is told to stop while get is running.")
+			{
+				mock_get.arguments.clear();
+				mock_get.total_post_count += 200;
+				mock_get.total_notif_count += 100;
+
+				interrupting_mock_network_get interrupting_get{ mock_get };
+				recv_posts interrupted_getter{ interrupting_get };
+				interrupted_getter.get(account.second);
+				stop_requested = false;
+
+				const auto notifications_checkpoint = checkpoint_file(notifications_file);
+
+				THEN("Only the first page of notifications is downloaded and saved, and the other timelines aren't touched.")
+				{
+					const auto& args = mock_get.arguments;
+					REQUIRE_FALSE(args.empty());
+					REQUIRE(args[0].min_id == "10240");
+					REQUIRE(std::all_of(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_notification_endpoint; }));
+
+					verify_file(notifications_file, 30 * 5 + 30, "notification id: ");
+					verify_file(home_timeline_file, 40 * 5, "status id: ");
+
+					REQUIRE(account.second.get_option(user_option::last_notification_id) == "10271");
+					REQUIRE(account.second.get_option(user_option::last_home_id) == "1000310");
+				}
+
+				THEN("A checkpoint was written for that page.")
+				{
+					REQUIRE(read_file(notifications_checkpoint) == "10240\n10271\n");
+				}
+
+				AND_WHEN("msync died before the new last ID could be saved, and get is called again.")
+				{
+					account.second.set_option(user_option::last_notification_id, "10240");
+					mock_get.arguments.clear();
+
+					post_getter.get(account.second);
+
+					THEN("It picks up from the checkpoint instead of downloading the first page again.")
+					{
+						REQUIRE(mock_get.arguments[0].url == expected_notification_endpoint);
+						REQUIRE(mock_get.arguments[0].min_id == "10271");
+					}
+
+					THEN("The files come out the same as if it had never stopped.")
+					{
+						verify_file(notifications_file, 30 * 5 + 100 - 4, "notification id: ");
+						verify_file(home_timeline_file, 40 * 5 + 200 - 5, "status id: ");
+					}
+
+					THEN("The correct last IDs are saved back to the account.")
+					{
+						std::array<char, 10> id_char_buf;
+
+						REQUIRE(account.second.get_option(user_option::last_home_id) == sv_to_chars(lowest_post_id + mock_get.total_post_count, id_char_buf));
+						REQUIRE(account.second.get_option(user_option::last_notification_id) == sv_to_chars(lowest_notif_id + mock_get.total_notif_count, id_char_buf));
+					}
+				}
+
+				AND_WHEN("The last ID was saved, and get is called again.")
+				{
+					mock_get.arguments.clear();
+
+					post_getter.get(account.second);
+
+					THEN("It picks up from the saved last ID, and the old checkpoint doesn't get in the way.")
+					{
+						REQUIRE(mock_get.arguments[0].min_id == "10271");
+						verify_file(notifications_file, 30 * 5 + 100 - 4, "notification id: ");
+					}
+				}
+			}
+
+			AND_WHEN("Several pages' worth of posts and notifications are added, and get is called again with only enough data left for one request.")
+			{
+				mock_get.arguments.clear();
+				mock_get.total_post_count += 200;
+				mock_get.total_notif_count += 100;
+
+				// the first request always gets to go, since there's nothing to guess its size from yet
+				byte_budget budget{ 1 };
+				recv_posts limited_getter{ mock_get };
+				limited_getter.budget = &budget;
+				limited_getter.get(account.second);
+
+				THEN("Only the first page of notifications is downloaded and saved, and the other timelines aren't touched.")
+				{
+					const auto& args = mock_get.arguments;
+					REQUIRE(args.size() == 1);
+					REQUIRE(args[0].url == expected_notification_endpoint);
+					REQUIRE(args[0].min_id == "10240");
+
+					verify_file(notifications_file, 30 * 5 + 30, "notification id: ");
+					verify_file(home_timeline_file, 40 * 5, "status id: ");
+
+					REQUIRE(account.second.get_option(user_option::last_notification_id) == "10271");
+					REQUIRE(account.second.get_option(user_option::last_home_id) == "1000310");
+					REQUIRE(budget.spent() > 0);
+				}
+
+				AND_WHEN("get is called again with the same budget.")
+				{
+					mock_get.arguments.clear();
+					limited_getter.get(account.second);
+
+					THEN("Nothing else is downloaded.")
+					{
+						REQUIRE(mock_get.arguments.empty());
+						REQUIRE(account.second.get_option(user_option::last_notification_id) == "10271");
+					}
+				}
+
+				AND_WHEN("get is called again with no limit.")
+				{
+					mock_get.arguments.clear();
+					post_getter.get(account.second);
+
+					THEN("It picks up where the limit stopped it, and the files come out the same as if it had never stopped.")
+					{
+						REQUIRE(mock_get.arguments[0].min_id == "10271");
+						verify_file(notifications_file, 30 * 5 + 100 - 4, "notification id: ");
+						verify_file(home_timeline_file, 40 * 5 + 200 - 5, "status id: ");
+					}
+				}
+			}
+
+			AND_WHEN("More posts are added and only the home timeline is asked for.")
+			{
+				mock_get.arguments.clear();
+				mock_get.total_post_count += 10;
+				mock_get.total_notif_count += 15;
+
+				post_getter.get(account.second, { to_get::home });
+
+				THEN("Only the home timeline is downloaded.")
+				{
+					REQUIRE(mock_get.arguments.size() == 1);
+					REQUIRE(mock_get.arguments[0].url == expected_home_endpoint);
+					verify_file(home_timeline_file, 40 * 5 + 10 - 1, "status id: ");
+					verify_file(notifications_file, 30 * 5, "notification id: ");
+				}
+			}
+
 			AND_WHEN("More posts, notifications, and bookmarks are added and get is called again, but we're rate limited.")
 			{
 				mock_get.arguments.clear();
@@ -453,4 +677,199 @@ SCENARIO("Recv downloads and writes the correct number of posts.")
 			}
 		}
 	}
+
+	GIVEN("A user account with no previously stored information that's set to use a post store.")
+	{
+		account.second.set_bool_option(user_option::post_store, true);
+
+		WHEN("That account is given to recv and told to update.")
+		{
+			recv_posts post_getter{ mock_get };
+
+			post_getter.get(account.second);
+
+			THEN("No .list files are written.")
+			{
+				REQUIRE_FALSE(fs::exists(home_timeline_file));
+				REQUIRE_FALSE(fs::exists(notifications_file));
+				REQUIRE_FALSE(fs::exists(bookmarks_file));
+			}
+
+			THEN("The stores have the expected number of posts, and render to the same thing the .list files would have.")
+			{
+				const auto render_to_file = [&user_dir](auto view, const char* filename)
+				{
+					const auto rendered = user_dir / filename;
+					std::ofstream out{ rendered.c_str() };
+					view.render(out);
+					return rendered;
+				};
+
+				verify_file(render_to_file(post_store_view<mastodon_status>{ user_dir / "home.store" }, "home.rendered"), 40 * 5, "status id: ");
+				verify_file(render_to_file(post_store_view<mastodon_notification>{ user_dir / "notifications.store" }, "notifications.rendered"), 30 * 5, "notification id: ");
+				verify_file(render_to_file(post_store_view<mastodon_status>{ user_dir / "bookmarks.store" }, "bookmarks.rendered"), 40 * 5, "status id: ");
+			}
+
+			THEN("The newest post can be looked up in the store.")
+			{
+				std::array<char, 10> id_char_buf;
+				post_store_view<mastodon_status> home{ user_dir / "home.store" };
+
+				const auto newest = home.find(account.second.get_option(user_option::last_home_id));
+				REQUIRE(newest.has_value());
+				REQUIRE(newest->id == sv_to_chars(lowest_post_id + mock_get.total_post_count, id_char_buf));
+			}
+		}
+	}
+
+	GIVEN("A user account with no previously stored information and recv set to only hold a few posts in memory.")
+	{
+		WHEN("That account is given to recv and told to update.")
+		{
+			recv_posts post_getter{ mock_get };
+			post_getter.max_buffered_posts = 45;
+
+			post_getter.get(account.second);
+
+			THEN("All three files have the expected number of posts, and the IDs are strictly increasing.")
+			{
+				verify_file(home_timeline_file, 40 * 5, "status id: ");
+				verify_file(notifications_file, 30 * 5, "notification id: ");
+				verify_file(bookmarks_file, 40 * 5, "status id: ");
+			}
+
+			THEN("The correct last IDs are saved back to the account.")
+			{
+				std::array<char, 10> id_char_buf;
+
+				REQUIRE(account.second.get_option(user_option::last_home_id) == sv_to_chars(lowest_post_id + mock_get.total_post_count, id_char_buf));
+				REQUIRE(account.second.get_option(user_option::last_notification_id) == sv_to_chars(lowest_notif_id + mock_get.total_notif_count, id_char_buf));
+				REQUIRE(account.second.get_option(user_option::last_bookmark_id) == sv_to_chars(lowest_bookmark_id + mock_get.total_bookmark_count, id_char_buf));
+			}
+
+			THEN("The temporary files are cleaned up.")
+			{
+				for (const auto& entry : fs::directory_iterator{ user_dir })
+					REQUIRE(entry.path().filename().string().find(".spill") == std::string::npos);
+			}
+		}
+	}
+
+	GIVEN("A user account with no previously stored information and somewhere to keep transfer statistics.")
+	{
+		sync_stats stats;
+
+		WHEN("That account is given to recv and told to update.")
+		{
+			recv_posts post_getter{ mock_get };
+			post_getter.stats = &stats;
+
+			post_getter.get(account.second);
+
+			const auto parsed = nlohmann::json::parse(stats.to_json(1234));
+			const auto& timelines = parsed["accounts"][std::string{ account_name }]["timelines"];
+
+			THEN("Each timeline's requests and posts are counted.")
+			{
+				REQUIRE(parsed["finished_at"] == 1234);
+				for (const auto& [timeline, posts] : { std::make_pair("home", 200), std::make_pair("notifications", 150), std::make_pair("bookmarks", 200) })
+				{
+					CAPTURE(timeline);
+					REQUIRE(timelines[timeline]["requests"] == 5);
+					REQUIRE(timelines[timeline]["posts"] == posts);
+					REQUIRE(timelines[timeline]["sent_bytes"] == 5 * mock_request_bytes);
+					REQUIRE(timelines[timeline]["received_bytes"] == timelines[timeline]["decoded_bytes"].get<long long>() + 5 * mock_header_bytes);
+				}
+			}
+
+			THEN("The account's total is the sum of its timelines.")
+			{
+				const auto& total = parsed["accounts"][std::string{ account_name }]["total"];
+				REQUIRE(total["requests"] == 15);
+				REQUIRE(total["posts"] == 550);
+				REQUIRE(total["decoded_bytes"] == timelines["home"]["decoded_bytes"].get<long long>() + timelines["notifications"]["decoded_bytes"].get<long long>() + timelines["bookmarks"]["decoded_bytes"].get<long long>());
+				REQUIRE(parsed["total"] == total);
+			}
+
+			AND_WHEN("A few more posts come in and get is called again.")
+			{
+				mock_get.total_post_count += 10;
+
+				post_getter.get(account.second);
+
+				THEN("The new requests are added to the old ones.")
+				{
+					const auto reparsed = nlohmann::json::parse(stats.to_json(1234));
+					const auto& home = reparsed["accounts"][std::string{ account_name }]["timelines"]["home"];
+					REQUIRE(home["requests"] == 6);
+					REQUIRE(home["posts"] == 200 + 9);
+				}
+			}
+		}
+	}
+
+	GIVEN("A user account with no previously stored information and recv set to download the timelines concurrently.")
+	{
+		locked_mock_network_get locked_get{ mock_get };
+
+		WHEN("That account is given to recv and told to update.")
+		{
+			recv_posts post_getter{ locked_get };
+			post_getter.concurrent_timelines = true;
+
+			post_getter.get(account.second);
+
+			THEN("Five calls each were made to the home, notification, and bookmark API endpoints with the correct default limits.")
+			{
+				const auto& args = mock_get.arguments;
+				REQUIRE(args.size() == 15);
+				REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_notification_endpoint && arg.limit == 30; }) == 5);
+				REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_home_endpoint && arg.limit == 40; }) == 5);
+				REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_bookmark_endpoint && arg.limit == 40; }) == 5);
+				REQUIRE(std::all_of(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.access_token == expected_access_token && arg.exclude_notifs.empty(); }));
+			}
+
+			THEN("All three files have the expected number of posts, and the IDs are strictly increasing.")
+			{
+				verify_file(home_timeline_file, 40 * 5, "status id: ");
+				verify_file(notifications_file, 30 * 5, "notification id: ");
+				verify_file(bookmarks_file, 40 * 5, "status id: ");
+			}
+
+			THEN("The correct last IDs are saved back to the account.")
+			{
+				std::array<char, 10> id_char_buf;
+
+				REQUIRE(account.second.get_option(user_option::last_home_id) == sv_to_chars(lowest_post_id + mock_get.total_post_count, id_char_buf));
+				REQUIRE(account.second.get_option(user_option::last_notification_id) == sv_to_chars(lowest_notif_id + mock_get.total_notif_count, id_char_buf));
+				REQUIRE(account.second.get_option(user_option::last_bookmark_id) == sv_to_chars(lowest_bookmark_id + mock_get.total_bookmark_count, id_char_buf));
+			}
+
+			AND_WHEN("More posts, notifications, and bookmarks are added and get is called again.")
+			{
+				mock_get.arguments.clear();
+				mock_get.total_post_count += 10;
+				mock_get.total_notif_count += 15;
+				mock_get.total_bookmark_count += 5;
+
+				post_getter.get(account.second);
+
+				THEN("Only one call was made to each endpoint.")
+				{
+					const auto& args = mock_get.arguments;
+					REQUIRE(args.size() == 3);
+					REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_notification_endpoint; }) == 1);
+					REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_home_endpoint; }) == 1);
+					REQUIRE(std::count_if(args.begin(), args.end(), [&](const get_mock_args& arg) { return arg.url == expected_bookmark_endpoint; }) == 1);
+				}
+
+				THEN("All three files have the expected number of posts, and the IDs are strictly increasing.")
+				{
+					verify_file(home_timeline_file, 40 * 5 + 10 - 1, "status id: ");
+					verify_file(notifications_file, 30 * 5 + 15 - 1, "notification id: ");
+					verify_file(bookmarks_file, 40 * 5 + 5 - 1, "status id: ");
+				}
+			}
+		}
+	}
 }
@@ -0,0 +1,305 @@
+#include <catch2/catch.hpp>
+
+#include "../lib/sync/response_cache.hpp"
+
+#include "test_helpers.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// acts like a server that tags everything it sends with an etag that changes whenever the body does.
+struct mock_validating_get
+{
+	std::string body = "the whole thread";
+	std::string etag = "W/\"first\"";
+	std::string last_modified = "Wed, 21 Oct 2015 07:28:00 GMT";
+
+	struct request
+	{
+		std::string url;
+		std::string if_none_match;
+		std::string if_modified_since;
+	};
+	std::vector<request> requests;
+
+	net_response operator()(std::string_view url, std::string_view, const timeline_params& params, unsigned int)
+	{
+		requests.push_back(request{ std::string{ url }, std::string{ params.if_none_match }, std::string{ params.if_modified_since } });
+
+		net_response toreturn;
+		toreturn.etag = etag;
+		toreturn.last_modified = last_modified;
+		if (!params.if_none_match.empty() && params.if_none_match == etag)
+		{
+			toreturn.status_code = 304;
+			return toreturn;
+		}
+
+		toreturn.message = body;
+		return toreturn;
+	}
+};
+
+SCENARIO("cached_get only downloads responses that have changed.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path cache_dir = testdir.dirname / "cache";
+	constexpr std::string_view url = "https://cool.account/api/v1/statuses/12345/context";
+
+	GIVEN("A server that sends validators with its responses.")
+	{
+		mock_validating_get mockget;
+		cached_get<mock_validating_get> cached{ mockget, cache_dir };
+
+		WHEN("something is requested for the first time.")
+		{
+			const auto response = cached(url, "token", timeline_params{}, 0);
+
+			THEN("the request isn't conditional.")
+			{
+				REQUIRE(mockget.requests.size() == 1);
+				REQUIRE(mockget.requests[0].if_none_match.empty());
+				REQUIRE(mockget.requests[0].if_modified_since.empty());
+			}
+
+			THEN("the response is passed through.")
+			{
+				REQUIRE(response.okay);
+				REQUIRE(response.status_code == 200);
+				REQUIRE(response.message == "the whole thread");
+			}
+
+			THEN("the response is saved.")
+			{
+				REQUIRE(count_files_in_directory(cache_dir) == 1);
+			}
+
+			AND_WHEN("it's requested again, and hasn't changed.")
+			{
+				const auto second = cached(url, "token", timeline_params{}, 0);
+
+				THEN("the second request sent the validators from the first.")
+				{
+					REQUIRE(mockget.requests.size() == 2);
+					REQUIRE(mockget.requests[1].if_none_match == "W/\"first\"");
+					REQUIRE(mockget.requests[1].if_modified_since == "Wed, 21 Oct 2015 07:28:00 GMT");
+				}
+
+				THEN("the saved body is returned like a normal response.")
+				{
+					REQUIRE(second.okay);
+					REQUIRE(second.status_code == 200);
+					REQUIRE(second.message == "the whole thread");
+				}
+			}
+
+			AND_WHEN("it's requested again by a different cached_get, like on the next sync.")
+			{
+				cached_get<mock_validating_get> next_sync{ mockget, cache_dir };
+				const auto second = next_sync(url, "token", timeline_params{}, 0);
+
+				THEN("the saved body is still used.")
+				{
+					REQUIRE(mockget.requests.size() == 2);
+					REQUIRE(mockget.requests[1].if_none_match == "W/\"first\"");
+					REQUIRE(second.message == "the whole thread");
+				}
+			}
+
+			AND_WHEN("it's requested again after it's changed.")
+			{
+				mockget.body = "the whole thread, plus a reply";
+				mockget.etag = "W/\"second\"";
+
+				const auto second = cached(url, "token", timeline_params{}, 0);
+
+				THEN("the new body is returned.")
+				{
+					REQUIRE(second.status_code == 200);
+					REQUIRE(second.message == "the whole thread, plus a reply");
+				}
+
+				AND_WHEN("it's requested a third time.")
+				{
+					const auto third = cached(url, "token", timeline_params{}, 0);
+
+					THEN("the new version was saved over the old one.")
+					{
+						REQUIRE(mockget.requests.size() == 3);
+						REQUIRE(mockget.requests[2].if_none_match == "W/\"second\"");
+						REQUIRE(third.message == "the whole thread, plus a reply");
+						REQUIRE(count_files_in_directory(cache_dir) == 1);
+					}
+				}
+			}
+
+			AND_WHEN("the same url is requested with different parameters.")
+			{
+				timeline_params params;
+				params.max_id = "100";
+				cached(url, "token", params, 20);
+
+				THEN("it's treated as a different request.")
+				{
+					REQUIRE(mockget.requests.size() == 2);
+					REQUIRE(mockget.requests[1].if_none_match.empty());
+					REQUIRE(count_files_in_directory(cache_dir) == 2);
+				}
+			}
+		}
+	}
+
+	GIVEN("A server that doesn't send validators.")
+	{
+		mock_validating_get mockget;
+		mockget.etag.clear();
+		mockget.last_modified.clear();
+		cached_get<mock_validating_get> cached{ mockget, cache_dir };
+
+		WHEN("something is requested twice.")
+		{
+			cached(url, "token", timeline_params{}, 0);
+			const auto second = cached(url, "token", timeline_params{}, 0);
+
+			THEN("nothing is saved, and neither request is conditional.")
+			{
+				REQUIRE_FALSE(fs::exists(cache_dir));
+				REQUIRE(mockget.requests.size() == 2);
+				REQUIRE(mockget.requests[1].if_none_match.empty());
+				REQUIRE(mockget.requests[1].if_modified_since.empty());
+				REQUIRE(second.message == "the whole thread");
+			}
+		}
+	}
+}
+
+SCENARIO("Cached responses survive being written and read back.")
+{
+	const test_dir testdir = temporary_directory();
+
+	GIVEN("A response with a body that has newlines in it.")
+	{
+		timeline_params params;
+		std::vector<std::string_view> excludes{ "follow", "favourite" };
+		params.exclude_notifs = &excludes;
+		params.since_id = "5";
+		const auto key = response_cache_key("https://cool.account/api/v1/notifications", params, 30);
+		const auto file = response_cache_file(testdir.dirname, key);
+
+		const cached_response saved{ "\"abc\"", "", "[\n{\"id\": \"6\"}\r\n]\n" };
+		write_cached_response(file, key, saved);
+
+		WHEN("it's read back with the same key.")
+		{
+			const auto read = read_cached_response(file, key);
+
+			THEN("it's the same.")
+			{
+				REQUIRE(read.has_value());
+				REQUIRE(read->etag == saved.etag);
+				REQUIRE(read->last_modified == saved.last_modified);
+				REQUIRE(read->body == saved.body);
+			}
+		}
+
+		WHEN("it's read back with a different key.")
+		{
+			params.since_id = "6";
+			const auto read = read_cached_response(file, response_cache_key("https://cool.account/api/v1/notifications", params, 30));
+
+			THEN("nothing comes back.")
+			{
+				REQUIRE_FALSE(read.has_value());
+			}
+		}
+	}
+
+	GIVEN("A file that doesn't exist.")
+	{
+		THEN("nothing comes back.")
+		{
+			REQUIRE_FALSE(read_cached_response(testdir.dirname / "nothing.response", "some key").has_value());
+		}
+	}
+}
+
+SCENARIO("Saved responses that turn out to be bad or old get removed.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path cache_dir = testdir.dirname / "cache";
+	constexpr std::string_view url = "https://cool.account/api/v1/statuses/12345/context";
+
+	GIVEN("A response that's been saved.")
+	{
+		mock_validating_get mockget;
+		cached_get<mock_validating_get> cached{ mockget, cache_dir };
+		cached(url, "token", timeline_params{}, 0);
+
+		THEN("only the response is left in the cache folder, not a temporary file.")
+		{
+			REQUIRE(count_files_in_directory(cache_dir) == 1);
+			REQUIRE(fs::exists(response_cache_file(cache_dir, response_cache_key(url, timeline_params{}, 0))));
+		}
+
+		WHEN("it's forgotten and requested again.")
+		{
+			cached.forget(url, timeline_params{}, 0);
+			const auto second = cached(url, "token", timeline_params{}, 0);
+
+			THEN("the request isn't conditional, so the whole body comes back again.")
+			{
+				REQUIRE(mockget.requests.size() == 2);
+				REQUIRE(mockget.requests[1].if_none_match.empty());
+				REQUIRE(second.message == "the whole thread");
+			}
+		}
+
+		WHEN("the cache is pruned of anything older than an hour.")
+		{
+			const auto removed = prune_response_cache(cache_dir, std::chrono::hours{ 1 });
+
+			THEN("the fresh response is kept.")
+			{
+				REQUIRE(removed == 0);
+				REQUIRE(count_files_in_directory(cache_dir) == 1);
+			}
+		}
+
+		WHEN("the response hasn't been used in a long time, and the cache is pruned.")
+		{
+			const auto file = response_cache_file(cache_dir, response_cache_key(url, timeline_params{}, 0));
+			fs::last_write_time(file, fs::last_write_time(file) - std::chrono::hours{ 24 * 60 });
+			const auto removed = prune_response_cache(cache_dir, Response_Cache_Lifetime);
+
+			THEN("it's removed.")
+			{
+				REQUIRE(removed == 1);
+				REQUIRE(count_files_in_directory(cache_dir) == 0);
+			}
+		}
+
+		WHEN("the response is old, but gets used again before the cache is pruned.")
+		{
+			const auto file = response_cache_file(cache_dir, response_cache_key(url, timeline_params{}, 0));
+			fs::last_write_time(file, fs::last_write_time(file) - std::chrono::hours{ 24 * 60 });
+			cached(url, "token", timeline_params{}, 0);
+			const auto removed = prune_response_cache(cache_dir, Response_Cache_Lifetime);
+
+			THEN("it's kept.")
+			{
+				REQUIRE(mockget.requests.size() == 2);
+				REQUIRE(removed == 0);
+				REQUIRE(count_files_in_directory(cache_dir) == 1);
+			}
+		}
+	}
+
+	GIVEN("A cache folder that doesn't exist.")
+	{
+		THEN("pruning it doesn't do anything.")
+		{
+			REQUIRE(prune_response_cache(cache_dir, Response_Cache_Lifetime) == 0);
+		}
+	}
+}
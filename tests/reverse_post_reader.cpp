@@ -0,0 +1,245 @@
+#include <catch2/catch.hpp>
+
+#include "test_helpers.hpp"
+
+#include "../lib/postlist/reverse_post_reader.hpp"
+#include "../lib/postlist/post_list.hpp"
+#include "../lib/poststore/post_store.hpp"
+#include "../lib/options/global_options.hpp"
+#include "../lib/sync/show.hpp"
+#include "../lib/entities/entities.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+mastodon_status make_reversible_status(int id)
+{
+	mastodon_status status;
+	status.id = std::to_string(id);
+	status.url = "https://website.egg/" + status.id;
+	status.content = "post number " + status.id;
+	// make some of them a lot longer than the others, so that posts end up split across chunks
+	if (id % 7 == 0)
+		status.content.append(static_cast<size_t>(id) * 13, 'a');
+	status.visibility = "public";
+	status.author.account_name = "someone@website.egg";
+	return status;
+}
+
+std::string status_text(const mastodon_status& status)
+{
+	std::ostringstream text;
+	text << status;
+	return text.str();
+}
+
+std::vector<std::string> read_all_backwards(const fs::path& file, size_t chunk_size)
+{
+	reverse_post_reader reader{ file, chunk_size };
+	std::vector<std::string> posts;
+	while (auto post = reader.next())
+		posts.push_back(std::move(*post));
+	return posts;
+}
+
+SCENARIO("reverse_post_reader reads a post list from the end.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path list_file = testdir.dirname / "home.list";
+
+	GIVEN("A post list with some posts in it.")
+	{
+		constexpr int post_count = 100;
+		{
+			post_list<mastodon_status> list{ list_file };
+			for (int id = 1; id <= post_count; id++)
+				list.write(make_reversible_status(id));
+		}
+
+		WHEN("it's read backwards with different chunk sizes.")
+		{
+			const size_t chunk_size = GENERATE(1, 2, 15, 16, 17, 64, 333, 4096, 1024 * 1024);
+			const auto posts = read_all_backwards(list_file, chunk_size);
+
+			THEN("every post comes out, newest first, exactly how it was written.")
+			{
+				REQUIRE(posts.size() == post_count);
+				for (int i = 0; i < post_count; i++)
+					REQUIRE(posts[i] == status_text(make_reversible_status(post_count - i)));
+			}
+		}
+
+		WHEN("only the first few are read.")
+		{
+			reverse_post_reader reader{ list_file, 4096 };
+			const auto newest = reader.next();
+			const auto second_newest = reader.next();
+
+			THEN("they're the newest ones.")
+			{
+				REQUIRE(newest == status_text(make_reversible_status(post_count)));
+				REQUIRE(second_newest == status_text(make_reversible_status(post_count - 1)));
+			}
+		}
+
+		WHEN("the last post got cut off before its separator.")
+		{
+			{
+				std::ofstream out{ list_file.c_str(), std::ios::app };
+				out << "status id: partial";
+			}
+
+			const auto posts = read_all_backwards(list_file, 64);
+
+			THEN("the cut off post comes out first, followed by the rest.")
+			{
+				REQUIRE(posts.size() == post_count + 1);
+				REQUIRE(posts[0] == "status id: partial");
+				REQUIRE(posts[1] == status_text(make_reversible_status(post_count)));
+				REQUIRE(posts.back() == status_text(make_reversible_status(1)));
+			}
+		}
+	}
+
+	GIVEN("A post list that doesn't exist.")
+	{
+		reverse_post_reader reader{ list_file };
+
+		THEN("there's nothing in it.")
+		{
+			REQUIRE_FALSE(reader.next().has_value());
+		}
+	}
+
+	GIVEN("An empty post list.")
+	{
+		{
+			std::ofstream out{ list_file.c_str() };
+		}
+
+		reverse_post_reader reader{ list_file };
+
+		THEN("there's nothing in it.")
+		{
+			REQUIRE_FALSE(reader.next().has_value());
+		}
+	}
+}
+
+SCENARIO("show_posts prints the newest posts from a timeline.")
+{
+	const test_dir account_dir = temporary_directory();
+
+	global_options options{ account_dir.dirname };
+	auto& account = options.add_new_account("user@crime.egg");
+	const auto user_dir = account.second.get_user_directory();
+
+	const auto expected_tail = [](int first, int last)
+	{
+		std::string expected;
+		for (int id = first; id <= last; id++)
+			expected.append(status_text(make_reversible_status(id))).append(post_separator);
+		return expected;
+	};
+
+	GIVEN("An account with a home timeline in a .list file.")
+	{
+		{
+			post_list<mastodon_status> list{ user_dir / "home.list" };
+			for (int id = 1; id <= 50; id++)
+				list.write(make_reversible_status(id));
+		}
+
+		WHEN("the last few posts are shown.")
+		{
+			std::ostringstream out;
+			show_posts(account.second, to_get::home, 5, out);
+
+			THEN("they're printed the same as the end of the file, oldest first.")
+			{
+				REQUIRE(out.str() == expected_tail(46, 50));
+				REQUIRE(read_file(user_dir / "home.list").substr(read_file(user_dir / "home.list").size() - out.str().size()) == out.str());
+			}
+		}
+
+		WHEN("more posts are asked for than there are.")
+		{
+			std::ostringstream out;
+			show_posts(account.second, to_get::home, 500, out);
+
+			THEN("the whole file is printed.")
+			{
+				REQUIRE(out.str() == read_file(user_dir / "home.list"));
+			}
+		}
+
+		WHEN("all of the posts are shown.")
+		{
+			std::ostringstream out;
+			show_all_posts(account.second, to_get::home, out);
+
+			THEN("the whole file is printed.")
+			{
+				REQUIRE(out.str() == read_file(user_dir / "home.list"));
+				REQUIRE(out.str() == expected_tail(1, 50));
+			}
+		}
+
+		WHEN("all of a timeline with no file is shown.")
+		{
+			std::ostringstream out;
+			show_all_posts(account.second, to_get::bookmarks, out);
+
+			THEN("nothing is printed.")
+			{
+				REQUIRE(out.str().empty());
+				REQUIRE(out.good());
+			}
+		}
+
+		WHEN("a timeline with no file is shown.")
+		{
+			std::ostringstream out;
+			show_posts(account.second, to_get::bookmarks, 5, out);
+
+			THEN("nothing is printed.")
+			{
+				REQUIRE(out.str().empty());
+			}
+		}
+	}
+
+	GIVEN("An account that saves posts to a post store.")
+	{
+		account.second.set_bool_option(user_option::post_store, true);
+		{
+			post_store<mastodon_status> store{ user_dir / "home.store" };
+			for (int id = 1; id <= 50; id++)
+				store.write(make_reversible_status(id));
+		}
+
+		WHEN("the last few posts are shown.")
+		{
+			std::ostringstream out;
+			show_posts(account.second, to_get::home, 5, out);
+
+			THEN("they come out of the store the same way they would have from a .list file.")
+			{
+				REQUIRE(out.str() == expected_tail(46, 50));
+			}
+		}
+
+		WHEN("all of the posts are shown.")
+		{
+			std::ostringstream out;
+			show_all_posts(account.second, to_get::home, out);
+
+			THEN("every post comes out of the store, the same as the .list file would have been.")
+			{
+				REQUIRE(out.str() == expected_tail(1, 50));
+			}
+		}
+	}
+}
@@ -17,8 +17,14 @@
 #include <utility>
 #include <algorithm>
 #include <initializer_list>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
 #include <print_logger.hpp>
 
+#include <nlohmann/json.hpp>
+
 struct id_mock_args : public basic_mock_args
 {
 	std::string id;
@@ -39,6 +45,7 @@ struct mock_network_post : public mock_network
 		if (succeed_after == 0) { succeed_after = succeed_after_n; }
 		toreturn.okay = !(fatal_error || toreturn.retryable_error);
 		toreturn.status_code = status_code;
+		toreturn.timing.request_bytes = 150;
 		if (!toreturn.okay)
 			toreturn.message = R"({ "error": "some problem" })";
 		return toreturn;
@@ -327,6 +334,8 @@ SCENARIO("Send correctly sends from and modifies the queue with favs and boosts.
 
 			auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
 
+			sync_stats stats;
+			send.stats = &stats;
 			send.retries = retries.first;
 
 			send.send(account, instanceurl, accesstoken);
@@ -341,6 +350,22 @@ SCENARIO("Send correctly sends from and modifies the queue with favs and boosts.
 				REQUIRE(mockpost.arguments.size() == testvect.size() * retries.second);
 			}
 
+			THEN("every try is counted toward that kind of call.")
+			{
+				if (testvect.empty())
+				{
+					REQUIRE(stats.empty());
+				}
+				else
+				{
+					const auto parsed = nlohmann::json::parse(stats.to_json(0));
+					const auto& calls = parsed["accounts"]["someguy@cool.account"]["send"][std::string{ print_route(std::get<0>(queue)) }];
+					REQUIRE(calls["requests"] == testvect.size() * retries.second);
+					REQUIRE(calls["sent_bytes"] == testvect.size() * retries.second * 150);
+					REQUIRE(calls["posts"] == testvect.size());
+				}
+			}
+
 			THEN("the access token was passed in.")
 			{
 				REQUIRE(std::all_of(mockpost.arguments.begin(), mockpost.arguments.end(), [&](const auto& actual) { return actual.access_token == accesstoken; }));
@@ -535,8 +560,8 @@ SCENARIO("Send correctly sends new posts and deletes existing ones.", "[locale]"
 			{
 				REQUIRE(print(account).empty());
 
-				// it'll leave the .bak files behind
-				REQUIRE(count_files_in_directory(queue_directory) == 4);
+				// it'll leave the .bak files behind, but only for the posts that were changed when they were queued
+				REQUIRE(count_files_in_directory(queue_directory) == 2);
 			}
 
 			THEN("the input files and attachments are untouched")
@@ -629,8 +654,8 @@ SCENARIO("Send correctly sends new posts and deletes existing ones.", "[locale]"
 			{
 				REQUIRE(print(account) == std::vector<std::string>{ "POST second.post", "POST another kind of post" });
 
-				// 4 bak files, 2 regular
-				REQUIRE(count_files_in_directory(queue_directory) == 6);
+				// 3 bak files, 2 regular
+				REQUIRE(count_files_in_directory(queue_directory) == 5);
 			}
 
 			THEN("the input files and attachments are untouched")
@@ -714,6 +739,27 @@ SCENARIO("Send correctly sends new posts and deletes existing ones.", "[locale]"
 
 		}
 
+		WHEN("one of the threaded posts is turned down by the server")
+		{
+			mocknew.fail_if_body = "This one has a body, too.";
+			mocknew.status_code = 422;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the reply to it doesn't get sent either.")
+			{
+				REQUIRE(mocknew.arguments.size() == 3);
+			}
+
+			THEN("both of them go to the failed queue, instead of the reply being tried over and over.")
+			{
+				REQUIRE(print(account).empty());
+				REQUIRE(print_failed(account) == std::vector<std::string>{
+					"POST second.post (rejected after 1 attempt)",
+					"POST another kind of post (rejected after 1 attempt)" });
+			}
+		}
+
 		WHEN("the posts are sent over a bad or no connection")
 		{
 			mocknew.fatal_error = true;
@@ -728,8 +774,8 @@ SCENARIO("Send correctly sends new posts and deletes existing ones.", "[locale]"
 			{
 				REQUIRE(print(account) == make_expected_ids(expected_files, "POST "));
 
-				// queueing the posts makes a .bak file for them
-				REQUIRE(count_files_in_directory(queue_directory) == 8);
+				// queueing the posts makes a .bak file for the ones it changed
+				REQUIRE(count_files_in_directory(queue_directory) == 6);
 			}
 
 			THEN("the input files and attachments are untouched")
@@ -807,8 +853,8 @@ SCENARIO("Send correctly sends new posts and deletes existing ones.", "[locale]"
 			{
 				REQUIRE(print(account).empty());
 
-				// queueing the posts makes a .bak file for them
-				REQUIRE(count_files_in_directory(queue_directory) == 4);
+				// queueing the posts makes a .bak file for the ones it changed
+				REQUIRE(count_files_in_directory(queue_directory) == 2);
 			}
 
 			THEN("the input files and attachments are untouched")
@@ -1073,6 +1119,891 @@ SCENARIO("Send correctly sends from and modifies a queue of mixed API calls.")
 	}
 }
 
+struct locked_mock_network_post
+{
+	std::mutex lock;
+	std::vector<std::string> urls;
+	int failure_status = 500;
+
+	net_response operator()(std::string_view url, std::string_view)
+	{
+		net_response toreturn;
+		toreturn.okay = url.find("fail") == std::string_view::npos;
+		toreturn.status_code = toreturn.okay ? 200 : failure_status;
+		if (!toreturn.okay)
+			toreturn.message = R"({ "error": "some problem" })";
+
+		const std::lock_guard<std::mutex> guard{ lock };
+		urls.emplace_back(url);
+		return toreturn;
+	}
+};
+
+SCENARIO("Send skips queued calls that a later call undoes or repeats.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "changedmymind@cool.account";
+	fs::create_directory(account);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	GIVEN("A queue that changes its mind about some posts and fetches the same thread twice")
+	{
+		{
+			auto queued = get(account);
+			queued.parsed.push_back(api_call{ api_route::fav, "1" });
+			queued.parsed.push_back(api_call{ api_route::unfav, "1" });
+			queued.parsed.push_back(api_call{ api_route::fav, "1" });
+			queued.parsed.push_back(api_call{ api_route::boost, "2" });
+			queued.parsed.push_back(api_call{ api_route::unboost, "2" });
+			queued.parsed.push_back(api_call{ api_route::context, "3" });
+			queued.parsed.push_back(api_call{ api_route::fav, "4" });
+			queued.parsed.push_back(api_call{ api_route::context, "3" });
+			queued.parsed.push_back(api_call{ api_route::bookmark, "5" });
+		}
+
+		mock_network_post mockpost;
+		mock_network_delete mockdel;
+		mock_network_new_status mocknew;
+		mock_network_upload mockupload;
+		mock_network_context_get mockget;
+
+		auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+
+		const auto posted_urls = [&mockpost]()
+		{
+			std::vector<std::string> urls;
+			for (const auto& args : mockpost.arguments)
+				urls.push_back(args.url);
+			return urls;
+		};
+
+		WHEN("the queue is sent")
+		{
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("only the last call on each post is made, in the order they were queued.")
+			{
+				REQUIRE(posted_urls() == std::vector<std::string>{
+					make_expected_url("1", "/favourite", instanceurl),
+					make_expected_url("2", "/unreblog", instanceurl),
+					make_expected_url("4", "/favourite", instanceurl),
+					make_expected_url("5", "/bookmark", instanceurl) });
+			}
+
+			THEN("the thread is only fetched once.")
+			{
+				REQUIRE(mockget.arguments.size() == 2);
+			}
+
+			THEN("the queue is empty.")
+			{
+				REQUIRE(print(account).empty());
+			}
+		}
+
+		WHEN("the queue is sent and every post call fails")
+		{
+			mockpost.fatal_error = true;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("only the calls that were made are left in the queue.")
+			{
+				REQUIRE(print(account) == std::vector<std::string>{ "FAV 1", "UNBOOST 2", "FAV 4", "BOOKMARK 5" });
+			}
+		}
+
+		WHEN("the queue is sent literally")
+		{
+			send.literal_queue = true;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("every call is made, in order.")
+			{
+				REQUIRE(posted_urls() == std::vector<std::string>{
+					make_expected_url("1", "/favourite", instanceurl),
+					make_expected_url("1", "/unfavourite", instanceurl),
+					make_expected_url("1", "/favourite", instanceurl),
+					make_expected_url("2", "/reblog", instanceurl),
+					make_expected_url("2", "/unreblog", instanceurl),
+					make_expected_url("4", "/favourite", instanceurl),
+					make_expected_url("5", "/bookmark", instanceurl) });
+				REQUIRE(mockget.arguments.size() == 4);
+			}
+		}
+	}
+}
+
+SCENARIO("Send waits longer and longer to retry calls that keep failing, and gives up on ones the server won't accept.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "unlucky@cool.account";
+	fs::create_directory(account);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	// far enough in the future that it won't have come yet when the test runs
+	constexpr long long the_future = 4102444800;
+
+	GIVEN("A queue with a call that's waiting to be tried again, another call on the same post, a call that's done waiting, and a new call")
+	{
+		{
+			auto queued = get(account);
+			api_call waiting{ api_route::fav, "waiting" };
+			waiting.attempts = 1;
+			waiting.last_error = call_error::server;
+			waiting.not_before = the_future;
+			queued.parsed.push_back(std::move(waiting));
+
+			queued.parsed.push_back(api_call{ api_route::bookmark, "waiting" });
+
+			api_call done_waiting{ api_route::boost, "fail after waiting" };
+			done_waiting.attempts = 2;
+			done_waiting.last_error = call_error::network;
+			done_waiting.not_before = 1;
+			queued.parsed.push_back(std::move(done_waiting));
+
+			queued.parsed.push_back(api_call{ api_route::fav, "fail new" });
+		}
+
+		const unsigned int concurrency = GENERATE(1, 4);
+
+		locked_mock_network_post mockpost;
+		mock_network_delete mockdel;
+		mock_network_new_status mocknew;
+		mock_network_upload mockupload;
+		mock_network_context_get mockget;
+
+		auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+		send.concurrency = concurrency;
+
+		const auto read_queue = [&account]()
+		{
+			return readonly_queue_list{ account / Queue_Filename }.parsed;
+		};
+
+		WHEN("the queue is sent and the server has a problem")
+		{
+			mockpost.failure_status = 503;
+
+			const long long before = seconds_since_epoch();
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("only the calls that were done waiting were tried.")
+			{
+				auto urls = mockpost.urls;
+				std::sort(urls.begin(), urls.end());
+
+				REQUIRE(urls == std::vector<std::string>{
+					make_expected_url("fail after waiting", "/reblog", instanceurl),
+					make_expected_url("fail new", "/favourite", instanceurl) });
+			}
+
+			THEN("everything is still queued, in order.")
+			{
+				REQUIRE(print(account) == std::vector<std::string>{ "FAV waiting", "BOOKMARK waiting", "BOOST fail after waiting", "FAV fail new" });
+				REQUIRE(print_failed(account).empty());
+			}
+
+			THEN("the calls that failed wait twice as long as they did last time.")
+			{
+				const auto queue = read_queue();
+
+				REQUIRE(queue[0].attempts == 1);
+				REQUIRE(queue[0].not_before == the_future);
+
+				REQUIRE(queue[1].attempts == 0);
+				REQUIRE(queue[1].not_before == 0);
+
+				REQUIRE(queue[2].attempts == 3);
+				REQUIRE(queue[2].last_error == call_error::server);
+				REQUIRE(queue[2].not_before >= before + 20 * 60);
+				REQUIRE(queue[2].not_before <= seconds_since_epoch() + 20 * 60);
+
+				REQUIRE(queue[3].attempts == 1);
+				REQUIRE(queue[3].last_error == call_error::server);
+				REQUIRE(queue[3].not_before >= before + 5 * 60);
+				REQUIRE(queue[3].not_before <= seconds_since_epoch() + 5 * 60);
+			}
+		}
+
+		WHEN("the queue is sent and the server says the posts are gone")
+		{
+			mockpost.failure_status = 404;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the calls that were tried are taken out of the queue.")
+			{
+				REQUIRE(print(account) == std::vector<std::string>{ "FAV waiting", "BOOKMARK waiting" });
+			}
+
+			THEN("they're in the failed queue, with how they failed.")
+			{
+				REQUIRE(print_failed(account) == std::vector<std::string>{
+					"BOOST fail after waiting (rejected after 3 attempts)",
+					"FAV fail new (rejected after 1 attempt)" });
+			}
+
+			AND_WHEN("they're queued and fail again")
+			{
+				enqueue(api_route::fav, account, { "fail new" });
+				send.send(account, instanceurl, accesstoken);
+
+				THEN("they're only in the failed queue once.")
+				{
+					REQUIRE(print_failed(account) == std::vector<std::string>{
+						"BOOST fail after waiting (rejected after 3 attempts)",
+						"FAV fail new (rejected after 1 attempt)" });
+				}
+			}
+
+			AND_WHEN("the favs are cleared")
+			{
+				clear(api_route::fav, account);
+
+				THEN("they're cleared out of the failed queue, too.")
+				{
+					REQUIRE(print_failed(account) == std::vector<std::string>{ "BOOST fail after waiting (rejected after 3 attempts)" });
+				}
+			}
+		}
+
+		WHEN("the queue is sent and the server says the account isn't allowed to do anything")
+		{
+			mockpost.failure_status = GENERATE(401, 403);
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the calls after the first one that failed weren't sent.")
+			{
+				if (concurrency == 1)
+					REQUIRE(mockpost.urls == std::vector<std::string>{ make_expected_url("fail after waiting", "/reblog", instanceurl) });
+				else
+					REQUIRE_FALSE(mockpost.urls.empty());
+			}
+
+			THEN("everything stays queued just the way it was.")
+			{
+				REQUIRE(print(account) == std::vector<std::string>{ "FAV waiting", "BOOKMARK waiting", "BOOST fail after waiting", "FAV fail new" });
+				REQUIRE(print_failed(account).empty());
+
+				const auto queue = read_queue();
+				REQUIRE(queue[2].attempts == 2);
+				REQUIRE(queue[2].last_error == call_error::network);
+				REQUIRE(queue[3].attempts == 0);
+				REQUIRE(queue[3].last_error == call_error::none);
+			}
+		}
+
+		WHEN("the queue is sent and the server is rate limiting")
+		{
+			mockpost.failure_status = 429;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("nothing is given up on.")
+			{
+				REQUIRE(print(account) == std::vector<std::string>{ "FAV waiting", "BOOKMARK waiting", "BOOST fail after waiting", "FAV fail new" });
+				REQUIRE(read_queue()[3].last_error == call_error::rate_limited);
+			}
+		}
+	}
+}
+
+SCENARIO("Send holds replies to posts that haven't been sent yet.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "patient@cool.account";
+	fs::create_directories(account / File_Queue_Directory);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	constexpr long long the_future = 4102444800;
+
+	const auto make_post = [&](const char* name, const char* reply_id, const char* reply_to_id)
+	{
+		const fs::path post_file = testdir.dirname / name;
+		{
+			outgoing_post post{ post_file };
+			post.parsed.text = name;
+			post.parsed.reply_id = reply_id;
+			post.parsed.reply_to_id = reply_to_id;
+		}
+		enqueue(api_route::post, account, { post_file.string() });
+	};
+
+	GIVEN("A queued post, a reply to it, a reply to that, and an unrelated post")
+	{
+		make_post("parent.post", "held parent", "");
+		make_post("reply.post", "held reply", "held parent");
+		make_post("reply to reply.post", "", "held reply");
+		make_post("unrelated.post", "", "");
+
+		mock_network_post mockpost;
+		mock_network_delete mockdel;
+		mock_network_new_status mocknew;
+		mock_network_upload mockupload;
+		mock_network_context_get mockget;
+
+		auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+		send.concurrency = GENERATE(1, 4);
+
+		const auto sent_bodies = [&mocknew]()
+		{
+			std::vector<std::string> bodies;
+			for (const auto& args : mocknew.arguments)
+				bodies.push_back(args.params.body);
+			return bodies;
+		};
+
+		const auto check_replies_waited = [&account]()
+		{
+			const auto queue = readonly_queue_list{ account / Queue_Filename }.parsed;
+			REQUIRE(print(account) == std::vector<std::string>{ "POST parent.post", "POST reply.post", "POST reply to reply.post" });
+			REQUIRE(print_failed(account).empty());
+			REQUIRE(queue[1].attempts == 0);
+			REQUIRE(queue[2].attempts == 0);
+		};
+
+		WHEN("the first post is waiting to be tried again")
+		{
+			{
+				auto queued = get(account);
+				queued.parsed[0].attempts = 1;
+				queued.parsed[0].last_error = call_error::server;
+				queued.parsed[0].not_before = the_future;
+			}
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the replies wait with it, and only the unrelated post is sent.")
+			{
+				REQUIRE(sent_bodies() == std::vector<std::string>{ "unrelated.post" });
+				check_replies_waited();
+			}
+		}
+
+		WHEN("the first post fails in a way that's worth trying again")
+		{
+			mocknew.fail_if_body = "parent.post";
+			mocknew.status_code = 503;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the replies aren't sent, and they don't count as failing.")
+			{
+				REQUIRE(sent_bodies() == std::vector<std::string>{ "parent.post", "unrelated.post" });
+				check_replies_waited();
+			}
+		}
+	}
+}
+
+// acts like someone pressed Ctrl-C while the first call was being sent.
+struct interrupting_mock_network_post
+{
+	std::mutex lock;
+	std::vector<std::string> urls;
+
+	net_response operator()(std::string_view url, std::string_view)
+	{
+		stop_requested = true;
+
+		net_response toreturn;
+		toreturn.status_code = 200;
+
+		const std::lock_guard<std::mutex> guard{ lock };
+		urls.emplace_back(url);
+		return toreturn;
+	}
+};
+
+SCENARIO("Send stops early and leaves the rest of the queue alone when it's asked to stop.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "impatient@cool.account";
+	fs::create_directory(account);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	GIVEN("A queue of favs on different posts")
+	{
+		enqueue(api_route::fav, account, { "1", "2", "3", "4", "5" });
+
+		const unsigned int concurrency = GENERATE(1, 2);
+
+		interrupting_mock_network_post mockpost;
+		mock_network_delete mockdel;
+		mock_network_new_status mocknew;
+		mock_network_upload mockupload;
+		mock_network_context_get mockget;
+
+		auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+		send.concurrency = concurrency;
+
+		WHEN("a stop is requested while the first call is being sent")
+		{
+			send.send(account, instanceurl, accesstoken);
+			stop_requested = false;
+
+			THEN("the calls that were sent are taken out of the queue, and the rest are still queued, in order.")
+			{
+				REQUIRE_FALSE(mockpost.urls.empty());
+				REQUIRE(mockpost.urls.size() <= concurrency);
+
+				std::vector<std::string> expected;
+				for (const auto id : { "1", "2", "3", "4", "5" })
+				{
+					if (std::find(mockpost.urls.begin(), mockpost.urls.end(), make_expected_url(id, "/favourite", instanceurl)) == mockpost.urls.end())
+						expected.push_back(std::string{ "FAV " } + id);
+				}
+
+				REQUIRE(print(account) == expected);
+				REQUIRE(print_failed(account).empty());
+			}
+		}
+	}
+}
+
+SCENARIO("Send reuses attachments that were already uploaded when a post has to be tried again.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "uploader@cool.account";
+	fs::create_directories(account / File_Queue_Directory);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	const fs::path picture = testdir.dirname / "picture.png";
+	const fs::path video = testdir.dirname / "video.mp4";
+	const auto write_attachment = [](const fs::path& file, std::string_view contents)
+	{
+		std::ofstream of{ file.c_str(), std::ios::binary };
+		of << contents;
+	};
+	write_attachment(picture, "pretend this is a picture");
+	write_attachment(video, "and this is a really big video");
+
+	const auto make_post = [&](const char* name, std::vector<std::string> attachments, std::vector<std::string> descriptions)
+	{
+		const fs::path post_file = testdir.dirname / name;
+		{
+			outgoing_post post{ post_file };
+			post.parsed.text = name;
+			post.parsed.attachments = std::move(attachments);
+			post.parsed.descriptions = std::move(descriptions);
+		}
+		enqueue(api_route::post, account, { post_file.string() });
+	};
+
+	const auto cached_uploads = [&account]()
+	{
+		return media_cache_file{ account / Media_Cache_Filename }.parsed.size();
+	};
+
+	mock_network_post mockpost;
+	mock_network_delete mockdel;
+	mock_network_new_status mocknew;
+	mock_network_upload mockupload;
+	mock_network_context_get mockget;
+
+	auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+
+	GIVEN("A queued post with two attachments")
+	{
+		make_post("attachments.post", { picture.string(), video.string() }, { "a nice picture", "a long video" });
+
+		WHEN("the attachments upload, but the post itself fails")
+		{
+			mocknew.fatal_error = true;
+			mocknew.status_code = 500;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("both attachments were uploaded, and they're remembered.")
+			{
+				REQUIRE(mockupload.arguments.size() == 2);
+				REQUIRE(mocknew.arguments.size() == 1);
+				REQUIRE(cached_uploads() == 2);
+				REQUIRE(print(account) == std::vector<std::string>{ "POST attachments.post" });
+			}
+
+			AND_WHEN("it's sent again after the server is back up")
+			{
+				{
+					auto queued = get(account);
+					queued.parsed.front().not_before = 0;
+				}
+
+				mocknew.fatal_error = false;
+				mocknew.status_code = 200;
+				send.send(account, instanceurl, accesstoken);
+
+				THEN("nothing was uploaded again, and the post uses the same media IDs.")
+				{
+					REQUIRE(mockupload.arguments.size() == 2);
+					REQUIRE(mocknew.arguments.size() == 2);
+					REQUIRE(mocknew.arguments[1].params.attachment_ids == std::vector<std::string>{ mockupload.arguments[0].id, mockupload.arguments[1].id });
+					REQUIRE(mocknew.arguments[1].params.attachment_ids == mocknew.arguments[0].params.attachment_ids);
+					REQUIRE(print(account).empty());
+				}
+
+				THEN("the uploads are forgotten, since they're attached to that post now.")
+				{
+					REQUIRE(cached_uploads() == 0);
+				}
+			}
+
+			AND_WHEN("the picture is changed before it's sent again")
+			{
+				{
+					auto queued = get(account);
+					queued.parsed.front().not_before = 0;
+				}
+				write_attachment(picture, "a different picture");
+
+				mocknew.fatal_error = false;
+				mocknew.status_code = 200;
+				send.send(account, instanceurl, accesstoken);
+
+				THEN("only the picture is uploaded again.")
+				{
+					REQUIRE(mockupload.arguments.size() == 3);
+					REQUIRE(mockupload.arguments[2].attachment_args.file == picture);
+					REQUIRE(mocknew.arguments[1].params.attachment_ids == std::vector<std::string>{ mockupload.arguments[2].id, mockupload.arguments[1].id });
+				}
+			}
+		}
+
+		WHEN("the server won't take the post")
+		{
+			mocknew.fatal_error = true;
+			mocknew.status_code = 422;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the uploads are forgotten, in case they were the problem.")
+			{
+				REQUIRE(mockupload.arguments.size() == 2);
+				REQUIRE(cached_uploads() == 0);
+				REQUIRE(print_failed(account) == std::vector<std::string>{ "POST attachments.post (rejected after 1 attempt)" });
+			}
+		}
+
+		WHEN("a second post has the same picture with a different description, and the same video twice with the same one")
+		{
+			make_post("more attachments.post", { picture.string(), video.string(), video.string() }, { "the same picture", "a long video", "a long video" });
+
+			mocknew.fail_if_body = "attachments.post";
+			mocknew.status_code = 500;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the second post only reuses the video once, since a post can't have the same media twice.")
+			{
+				REQUIRE(mockupload.arguments.size() == 4);
+				REQUIRE(mockupload.arguments[2].attachment_args.description == "the same picture");
+				REQUIRE(mockupload.arguments[3].attachment_args.file == video);
+
+				REQUIRE(mocknew.arguments.size() == 2);
+				REQUIRE(mocknew.arguments[1].params.attachment_ids == std::vector<std::string>{ mockupload.arguments[2].id, mockupload.arguments[1].id, mockupload.arguments[3].id });
+				REQUIRE(print(account) == std::vector<std::string>{ "POST attachments.post" });
+			}
+		}
+	}
+}
+
+struct locked_mock_network_upload
+{
+	std::mutex lock;
+	std::condition_variable started;
+	std::vector<fs::path> uploaded;
+	std::vector<std::string> descriptions;
+	std::string fail_file;
+
+	// each upload waits (for a little while, anyways) until this many are going at once, so the test can tell they really were
+	size_t wait_for_at_once = 0;
+	size_t arrived = 0;
+	size_t in_flight = 0;
+	size_t most_at_once = 0;
+
+	net_response operator()(std::string_view, std::string_view, const fs::path& file, const std::string& description)
+	{
+		std::unique_lock<std::mutex> guard{ lock };
+		most_at_once = std::max(most_at_once, ++in_flight);
+		arrived++;
+		started.notify_all();
+		started.wait_for(guard, std::chrono::seconds(5), [this]() { return arrived >= wait_for_at_once; });
+		in_flight--;
+
+		net_response toreturn;
+		toreturn.okay = file.filename() != fail_file;
+		toreturn.status_code = toreturn.okay ? 200 : 500;
+		if (toreturn.okay)
+		{
+			toreturn.message = R"({"id": "id-)" + file.filename().string() + "\"}";
+			uploaded.push_back(file);
+			descriptions.push_back(description);
+		}
+		return toreturn;
+	}
+};
+
+SCENARIO("Send uploads a post's attachments at the same time and keeps them in order.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "photographer@cool.account";
+	fs::create_directories(account / File_Queue_Directory);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	const std::vector<std::string> names{ "first.png", "second.png", "third.png", "fourth.png" };
+	const std::vector<std::string> descriptions{ "one", "two", "three", "four" };
+	std::vector<std::string> attachments;
+	for (const auto& name : names)
+	{
+		const fs::path file = testdir.dirname / name;
+		std::ofstream of{ file.c_str(), std::ios::binary };
+		of << "the picture in " << name;
+		attachments.push_back(file.string());
+	}
+
+	{
+		const fs::path post_file = testdir.dirname / "gallery.post";
+		{
+			outgoing_post post{ post_file };
+			post.parsed.text = "look at all these pictures";
+			post.parsed.attachments = attachments;
+			post.parsed.descriptions = descriptions;
+		}
+		enqueue(api_route::post, account, { post_file.string() });
+	}
+
+	const unsigned int concurrency = GENERATE(1, 4);
+
+	mock_network_post mockpost;
+	mock_network_delete mockdel;
+	mock_network_new_status mocknew;
+	locked_mock_network_upload mockupload;
+	mock_network_context_get mockget;
+
+	auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+	send.concurrency = concurrency;
+
+	const auto expected_ids = std::vector<std::string>{ "id-first.png", "id-second.png", "id-third.png", "id-fourth.png" };
+
+	GIVEN("A post with four attachments")
+	{
+		WHEN("it's sent")
+		{
+			mockupload.wait_for_at_once = concurrency;
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the attachments were uploaded as many at a time as the concurrency allows.")
+			{
+				REQUIRE(mockupload.uploaded.size() == 4);
+				REQUIRE(mockupload.most_at_once == concurrency);
+			}
+
+			THEN("each file was uploaded with its own description.")
+			{
+				for (size_t i = 0; i < mockupload.uploaded.size(); i++)
+				{
+					const auto found = std::find(attachments.begin(), attachments.end(), mockupload.uploaded[i].string());
+					REQUIRE(found != attachments.end());
+					REQUIRE(mockupload.descriptions[i] == descriptions[found - attachments.begin()]);
+				}
+			}
+
+			THEN("the post has the media in the same order the attachments were in.")
+			{
+				REQUIRE(mocknew.arguments.size() == 1);
+				REQUIRE(mocknew.arguments[0].params.attachment_ids == expected_ids);
+				REQUIRE(print(account).empty());
+			}
+		}
+
+		WHEN("one of the uploads fails")
+		{
+			mockupload.fail_file = "third.png";
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("the post is skipped and stays queued.")
+			{
+				REQUIRE(mocknew.arguments.empty());
+				REQUIRE(print(account) == std::vector<std::string>{ "POST gallery.post" });
+			}
+
+			THEN("the uploads that did go through are remembered.")
+			{
+				REQUIRE(media_cache_file{ account / Media_Cache_Filename }.parsed.size() == mockupload.uploaded.size());
+			}
+
+			AND_WHEN("it's sent again and the upload works this time")
+			{
+				{
+					auto queued = get(account);
+					queued.parsed.front().not_before = 0;
+				}
+
+				mockupload.fail_file.clear();
+				send.send(account, instanceurl, accesstoken);
+
+				THEN("each attachment was only uploaded once, and the post has them in order.")
+				{
+					auto uploaded = mockupload.uploaded;
+					std::sort(uploaded.begin(), uploaded.end());
+					REQUIRE(std::unique(uploaded.begin(), uploaded.end()) == uploaded.end());
+					REQUIRE(uploaded.size() == 4);
+
+					REQUIRE(mocknew.arguments.size() == 1);
+					REQUIRE(mocknew.arguments[0].params.attachment_ids == expected_ids);
+					REQUIRE(print(account).empty());
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Send can make independent calls concurrently while keeping dependent calls in order.")
+{
+	logs_off = true;
+
+	const test_dir testdir = temporary_directory();
+	const fs::path account = testdir.dirname / "someguy@cool.account";
+	fs::create_directory(account);
+
+	constexpr std::string_view instanceurl = "cool.account";
+	constexpr std::string_view accesstoken = "sometoken";
+
+	GIVEN("A queue with a mix of favs, boosts, and unboosts of the same posts, some of which will fail")
+	{
+		std::vector<std::string> expected_failures;
+		{
+			auto queued = get(account);
+			for (int i = 0; i < 50; i++)
+			{
+				const auto id = std::to_string(i);
+				const std::string fail_id = "fail" + id;
+				queued.parsed.push_back(api_call{ api_route::boost, id });
+				queued.parsed.push_back(api_call{ api_route::fav, fail_id });
+				queued.parsed.push_back(api_call{ api_route::unboost, id });
+				queued.parsed.push_back(api_call{ api_route::bookmark, fail_id });
+				expected_failures.push_back("FAV " + fail_id);
+				expected_failures.push_back("BOOKMARK " + fail_id);
+			}
+		}
+
+		WHEN("the queue is sent concurrently")
+		{
+			const unsigned int concurrency = GENERATE(2, 4, 16);
+
+			locked_mock_network_post mockpost;
+			mock_network_delete mockdel;
+			mock_network_new_status mocknew;
+			mock_network_upload mockupload;
+			mock_network_context_get mockget;
+
+			auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+			send.concurrency = concurrency;
+			send.literal_queue = true;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("every call was made exactly once.")
+			{
+				REQUIRE(mockpost.urls.size() == 200);
+				std::sort(mockpost.urls.begin(), mockpost.urls.end());
+				REQUIRE(std::adjacent_find(mockpost.urls.begin(), mockpost.urls.end()) == mockpost.urls.end());
+			}
+
+			THEN("each boost happened before the unboost of the same post.")
+			{
+				for (int i = 0; i < 50; i++)
+				{
+					const auto id = std::to_string(i);
+					const auto boost = std::find(mockpost.urls.begin(), mockpost.urls.end(), make_expected_url(id, "/reblog", instanceurl));
+					const auto unboost = std::find(mockpost.urls.begin(), mockpost.urls.end(), make_expected_url(id, "/unreblog", instanceurl));
+					REQUIRE(boost != mockpost.urls.end());
+					REQUIRE(unboost != mockpost.urls.end());
+					REQUIRE(boost < unboost);
+				}
+			}
+
+			THEN("the failed calls are back in the queue in their original order.")
+			{
+				REQUIRE(print(account) == expected_failures);
+			}
+
+			THEN("only the post function was called.")
+			{
+				REQUIRE(mockdel.arguments.empty());
+				REQUIRE(mocknew.arguments.empty());
+				REQUIRE(mockupload.arguments.empty());
+				REQUIRE(mockget.arguments.empty());
+			}
+		}
+	}
+
+	GIVEN("A queue of favs and only enough data left for one call")
+	{
+		std::vector<std::string> expected_left;
+		{
+			auto queued = get(account);
+			for (int i = 0; i < 10; i++)
+			{
+				queued.parsed.push_back(api_call{ api_route::fav, std::to_string(i) });
+				if (i > 0)
+					expected_left.push_back("FAV " + std::to_string(i));
+			}
+		}
+
+		WHEN("the queue is sent")
+		{
+			const unsigned int concurrency = GENERATE(1, 4);
+
+			locked_mock_network_post mockpost;
+			mock_network_delete mockdel;
+			mock_network_new_status mocknew;
+			mock_network_upload mockupload;
+			mock_network_context_get mockget;
+
+			byte_budget budget{ 1 };
+			auto send = send_posts{ mockpost, mockdel, mocknew, mockupload, mockget };
+			send.concurrency = concurrency;
+			send.budget = &budget;
+
+			send.send(account, instanceurl, accesstoken);
+
+			THEN("only the first call was made.")
+			{
+				REQUIRE(mockpost.urls.size() == 1);
+				REQUIRE(mockpost.urls[0] == make_expected_url("0", "/favourite", instanceurl));
+			}
+
+			THEN("the rest are still queued, in order.")
+			{
+				REQUIRE(print(account) == expected_left);
+			}
+		}
+	}
+}
+
 SCENARIO("read_params doesn't repeat idempotency keys or mutate the post file.")
 {
 	const test_file fi = temporary_file();
@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include "test_helpers.hpp"
+
+#include "../lib/sync/spill_buffer.hpp"
+#include "../lib/entities/entities.hpp"
+
+#include <string>
+#include <vector>
+
+struct collecting_writer
+{
+	std::vector<mastodon_status> written;
+	template <typename iterator>
+	void write(iterator first, iterator last) { written.insert(written.end(), first, last); }
+};
+
+// a page of statuses, newest first, like they come back from the API
+std::vector<mastodon_status> make_spill_page(int newest_id, int count)
+{
+	std::vector<mastodon_status> page(count);
+	for (int i = 0; i < count; i++)
+	{
+		page[i].id = std::to_string(newest_id - i);
+		page[i].content = "post " + page[i].id;
+		page[i].author.account_name = "someone@website.egg";
+	}
+	return page;
+}
+
+SCENARIO("spill_buffer hands back posts oldest first, whether or not they were spilled to disk.")
+{
+	const test_dir testdir = temporary_directory();
+	const fs::path spill_base = testdir.dirname / "home.list";
+
+	GIVEN("Ten pages of ten posts each, newest first.")
+	{
+		const size_t max_posts = GENERATE(1, 10, 15, 35, 100, 1000);
+		collecting_writer writer;
+
+		{
+			spill_buffer<mastodon_status> buffer{ spill_base, max_posts };
+			for (int page = 0; page < 10; page++)
+			{
+				auto posts = make_spill_page(1000 - page * 10, 10);
+				buffer.add(posts);
+			}
+
+			THEN("they're all counted, and the newest ID is the first one added.")
+			{
+				REQUIRE(buffer.size() == 100);
+				REQUIRE(buffer.newest_id() == "1000");
+			}
+
+			THEN("they only spill once there are too many to hold.")
+			{
+				REQUIRE(buffer.spilled() == (max_posts > 100 ? 0 : 100 / ((max_posts + 9) / 10 * 10)));
+			}
+
+			buffer.write_oldest_first(writer);
+		}
+
+		THEN("every post comes out, oldest first, with everything intact.")
+		{
+			REQUIRE(writer.written.size() == 100);
+			for (int i = 0; i < 100; i++)
+			{
+				REQUIRE(writer.written[i].id == std::to_string(901 + i));
+				REQUIRE(writer.written[i].content == "post " + writer.written[i].id);
+				REQUIRE(writer.written[i].author.account_name == "someone@website.egg");
+			}
+		}
+
+		THEN("the spill files are gone.")
+		{
+			REQUIRE(fs::is_empty(testdir.dirname));
+		}
+	}
+}
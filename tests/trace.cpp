@@ -0,0 +1,130 @@
+#include <catch2/catch.hpp>
+
+#include "../lib/trace/trace.hpp"
+
+#include "test_helpers.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+const nlohmann::json* find_event(const nlohmann::json& trace, const std::string_view name)
+{
+	for (const auto& event : trace["traceEvents"])
+	{
+		if (event["name"].get<std::string>() == name)
+			return &event;
+	}
+	return nullptr;
+}
+
+SCENARIO("trace_args renders its arguments as JSON.")
+{
+	GIVEN("Some numbers and strings, including ones that need escaping.")
+	{
+		trace_args args;
+		args.add("count", 12).add("negative", -1).add("url", "https://cool.account/\"quoted\"\\path\n");
+
+		THEN("the arguments are valid JSON with the same values.")
+		{
+			const auto parsed = nlohmann::json::parse('{' + args.json + '}');
+			REQUIRE(parsed["count"] == 12);
+			REQUIRE(parsed["negative"] == -1);
+			REQUIRE(parsed["url"] == "https://cool.account/\"quoted\"\\path\n");
+		}
+	}
+}
+
+SCENARIO("Traces are only recorded after start_trace, and written by finish_trace.")
+{
+	const test_file file = temporary_file();
+
+	GIVEN("Tracing hasn't been started.")
+	{
+		REQUIRE_FALSE(trace_enabled());
+
+		WHEN("events are recorded and the trace is finished.")
+		{
+			{
+				trace_scope scope{ "ignored", "test" };
+			}
+			trace_event("also ignored", "test", std::chrono::steady_clock::now(), 1ms);
+			finish_trace();
+
+			THEN("no file is written.")
+			{
+				REQUIRE_FALSE(fs::exists(file.filename()));
+			}
+		}
+	}
+
+	GIVEN("Tracing has been started.")
+	{
+		start_trace(file.filename());
+		REQUIRE(trace_enabled());
+
+		WHEN("some events are recorded and the trace is finished.")
+		{
+			const auto start = std::chrono::steady_clock::now();
+			trace_event("GET https://cool.account/api/v1/timelines/home", "net", start, 1500us, trace_args{}.add("status", 200).add("wire_bytes", 1234));
+
+			{
+				trace_scope parsing{ "parse page", "cpu", "clean_us" };
+				parsing.args.add("posts", 40);
+				for (int i = 0; i < 3; i++)
+				{
+					const trace_tally cleaning;
+					std::this_thread::sleep_for(2ms);
+				}
+			}
+
+			std::thread{ []() { trace_event("on another thread", "test", std::chrono::steady_clock::now(), 0us); } }.join();
+
+			finish_trace();
+
+			THEN("tracing is turned back off.")
+			{
+				REQUIRE_FALSE(trace_enabled());
+			}
+
+			THEN("the file is a valid Chrome trace with every event in it.")
+			{
+				const auto trace = nlohmann::json::parse(read_file(file.filename()));
+				REQUIRE(trace["traceEvents"].size() == 3);
+
+				for (const auto& event : trace["traceEvents"])
+				{
+					REQUIRE(event["ph"] == "X");
+					REQUIRE(event["pid"] == 1);
+					REQUIRE(event["ts"].get<long long>() >= 0);
+					REQUIRE(event["dur"].get<long long>() >= 0);
+				}
+
+				const auto request = find_event(trace, "GET https://cool.account/api/v1/timelines/home");
+				REQUIRE(request != nullptr);
+				REQUIRE((*request)["cat"] == "net");
+				REQUIRE((*request)["dur"] == 1500);
+				REQUIRE((*request)["args"]["status"] == 200);
+				REQUIRE((*request)["args"]["wire_bytes"] == 1234);
+
+				const auto parsing = find_event(trace, "parse page");
+				REQUIRE(parsing != nullptr);
+				REQUIRE((*parsing)["cat"] == "cpu");
+				REQUIRE((*parsing)["args"]["posts"] == 40);
+				REQUIRE((*parsing)["args"]["cpu_us"].get<long long>() >= 0);
+				REQUIRE((*parsing)["args"]["clean_us"].get<long long>() >= 6000);
+				REQUIRE((*parsing)["dur"].get<long long>() >= (*parsing)["args"]["clean_us"].get<long long>());
+
+				const auto other_thread = find_event(trace, "on another thread");
+				REQUIRE(other_thread != nullptr);
+				REQUIRE((*other_thread)["tid"] != (*request)["tid"]);
+			}
+		}
+
+		finish_trace();
+	}
+}
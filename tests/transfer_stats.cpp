@@ -0,0 +1,166 @@
+#include <catch2/catch.hpp>
+
+#include "../lib/sync/transfer_stats.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <sstream>
+#include <string>
+
+transfer_timing make_transfer_timing(long long request, long long sent, long long headers, long long wire, long long body)
+{
+	transfer_timing timing;
+	timing.request_bytes = request;
+	timing.sent_bytes = sent;
+	timing.header_bytes = headers;
+	timing.wire_bytes = wire;
+	timing.body_bytes = body;
+	return timing;
+}
+
+SCENARIO("transfer_totals adds up what each request moved.")
+{
+	GIVEN("Some empty totals.")
+	{
+		transfer_totals totals;
+
+		WHEN("a small request with a compressed response is added.")
+		{
+			totals.add(make_transfer_timing(300, 50, 400, 1000, 4000));
+
+			THEN("the headers count toward what was sent and received, and the body isn't counted twice.")
+			{
+				REQUIRE(totals.requests == 1);
+				REQUIRE(totals.sent_bytes == 300);
+				REQUIRE(totals.received_bytes == 1400);
+				REQUIRE(totals.decoded_bytes == 4000);
+			}
+		}
+
+		WHEN("a big upload is added.")
+		{
+			totals.add(make_transfer_timing(500, 2000000, 400, 600, 600));
+
+			THEN("the body is what was sent.")
+			{
+				REQUIRE(totals.sent_bytes == 2000000);
+			}
+		}
+
+		WHEN("a request that curl didn't report anything about is added.")
+		{
+			totals.add(transfer_timing{});
+
+			THEN("it counts as a request that didn't move anything.")
+			{
+				REQUIRE(totals.requests == 1);
+				REQUIRE(totals.sent_bytes == 0);
+				REQUIRE(totals.received_bytes == 0);
+				REQUIRE(totals.decoded_bytes == 0);
+			}
+		}
+
+		WHEN("two sets of totals are added together.")
+		{
+			totals.add(make_transfer_timing(100, 0, 100, 100, 100));
+			totals.posts = 3;
+
+			transfer_totals other;
+			other.add(make_transfer_timing(200, 0, 200, 200, 300));
+			other.posts = 4;
+
+			totals += other;
+
+			THEN("every count is added.")
+			{
+				REQUIRE(totals.requests == 2);
+				REQUIRE(totals.sent_bytes == 300);
+				REQUIRE(totals.received_bytes == 600);
+				REQUIRE(totals.decoded_bytes == 400);
+				REQUIRE(totals.posts == 7);
+			}
+		}
+	}
+}
+
+SCENARIO("format_bytes makes byte counts readable.")
+{
+	REQUIRE(format_bytes(0) == "0 bytes");
+	REQUIRE(format_bytes(1) == "1 byte");
+	REQUIRE(format_bytes(1023) == "1023 bytes");
+	REQUIRE(format_bytes(1024) == "1.0 KB");
+	REQUIRE(format_bytes(1536) == "1.5 KB");
+	REQUIRE(format_bytes(5 * 1024 * 1024) == "5.0 MB");
+	REQUIRE(format_bytes(3ull * 1024 * 1024 * 1024) == "3.0 GB");
+}
+
+SCENARIO("sync_stats collects totals by account, timeline, and queued call.")
+{
+	GIVEN("Stats from two accounts.")
+	{
+		sync_stats stats;
+		REQUIRE(stats.empty());
+
+		transfer_totals home;
+		home.add(make_transfer_timing(100, 0, 100, 900, 2048));
+		home.posts = 40;
+
+		transfer_totals fav;
+		fav.add(make_transfer_timing(150, 0, 100, 50, 50));
+		fav.posts = 1;
+
+		stats.add_timeline("first@website.egg", "home", home);
+		stats.add_timeline("first@website.egg", "home", home);
+		stats.add_send("first@website.egg", "FAV", fav);
+		stats.add_timeline("second@website.egg", "notifications", home);
+
+		THEN("it's not empty.")
+		{
+			REQUIRE_FALSE(stats.empty());
+		}
+
+		WHEN("they're turned into JSON.")
+		{
+			const auto parsed = nlohmann::json::parse(stats.to_json(1600000000));
+
+			THEN("each account has its timelines, its queued calls, and a total.")
+			{
+				const auto& first = parsed["accounts"]["first@website.egg"];
+				REQUIRE(first["timelines"]["home"]["requests"] == 2);
+				REQUIRE(first["timelines"]["home"]["posts"] == 80);
+				REQUIRE(first["timelines"]["home"]["decoded_bytes"] == 4096);
+				REQUIRE(first["send"]["FAV"]["sent_bytes"] == 150);
+				REQUIRE(first["total"]["requests"] == 3);
+				REQUIRE(first["total"]["received_bytes"] == 2000 + 150);
+
+				const auto& second = parsed["accounts"]["second@website.egg"];
+				REQUIRE(second["timelines"]["notifications"]["posts"] == 40);
+				REQUIRE(second["send"].empty());
+			}
+
+			THEN("the whole sync has a total and a time.")
+			{
+				REQUIRE(parsed["finished_at"] == 1600000000);
+				REQUIRE(parsed["total"]["requests"] == 4);
+				REQUIRE(parsed["total"]["posts"] == 121);
+			}
+		}
+
+		WHEN("they're printed.")
+		{
+			std::ostringstream out;
+			stats.print(out);
+
+			THEN("there's a line for each account, timeline, and queued call, and one for the total.")
+			{
+				REQUIRE(out.str() ==
+					"first@website.egg: 3 requests, 350 bytes sent, 2.1 KB received (4.0 KB decoded), 81 posts and calls\n"
+					"    home: 2 requests, 200 bytes sent, 2.0 KB received (4.0 KB decoded), 80 posts\n"
+					"    sent FAV: 1 request, 150 bytes sent, 150 bytes received (50 bytes decoded), 1 call\n"
+					"second@website.egg: 1 request, 100 bytes sent, 1000 bytes received (2.0 KB decoded), 40 posts and calls\n"
+					"    notifications: 1 request, 100 bytes sent, 1000 bytes received (2.0 KB decoded), 40 posts\n"
+					"Total: 4 requests, 450 bytes sent, 3.1 KB received (6.0 KB decoded), 121 posts and calls\n");
+			}
+		}
+	}
+}
@@ -252,10 +252,10 @@ SCENARIO("The boolean overload for get_option works.")
 	{
 		user_options opt{fi.filename()};
 
-		WHEN("one of the five boolean options is asked for.")
+		WHEN("one of the boolean options is asked for.")
 		{
 			const auto option = GENERATE(user_option::exclude_boosts, user_option::exclude_favs,
-				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls);
+				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls, user_option::post_store);
 
 			const auto result = opt.get_bool_option(option);
 
@@ -270,10 +270,10 @@ SCENARIO("The boolean overload for get_option works.")
 	{
 		user_options opt{fi.filename()};
 
-		WHEN("one of the five boolean options is set to 'true' or 'yes'.")
+		WHEN("one of the boolean options is set to 'true' or 'yes'.")
 		{
 			const auto option = GENERATE(user_option::exclude_boosts, user_option::exclude_favs,
-				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls);
+				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls, user_option::post_store);
 
 			const auto value = GENERATE(as<std::string>{}, "true", "True", "TRUE", "yes", "Yes", "YES", "Yeehaw", "yeehaw", "t", "T", "y", "Y");
 
@@ -286,10 +286,10 @@ SCENARIO("The boolean overload for get_option works.")
 			}
 		}
 
-		WHEN("one of the five boolean options is set to anything else")
+		WHEN("one of the boolean options is set to anything else")
 		{
 			const auto option = GENERATE(user_option::exclude_boosts, user_option::exclude_favs,
-				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls);
+				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls, user_option::post_store);
 
 			const auto value = GENERATE(as<std::string>{}, "false", "no", "knock it off", "", ":(", "No");
 
@@ -311,7 +311,7 @@ SCENARIO("The boolean overload for get_option works.")
 		WHEN("one of the options that have boolean settings is asked for.")
 		{
 			const auto option = GENERATE(user_option::exclude_boosts, user_option::exclude_favs,
-				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls);
+				user_option::exclude_follows, user_option::exclude_mentions, user_option::exclude_polls, user_option::post_store);
 
 			const auto result = opt.get_bool_option(option);
 
@@ -10,6 +10,13 @@
 #include <vector>
 #include <tuple>
 #include <sstream>
+#include <mutex>
+#include <map>
+#include <thread>
+#include <stdexcept>
+#include <regex>
+#include <random>
+#include <array>
 
 using namespace std::string_view_literals;
 
@@ -428,6 +435,61 @@ SCENARIO("clean_up_html removes HTML tags and entities.")
 	}
 }
 
+// this is how clean_up_html used to work, kept around to make sure the faster version does the same thing.
+extern "C" size_t decode_html_entities_utf8(char* dest, const char* src);
+std::string regex_clean_up_html(const std::string_view to_strip)
+{
+	if (to_strip.empty()) { return {}; }
+
+	const static std::regex remove_tags{ "<[^<]*?>" };
+	const static std::regex replace_line_breaks{ "<br *?/?>" };
+	const static std::regex replace_paragraph_breaks{ "</p>\\s*?<p>" };
+
+	std::string output = std::regex_replace(std::string{ to_strip }, replace_line_breaks, "\n");
+	output = std::regex_replace(output, replace_paragraph_breaks, "\n\n");
+	output = std::regex_replace(output, remove_tags, "");
+
+	output.push_back('\0');
+	output.resize(decode_html_entities_utf8(&output[0], nullptr));
+	return output;
+}
+
+SCENARIO("clean_up_html does the same thing as the regexes it replaced.")
+{
+	GIVEN("A bunch of strings made from random pieces of HTML.")
+	{
+		static constexpr std::array<std::string_view, 32> pieces{
+			"<p>", "</p>", "<br>", "<br/>", "<br />", "<br   >", "<br  /", "<br/ >", " ", "\n", "\t", "\r\n",
+			"&amp;", "&lt;", "&gt;", "&", "&#39;", "&hearts;", ";", "<", ">", "a", "hello there", "<div>", "</p", "<p",
+			"<a href=\"https://website.egg\" rel=\"nofollow\">", "</a>", "<span class=\"invisible\">", "\xc3\xa9", "<3", "@someone"
+		};
+
+		std::mt19937 twister{ 8675309 };
+		std::uniform_int_distribution<size_t> piece_count{ 0, 40 };
+		std::uniform_int_distribution<size_t> which_piece{ 0, pieces.size() - 1 };
+
+		std::vector<std::string> inputs(2000);
+		for (auto& input : inputs)
+		{
+			const size_t count = piece_count(twister);
+			for (size_t i = 0; i < count; i++)
+				input.append(pieces[which_piece(twister)]);
+		}
+
+		WHEN("each one is cleaned up both ways.")
+		{
+			THEN("the results match.")
+			{
+				for (const auto& input : inputs)
+				{
+					CAPTURE(input);
+					REQUIRE(clean_up_html(input) == regex_clean_up_html(input));
+				}
+			}
+		}
+	}
+}
+
 struct bulk_replace_test_case
 {
 	std::string input;
@@ -535,3 +597,151 @@ SCENARIO("We can correctly parse ISO 8601 timestamps.")
 		}
 	}
 }
+
+SCENARIO("parallel_for_limited runs everything once without going over its limits.")
+{
+	GIVEN("A list of keys with some repeats.")
+	{
+		const std::vector<std::string> keys{ "a", "b", "a", "c", "a", "b", "d", "a", "c", "b" };
+		const unsigned int max_threads = GENERATE(1u, 2u, 4u, 16u);
+		const unsigned int max_per_key = GENERATE(1u, 2u);
+
+		std::mutex lock;
+		std::vector<int> times_run(keys.size(), 0);
+		std::map<std::string, unsigned int> running;
+		std::map<std::string, unsigned int> most_running;
+		unsigned int running_total = 0;
+		unsigned int most_running_total = 0;
+
+		WHEN("parallel_for_limited is run over them.")
+		{
+			parallel_for_limited(keys, max_threads, max_per_key, [&](size_t idx)
+			{
+				{
+					const std::lock_guard<std::mutex> guard{ lock };
+					times_run[idx]++;
+					most_running[keys[idx]] = std::max(most_running[keys[idx]], ++running[keys[idx]]);
+					most_running_total = std::max(most_running_total, ++running_total);
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+				const std::lock_guard<std::mutex> guard{ lock };
+				running[keys[idx]]--;
+				running_total--;
+			});
+
+			THEN("every index was run exactly once.")
+			{
+				REQUIRE(std::all_of(times_run.begin(), times_run.end(), [](int times) { return times == 1; }));
+			}
+
+			THEN("no key ever had more than the limit running at once.")
+			{
+				for (const auto& key : most_running)
+				{
+					CAPTURE(key.first);
+					REQUIRE(key.second <= max_per_key);
+				}
+			}
+
+			THEN("there were never more than max_threads running at once.")
+			{
+				REQUIRE(most_running_total <= max_threads);
+			}
+		}
+	}
+
+	GIVEN("A function that throws on one of the keys.")
+	{
+		const std::vector<int> keys{ 1, 2, 3, 1, 2, 3 };
+		const unsigned int max_threads = GENERATE(1u, 3u);
+		std::vector<char> ran(keys.size(), false);
+
+		WHEN("parallel_for_limited is run over them.")
+		{
+			const auto run = [&]() { parallel_for_limited(keys, max_threads, 1, [&](size_t idx)
+			{
+				ran[idx] = true;
+				if (idx == 2)
+					throw std::runtime_error("oh no");
+			}); };
+
+			THEN("the exception comes out the other end, and everything else still ran.")
+			{
+				REQUIRE_THROWS_AS(run(), std::runtime_error);
+				REQUIRE(std::all_of(ran.begin(), ran.end(), [](char r) { return r; }));
+			}
+		}
+	}
+}
+
+SCENARIO("parse_byte_size reads sizes like 2M.")
+{
+	GIVEN("A size msync understands.")
+	{
+		const auto test_case = GENERATE(
+			std::make_pair("0"sv, 0ULL),
+			std::make_pair("500"sv, 500ULL),
+			std::make_pair("500b"sv, 500ULL),
+			std::make_pair("1k"sv, 1024ULL),
+			std::make_pair("1KB"sv, 1024ULL),
+			std::make_pair("1KiB"sv, 1024ULL),
+			std::make_pair("2M"sv, 2ULL * 1024 * 1024),
+			std::make_pair("2mb"sv, 2ULL * 1024 * 1024),
+			std::make_pair("3G"sv, 3ULL * 1024 * 1024 * 1024),
+			std::make_pair("1T"sv, 1024ULL * 1024 * 1024 * 1024)
+		);
+
+		WHEN("it's parsed.")
+		{
+			const auto parsed = parse_byte_size(test_case.first);
+
+			THEN("it's that many bytes.")
+			{
+				REQUIRE(parsed == test_case.second);
+			}
+		}
+	}
+
+	GIVEN("Something that isn't a size.")
+	{
+		const auto test_case = GENERATE(""sv, "M"sv, "-1M"sv, "1.5M"sv, "2 M"sv, "2MM"sv, "2Q"sv, "2iB"sv, "lots"sv, "99999999999999999999"sv, "99999999999T"sv);
+
+		WHEN("it's parsed.")
+		{
+			const auto parsed = parse_byte_size(test_case);
+
+			THEN("nothing comes back.")
+			{
+				REQUIRE_FALSE(parsed.has_value());
+			}
+		}
+	}
+}
+
+SCENARIO("fnv1a and hash_to_hex give the same hashes every time.")
+{
+	GIVEN("Some strings with known FNV-1a hashes.")
+	{
+		THEN("they hash to those.")
+		{
+			REQUIRE(hash_to_hex(fnv1a("")) == "cbf29ce484222325");
+			REQUIRE(hash_to_hex(fnv1a("a")) == "af63dc4c8601ec8c");
+			REQUIRE(hash_to_hex(fnv1a("foobar")) == "85944171f73967e8");
+		}
+
+		THEN("hashing a string in pieces is the same as hashing it all at once.")
+		{
+			REQUIRE(fnv1a("bar", fnv1a("foo")) == fnv1a("foobar"));
+		}
+	}
+
+	GIVEN("A small hash.")
+	{
+		THEN("the leading zeroes are kept.")
+		{
+			REQUIRE(hash_to_hex(0x2a) == "000000000000002a");
+		}
+	}
+}